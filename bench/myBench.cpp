@@ -0,0 +1,577 @@
+/**
+ ******************************************************************************
+ * @file    myBench.cpp
+ * @brief   Benchmark harness: generates a synthetic tree, then times the
+ *          scanning and printing functions on it with warm and cold caches,
+ *          and reports wall time, system calls, allocations and peak memory
+ *          per entry. Also times the Queue ring buffer against the linear
+ *          queue it replaced.
+ * @author  Arun, Sagar, Saurav
+ * @date    March 7, 2024
+ ******************************************************************************
+ */
+
+#include "myGenerator.hpp"
+#include "myTypeDef.h"
+#include "myOutput.hpp"
+#include "myQueue.hpp"
+#include "mySize.hpp"
+#include "mySlide.hpp"
+#include "mySort.hpp"
+#include "myStats.hpp"
+#include "myTree.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <linux/perf_event.h>
+#include <string>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+/**
+ * @brief Help message of the benchmark harness.
+ */
+static const char *help_msg =
+    "usage: difo_bench [options]\n\n"
+    "Generates a synthetic tree, then times build_tree, draw_size_bar, sort_files and\n"
+    "print_content_with_slide on it. The same options and seed always give the same tree.\n"
+    "Then times the Queue ring buffer against the linear queue it replaced.\n\n"
+    "tree options:\n"
+    "  --root <dir>              Where the tree is generated (default: /tmp/difo_bench)\n"
+    "  --fanout <n>              Subdirectories per directory (default: 8)\n"
+    "  --depth <n>               Levels of subdirectories (default: 4)\n"
+    "  --files <n>               Files per directory (default: 16)\n"
+    "  --size-median <bytes>     Median file size (default: 1024)\n"
+    "  --size-sigma <x>          Spread of the log-normal file sizes, 0 for fixed (default: 1.5)\n"
+    "  --size-max <bytes>        Largest file size (default: 16777216)\n"
+    "  --hidden <ratio>          Share of hidden names (default: 0.1)\n"
+    "  --name-min <n>            Shortest name (default: 4)\n"
+    "  --name-max <n>            Longest name (default: 24)\n"
+    "  --flat <n>                Files of the directory sorted by sort_files (default: 10000)\n"
+    "  --slide-bytes <n>         Size of the file shown by the slide view (default: 65536)\n"
+    "  --seed <n>                Seed of the generator (default: 1)\n"
+    "  --queue-bytes <n>         Bytes handed through the queues (default: 16777216)\n"
+    "  --generate-only           Generate the tree and exit\n\n"
+    "run options:\n"
+    "  --repeat <n>              Runs per benchmark, the median one is reported (default: 5)\n"
+    "  -j, --jobs <n>            Walker threads (default: number of CPUs)\n"
+    "  --cold                    Also run with cold caches (needs root to drop the page cache)\n"
+    "  -h, --help                Show this help message and exit\n\n"
+    "All counts are per entry of the benchmarked directory. Syscalls need the raw_syscalls\n"
+    "tracepoint (tracefs and perf_event_paranoid <= 1 or root); '-' when it is not available.\n";
+
+/**
+ * @brief What one run of a benchmark cost.
+ */
+struct Measure
+{
+    double wall_ns = 0; /**< Wall time. */
+    int64_t syscalls = -1; /**< System calls, -1 when they cannot be counted. */
+    uint64_t allocations = 0; /**< Calls to operator new. */
+    uint64_t stat_calls = 0; /**< stat calls counted by the scanner. */
+    int64_t peak_rss = 0; /**< Growth of the peak resident set over the run, in bytes. */
+};
+
+/**
+ * @brief One benchmarked function.
+ */
+struct Benchmark
+{
+    std::string name; /**< The name printed. */
+    uint64_t entries; /**< The entries it processes, to report per-entry costs. */
+    std::function<void()> run; /**< One run. */
+};
+
+/**
+ * @brief The linear queue the ring buffer replaced, kept as a baseline.
+ *
+ * Not circular: it only takes elements again once drained, so a user fills
+ * it, then empties it.
+ */
+template <typename T, int MAX_SIZE = 128>
+class LinearQueue
+{
+public:
+    bool is_empty() const { return front == -1; }
+    bool is_full() const { return rear == MAX_SIZE - 1; }
+
+    void enqueue(T item)
+    {
+        if (is_full())
+            return;
+        if (is_empty())
+            front = 0;
+        items[++rear] = item;
+    }
+
+    T dequeue()
+    {
+        if (is_empty())
+            return T();
+        T item = items[front];
+        if (front == rear)
+            front = rear = -1;
+        else
+            ++front;
+        return item;
+    }
+
+private:
+    int front = -1; /**< Index of the front element. */
+    int rear = -1; /**< Index of the rear element. */
+    T items[MAX_SIZE]; /**< The elements. */
+};
+
+/**
+ * @brief Hands bytes through the linear queue one at a time, the way the slide view used it.
+ * @param bytes The number of bytes.
+ * @return A checksum, so the work is not optimized away.
+ */
+static uint64_t run_linear_queue(uint64_t bytes)
+{
+    LinearQueue<char> queue;
+    uint64_t sum = 0;
+    for (uint64_t index = 0; index < bytes; ++index)
+    {
+        if (queue.is_full())
+        {
+            while (!queue.is_empty())
+            {
+                sum += static_cast<unsigned char>(queue.dequeue());
+            }
+        }
+        queue.enqueue(static_cast<char>(index));
+    }
+    while (!queue.is_empty())
+    {
+        sum += static_cast<unsigned char>(queue.dequeue());
+    }
+    return sum;
+}
+
+/**
+ * @brief Hands bytes through the ring buffer one at a time, on one thread, like run_linear_queue().
+ * @param bytes The number of bytes.
+ * @return A checksum, so the work is not optimized away.
+ */
+static uint64_t run_ring_queue(uint64_t bytes)
+{
+    Queue<char> queue;
+    uint64_t sum = 0;
+    char item;
+    for (uint64_t index = 0; index < bytes; ++index)
+    {
+        if (!queue.push(static_cast<char>(index)))
+        {
+            while (queue.pop(item))
+            {
+                sum += static_cast<unsigned char>(item);
+            }
+            queue.push(static_cast<char>(index));
+        }
+    }
+    while (queue.pop(item))
+    {
+        sum += static_cast<unsigned char>(item);
+    }
+    return sum;
+}
+
+/**
+ * @brief Hands bytes through the ring buffer in chunks, from a producer thread to the caller.
+ * @param bytes The number of bytes.
+ * @return A checksum, so the work is not optimized away.
+ */
+static uint64_t run_ring_threads(uint64_t bytes)
+{
+    static constexpr std::size_t CHUNK = 4096;
+    auto queue = std::make_unique<Queue<char, 64 * 1024>>();
+    std::thread producer([&queue, bytes]
+                         {
+        char chunk[CHUNK];
+        for (uint64_t sent = 0; sent < bytes;)
+        {
+            std::size_t size = static_cast<std::size_t>(std::min<uint64_t>(CHUNK, bytes - sent));
+            for (std::size_t index = 0; index < size; ++index)
+            {
+                chunk[index] = static_cast<char>(sent + index);
+            }
+            for (std::size_t pushed = 0; pushed < size;)
+            {
+                std::size_t added = queue->push_n(chunk + pushed, size - pushed);
+                if (added == 0)
+                    std::this_thread::yield(); // Lets the consumer run when both share a CPU
+                pushed += added;
+            }
+            sent += size;
+        } });
+
+    char chunk[CHUNK];
+    uint64_t sum = 0;
+    for (uint64_t received = 0; received < bytes;)
+    {
+        std::size_t size = queue->pop_n(chunk, CHUNK);
+        if (size == 0)
+            std::this_thread::yield();
+        for (std::size_t index = 0; index < size; ++index)
+        {
+            sum += static_cast<unsigned char>(chunk[index]);
+        }
+        received += size;
+    }
+    producer.join();
+    return sum;
+}
+
+/**
+ * @brief Counts the system calls of the process, threads included, with a perf tracepoint.
+ */
+class SyscallCounter
+{
+public:
+    SyscallCounter()
+    {
+        const char *paths[] = {"/sys/kernel/tracing/events/raw_syscalls/sys_enter/id",
+                               "/sys/kernel/debug/tracing/events/raw_syscalls/sys_enter/id"};
+        for (const char *path : paths)
+        {
+            std::ifstream file(path);
+            uint64_t id;
+            if (!(file >> id))
+                continue;
+
+            perf_event_attr attr;
+            std::memset(&attr, 0, sizeof(attr));
+            attr.type = PERF_TYPE_TRACEPOINT;
+            attr.size = sizeof(attr);
+            attr.config = id;
+            attr.disabled = 1;
+            attr.inherit = 1; // Walker threads are created after the counter
+            fd = static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, -1, PERF_FLAG_FD_CLOEXEC));
+            if (fd >= 0)
+                break;
+        }
+    }
+
+    ~SyscallCounter()
+    {
+        if (fd >= 0)
+            close(fd);
+    }
+
+    /**
+     * @brief Starts counting from zero.
+     */
+    void start()
+    {
+        if (fd < 0)
+            return;
+        ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+        ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+    }
+
+    /**
+     * @brief Stops counting.
+     * @return The system calls since start(), -1 if they cannot be counted.
+     */
+    int64_t stop()
+    {
+        uint64_t count = 0;
+        if (fd < 0)
+            return -1;
+        ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+        return read(fd, &count, sizeof(count)) == sizeof(count) ? static_cast<int64_t>(count) : -1;
+    }
+
+private:
+    int fd = -1; /**< The perf event, -1 when not available. */
+};
+
+/**
+ * @brief Reads a field of /proc/self/status.
+ * @param field The field, e.g. "VmHWM:".
+ * @return Its value in bytes.
+ */
+static int64_t status_bytes(const std::string &field)
+{
+    std::ifstream status("/proc/self/status");
+    std::string name;
+    while (status >> name)
+    {
+        int64_t kilobytes;
+        if (name == field && status >> kilobytes)
+            return kilobytes * 1024;
+        status.ignore(1 << 16, '\n');
+    }
+    return 0;
+}
+
+/**
+ * @brief Drops the page, dentry and inode caches.
+ * @return true if the caches were dropped.
+ */
+static bool drop_caches()
+{
+    sync();
+    std::ofstream file("/proc/sys/vm/drop_caches");
+    file << "3\n";
+    file.flush();
+    return static_cast<bool>(file);
+}
+
+/**
+ * @brief Runs a benchmark once.
+ * @param benchmark The benchmark.
+ * @param counter The system call counter.
+ * @return What the run cost.
+ */
+static Measure measure(const Benchmark &benchmark, SyscallCounter &counter)
+{
+    // Restart the peak from the current resident set
+    std::ofstream("/proc/self/clear_refs") << "5\n";
+    int64_t rss = status_bytes("VmRSS:");
+
+    Measure result;
+    uint64_t allocations_before = total_allocations();
+    scan_stats.stat_calls = 0;
+    counter.start();
+    auto start = std::chrono::steady_clock::now();
+    benchmark.run();
+    auto end = std::chrono::steady_clock::now();
+    result.syscalls = counter.stop();
+    result.allocations = total_allocations() - allocations_before;
+    result.stat_calls = scan_stats.stat_calls;
+    result.wall_ns = std::chrono::duration<double, std::nano>(end - start).count();
+    result.peak_rss = std::max<int64_t>(0, status_bytes("VmHWM:") - rss);
+    return result;
+}
+
+/**
+ * @brief Prints a number with a fixed number of decimals.
+ * @param report The report.
+ * @param value The number.
+ * @param width The width of the column.
+ */
+static void print_column(Output &report, double value, std::size_t width)
+{
+    char text[32];
+    int length = std::snprintf(text, sizeof(text), "%.2f", value);
+    report.pad(width > static_cast<std::size_t>(length) ? width - length : 1);
+    report << std::string_view(text, length);
+}
+
+/**
+ * @brief Parses a number option.
+ * @param argc Number of command-line arguments.
+ * @param argv Array of command-line arguments.
+ * @param i The index of the option, moved to its value.
+ * @param value Set to the value.
+ * @return true if a valid number followed the option.
+ */
+template <typename T>
+static bool parse_number(int argc, char *argv[], int &i, T &value)
+{
+    if (i + 1 >= argc)
+        return false;
+    char *end;
+    double number = std::strtod(argv[i + 1], &end);
+    if (*end != '\0' || number < 0)
+        return false;
+    value = static_cast<T>(number);
+    ++i;
+    return true;
+}
+
+/**
+ * @brief Entry point of the benchmark harness.
+ * @param argc Number of command-line arguments.
+ * @param argv Array of command-line arguments.
+ * @return SUCCESS, ARG_FAILURE or OPEN_FAILURE.
+ */
+int main(int argc, char *argv[])
+{
+    TreeShape shape;
+    std::string root = "/tmp/difo_bench";
+    unsigned repeat = 5;
+    unsigned jobs = default_jobs();
+    bool cold = false;
+    bool generate_only = false;
+    uint64_t queue_bytes = 16 * 1024 * 1024;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        bool ok = true;
+        if (arg == "--root" && i + 1 < argc)
+            root = argv[++i];
+        else if (arg == "--fanout")
+            ok = parse_number(argc, argv, i, shape.fanout);
+        else if (arg == "--depth")
+            ok = parse_number(argc, argv, i, shape.depth);
+        else if (arg == "--files")
+            ok = parse_number(argc, argv, i, shape.files);
+        else if (arg == "--size-median")
+            ok = parse_number(argc, argv, i, shape.size_median);
+        else if (arg == "--size-sigma")
+            ok = parse_number(argc, argv, i, shape.size_sigma);
+        else if (arg == "--size-max")
+            ok = parse_number(argc, argv, i, shape.size_max);
+        else if (arg == "--hidden")
+            ok = parse_number(argc, argv, i, shape.hidden_ratio) && shape.hidden_ratio <= 1;
+        else if (arg == "--name-min")
+            ok = parse_number(argc, argv, i, shape.name_min);
+        else if (arg == "--name-max")
+            ok = parse_number(argc, argv, i, shape.name_max);
+        else if (arg == "--flat")
+            ok = parse_number(argc, argv, i, shape.flat_files);
+        else if (arg == "--slide-bytes")
+            ok = parse_number(argc, argv, i, shape.slide_bytes);
+        else if (arg == "--seed")
+            ok = parse_number(argc, argv, i, shape.seed);
+        else if (arg == "--queue-bytes")
+            ok = parse_number(argc, argv, i, queue_bytes) && queue_bytes > 0;
+        else if (arg == "--repeat")
+            ok = parse_number(argc, argv, i, repeat) && repeat > 0;
+        else if (arg == "--jobs" || arg == "-j")
+            ok = parse_number(argc, argv, i, jobs) && jobs > 0;
+        else if (arg == "--cold")
+            cold = true;
+        else if (arg == "--generate-only")
+            generate_only = true;
+        else if (arg == "--help" || arg == "-h")
+        {
+            std::cout << help_msg;
+            return SUCCESS;
+        }
+        else
+            ok = false;
+
+        if (!ok)
+        {
+            std::cerr << "difo_bench: invalid argument '" << arg << "'" << std::endl;
+            std::cout << "see 'difo_bench --help'" << std::endl;
+            return ARG_FAILURE;
+        }
+    }
+
+    TreeCounts counts;
+    auto start = std::chrono::steady_clock::now();
+    if (!generate_tree(root, shape, counts))
+        return OPEN_FAILURE;
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::cerr << "tree: " << root << " (" << describe(shape) << ")\n"
+              << "      " << counts.directories << " directories, " << counts.files << " files, " << counts.bytes << " bytes"
+              << " (ready in " << seconds << " s)" << std::endl;
+    if (generate_only)
+        return SUCCESS;
+
+    // The views print to standard output: send it to /dev/null, the report goes to the original one
+    int report_fd = dup(STDOUT_FILENO);
+    int null_fd = open("/dev/null", O_WRONLY | O_CLOEXEC);
+    if (report_fd < 0 || null_fd < 0 || dup2(null_fd, STDOUT_FILENO) < 0)
+    {
+        std::cerr << "difo_bench: cannot redirect standard output: " << std::strerror(errno) << std::endl;
+        return OPEN_FAILURE;
+    }
+    close(null_fd);
+
+    std::string tree = root + "/" + TREE_MAIN;
+    std::string flat = root + "/" + TREE_FLAT;
+    std::string slide = root + "/" + TREE_SLIDE;
+    uint64_t tree_entries = 0;
+    for (auto it = std::filesystem::recursive_directory_iterator(tree); it != std::filesystem::recursive_directory_iterator(); ++it)
+    {
+        tree_entries++;
+    }
+    ScanOptions options;
+    options.jobs = jobs;
+    volatile uint64_t checksum = 0; // Keeps the queue loops from being optimized away
+
+    std::vector<Benchmark> benchmarks = {
+        {"build_tree", tree_entries, [&]
+         {
+             NodeStore store;
+             build_tree(tree, store, store.add_root(tree), false, jobs);
+         }},
+        {"draw_size_bar", tree_entries, [&]
+         { draw_size_bar(tree, options); }},
+        {"sort_files name", shape.flat_files, [&]
+         { sort_files(flat, SORT_NAME, ASC); }},
+        {"sort_files size", shape.flat_files, [&]
+         { sort_files(flat, SORT_SIZE, DESC); }},
+        {"sort_files time", shape.flat_files, [&]
+         { sort_files(flat, SORT_TIME, DESC); }},
+        {"slide", shape.slide_bytes, [&]
+         { print_content_with_slide(slide, 1e9f); }}, // No delay between characters
+        {"queue linear", queue_bytes, [&]
+         { checksum += run_linear_queue(queue_bytes); }},
+        {"queue ring", queue_bytes, [&]
+         { checksum += run_ring_queue(queue_bytes); }},
+        {"queue ring threads", queue_bytes, [&]
+         { checksum += run_ring_threads(queue_bytes); }},
+    };
+
+    Output report(report_fd);
+    report << "benchmark          cache    entries      wall ms   ns/entry  syscalls/e     stat/e   allocs/e  peak B/e\n";
+
+    // The phase timers stay off, they would add to the wall times measured
+    count_allocations();
+    SyscallCounter counter;
+    bool can_drop = !cold || drop_caches();
+    if (!can_drop)
+        std::cerr << "difo_bench: cannot drop the caches (needs root), cold runs skipped" << std::endl;
+
+    for (const Benchmark &benchmark : benchmarks)
+    {
+        for (bool cold_run : {false, true})
+        {
+            if (cold_run && (!cold || !can_drop))
+                continue;
+
+            benchmark.run(); // Warms the caches and the allocator
+            std::vector<Measure> runs;
+            for (unsigned run = 0; run < repeat; ++run)
+            {
+                if (cold_run)
+                    drop_caches();
+                runs.push_back(measure(benchmark, counter));
+            }
+            std::sort(runs.begin(), runs.end(), [](const Measure &a, const Measure &b)
+                      { return a.wall_ns < b.wall_ns; });
+            const Measure &median = runs[runs.size() / 2];
+            double entries = static_cast<double>(std::max<uint64_t>(benchmark.entries, 1));
+
+            report << benchmark.name;
+            report.pad(19 - std::min<std::size_t>(benchmark.name.size(), 18));
+            report << (cold_run ? "cold" : "warm");
+            report.pad(11 - std::to_string(benchmark.entries).size());
+            report << benchmark.entries;
+            print_column(report, median.wall_ns / 1e6, 13);
+            print_column(report, median.wall_ns / entries, 11);
+            if (median.syscalls < 0)
+            {
+                report.pad(11);
+                report << '-';
+            }
+            else
+            {
+                print_column(report, median.syscalls / entries, 12);
+            }
+            print_column(report, median.stat_calls / entries, 11);
+            print_column(report, median.allocations / entries, 11);
+            print_column(report, median.peak_rss / entries, 10);
+            report << '\n';
+            report.flush();
+        }
+    }
+    return SUCCESS;
+}
@@ -0,0 +1,274 @@
+/**
+ ******************************************************************************
+ * @file    myGenerator.cpp
+ * @brief   Implementation of the synthetic directory tree generator.
+ * @author  Arun, Sagar, Saurav
+ * @date    March 7, 2024
+ ******************************************************************************
+ */
+
+#include "myGenerator.hpp"
+#include <cerrno>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <fcntl.h>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <unordered_set>
+#include <vector>
+
+/**
+ * @brief Draws the tree from a seed.
+ *
+ * std::mt19937_64 is specified bit for bit by the standard, unlike the standard
+ * distributions, so the mapping to sizes and names is done here to give the
+ * same tree with every standard library.
+ */
+class TreeBuilder
+{
+public:
+    TreeBuilder(const TreeShape &shape, TreeCounts &counts) : shape(shape), counts(counts), random(shape.seed), contents(1 << 20)
+    {
+        for (char &c : contents)
+        {
+            c = static_cast<char>(random());
+        }
+    }
+
+    /**
+     * @brief Fills a directory with files and, above the last level, subdirectories.
+     * @param directory The existing directory.
+     * @param level The level of @p directory, 0 for the top.
+     * @return true on success.
+     */
+    bool fill(const std::string &directory, unsigned level)
+    {
+        std::unordered_set<std::string> names;
+        for (unsigned i = 0; i < shape.files; ++i)
+        {
+            std::string file = directory + "/" + unique_name(names);
+            if (!write_file(file, file_size()))
+                return false;
+        }
+        if (level == shape.depth)
+            return true;
+
+        for (unsigned i = 0; i < shape.fanout; ++i)
+        {
+            std::string child = directory + "/" + unique_name(names);
+            if (!make_directory(child) || !fill(child, level + 1))
+                return false;
+        }
+        return true;
+    }
+
+    /**
+     * @brief Fills the flat directory.
+     * @param directory The existing directory.
+     * @return true on success.
+     */
+    bool fill_flat(const std::string &directory)
+    {
+        std::unordered_set<std::string> names;
+        for (unsigned i = 0; i < shape.flat_files; ++i)
+        {
+            std::string file = directory + "/" + unique_name(names);
+            if (!write_file(file, file_size()))
+                return false;
+        }
+        return true;
+    }
+
+    /**
+     * @brief Writes the text file of the slide benchmark: lines of lowercase words.
+     * @param file The path of the file.
+     * @return true on success.
+     */
+    bool write_text(const std::string &file)
+    {
+        std::string text;
+        text.reserve(shape.slide_bytes);
+        std::size_t line = 0;
+        while (text.size() < shape.slide_bytes)
+        {
+            std::size_t word = 1 + uniform(10);
+            for (std::size_t i = 0; i < word && text.size() < shape.slide_bytes; ++i)
+            {
+                text += static_cast<char>('a' + uniform(26));
+            }
+            line += word + 1;
+            if (text.size() < shape.slide_bytes)
+                text += line > 72 ? '\n' : ' ';
+            if (line > 72)
+                line = 0;
+        }
+        return write_file(file, text.data(), text.size());
+    }
+
+    /**
+     * @brief Creates a directory.
+     * @param path The path.
+     * @return true on success.
+     */
+    bool make_directory(const std::string &path)
+    {
+        if (mkdir(path.c_str(), 0755) != 0)
+        {
+            std::cerr << "difo_bench: cannot create '" << path << "': " << std::strerror(errno) << std::endl;
+            return false;
+        }
+        counts.directories++;
+        return true;
+    }
+
+private:
+    static constexpr int64_t BASE_TIME = 1700000000; /**< Earliest modification time, in seconds. */
+    static constexpr int64_t TIME_SPAN = 365 * 24 * 3600; /**< Spread of the modification times. */
+
+    const TreeShape &shape; /**< The shape drawn. */
+    TreeCounts &counts; /**< What was written so far. */
+    std::mt19937_64 random; /**< The only source of randomness; every draw is sequenced. */
+    std::vector<char> contents; /**< Bytes copied into every file. */
+
+    uint64_t uniform(uint64_t bound) { return random() % bound; }
+    double unit() { return static_cast<double>(random() >> 11) * 0x1.0p-53; }
+
+    // Log-normal around the median, through a Box-Muller normal deviate
+    uint64_t file_size()
+    {
+        if (shape.size_sigma <= 0)
+            return shape.size_median;
+        double radius = std::sqrt(-2.0 * std::log(1.0 - unit()));
+        double normal = radius * std::cos(2.0 * M_PI * unit());
+        double size = static_cast<double>(shape.size_median) * std::exp(shape.size_sigma * normal);
+        return static_cast<uint64_t>(std::min(size, static_cast<double>(shape.size_max)));
+    }
+
+    std::string unique_name(std::unordered_set<std::string> &names)
+    {
+        static constexpr char alphabet[] = "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789_-";
+        std::string name;
+        do
+        {
+            std::size_t length = shape.name_min + uniform(shape.name_max - shape.name_min + 1);
+            name.clear();
+            if (unit() < shape.hidden_ratio)
+                name += '.';
+            while (name.size() < length)
+            {
+                name += alphabet[uniform(sizeof(alphabet) - 1)];
+            }
+        } while (name == "." || name == ".." || !names.insert(name).second);
+        return name;
+    }
+
+    bool write_file(const std::string &path, uint64_t size)
+    {
+        std::size_t offset = static_cast<std::size_t>(uniform(contents.size()));
+        return write_file(path, nullptr, size, offset);
+    }
+
+    bool write_file(const std::string &path, const char *data, uint64_t size, std::size_t offset = 0)
+    {
+        int fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        bool ok = fd >= 0;
+        for (uint64_t left = size; ok && left > 0;)
+        {
+            const char *chunk = data ? data + (size - left) : contents.data() + offset;
+            std::size_t length = static_cast<std::size_t>(std::min<uint64_t>(left, data ? left : contents.size() - offset));
+            ssize_t count = write(fd, chunk, length);
+            ok = count > 0;
+            left -= ok ? static_cast<uint64_t>(count) : 0;
+            offset = 0;
+        }
+
+        // Fixed modification times keep the time sort reproducible
+        timespec times[2];
+        times[0].tv_sec = times[1].tv_sec = BASE_TIME + static_cast<int64_t>(uniform(TIME_SPAN));
+        times[0].tv_nsec = times[1].tv_nsec = 0;
+        ok = ok && futimens(fd, times) == 0;
+        if (fd >= 0)
+            close(fd);
+        if (!ok)
+        {
+            std::cerr << "difo_bench: cannot write '" << path << "': " << std::strerror(errno) << std::endl;
+            return false;
+        }
+        counts.files++;
+        counts.bytes += size;
+        return true;
+    }
+};
+
+/**
+ * @brief Describes a shape in one line, as stored in the stamp file.
+ * @param shape The shape.
+ * @return The description.
+ */
+std::string describe(const TreeShape &shape)
+{
+    std::ostringstream text;
+    text << "fanout=" << shape.fanout << " depth=" << shape.depth << " files=" << shape.files
+         << " size-median=" << shape.size_median << " size-sigma=" << shape.size_sigma << " size-max=" << shape.size_max
+         << " hidden=" << shape.hidden_ratio << " names=" << shape.name_min << "-" << shape.name_max
+         << " flat=" << shape.flat_files << " slide-bytes=" << shape.slide_bytes << " seed=" << shape.seed;
+    return text.str();
+}
+
+/**
+ * @brief Builds a synthetic tree, or reuses the one already there if it has the same shape.
+ * @param root The directory to build the tree in.
+ * @param shape The shape of the tree.
+ * @param counts Set to what the tree holds.
+ * @return true on success, false with a message on the error stream otherwise.
+ */
+bool generate_tree(const std::string &root, const TreeShape &shape, TreeCounts &counts)
+{
+    if (shape.name_min == 0 || shape.name_min > shape.name_max || shape.name_max > 255)
+    {
+        std::cerr << "difo_bench: names must be 1 to 255 characters long" << std::endl;
+        return false;
+    }
+
+    std::string stamp = root + "/" + TREE_STAMP;
+    std::error_code error;
+    if (std::filesystem::exists(root, error))
+    {
+        std::ifstream file(stamp);
+        std::string line;
+        if (!file.is_open() && !std::filesystem::is_empty(root, error))
+        {
+            std::cerr << "difo_bench: '" << root << "' exists and was not generated by difo_bench" << std::endl;
+            return false;
+        }
+        if (std::getline(file, line) && line == describe(shape) && file >> counts.directories >> counts.files >> counts.bytes)
+            return true; // Same shape, same tree
+        std::filesystem::remove_all(root, error);
+        if (error)
+        {
+            std::cerr << "difo_bench: cannot remove '" << root << "': " << error.message() << std::endl;
+            return false;
+        }
+    }
+
+    counts = TreeCounts();
+    TreeBuilder builder(shape, counts);
+    if (!builder.make_directory(root))
+        return false;
+    counts.directories = 0;
+    if (!builder.make_directory(root + "/" + TREE_MAIN) || !builder.fill(root + "/" + TREE_MAIN, 0) ||
+        !builder.make_directory(root + "/" + TREE_FLAT) || !builder.fill_flat(root + "/" + TREE_FLAT) ||
+        !builder.write_text(root + "/" + TREE_SLIDE))
+        return false;
+
+    // Written last, so an interrupted generation is never taken for a complete one
+    std::ofstream file(stamp);
+    file << describe(shape) << '\n'
+         << counts.directories << ' ' << counts.files << ' ' << counts.bytes << '\n';
+    return static_cast<bool>(file);
+}
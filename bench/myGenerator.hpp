@@ -0,0 +1,68 @@
+/**
+ ******************************************************************************
+ * @file    myGenerator.hpp
+ * @brief   Declarations of the synthetic directory tree generator used by the
+ *          benchmarks. The same parameters and seed always give the same tree.
+ * @author  Arun, Sagar, Saurav
+ * @date    March 7, 2024
+ ******************************************************************************
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+/**
+ * @brief The shape of a synthetic tree.
+ */
+struct TreeShape
+{
+    unsigned fanout = 8; /**< Subdirectories per directory. */
+    unsigned depth = 4; /**< Levels of subdirectories below the root. */
+    unsigned files = 16; /**< Files per directory. */
+    uint64_t size_median = 1024; /**< Median file size in bytes. */
+    double size_sigma = 1.5; /**< Spread of the log-normal file sizes, 0 for all files of the median size. */
+    uint64_t size_max = 16 << 20; /**< Largest file size in bytes. */
+    double hidden_ratio = 0.1; /**< Share of files and directories whose name starts with '.'. */
+    unsigned name_min = 4; /**< Shortest name. */
+    unsigned name_max = 24; /**< Longest name. */
+    unsigned flat_files = 10000; /**< Files of the flat directory sorted by the benchmarks. */
+    uint64_t slide_bytes = 64 * 1024; /**< Size of the text file shown by the slide benchmark. */
+    uint64_t seed = 1; /**< Seed of the pseudo-random generator. */
+};
+
+/**
+ * @brief Counts of what a generated tree holds.
+ */
+struct TreeCounts
+{
+    uint64_t directories = 0; /**< Directories, the root excluded. */
+    uint64_t files = 0; /**< Regular files. */
+    uint64_t bytes = 0; /**< Sum of the file sizes. */
+};
+
+constexpr const char *TREE_STAMP = ".difo_bench"; /**< File at the root of a generated tree, holding its shape. */
+constexpr const char *TREE_MAIN = "tree"; /**< The nested directories, below the root. */
+constexpr const char *TREE_FLAT = "flat"; /**< The flat directory, below the root. */
+constexpr const char *TREE_SLIDE = "slide.txt"; /**< The text file, below the root. */
+
+/**
+ * @brief Describes a shape in one line, as stored in the stamp file.
+ * @param shape The shape.
+ * @return The description.
+ */
+std::string describe(const TreeShape &shape);
+
+/**
+ * @brief Builds a synthetic tree, or reuses the one already there if it has the same shape.
+ *
+ * A different tree generated earlier at @p root (recognized by its stamp file)
+ * is removed first; any other existing, non-empty directory is left alone.
+ *
+ * @param root The directory to build the tree in.
+ * @param shape The shape of the tree.
+ * @param counts Set to what the tree holds.
+ * @return true on success, false with a message on the error stream otherwise.
+ */
+bool generate_tree(const std::string &root, const TreeShape &shape, TreeCounts &counts);
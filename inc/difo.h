@@ -0,0 +1,181 @@
+/**
+ ******************************************************************************
+ * @file    difo.h
+ * @brief   The C interface of libdifo: walking, disk usage and sorted listings
+ *          in-process, without starting difo and parsing its output.
+ *
+ *          Functions return 0 on success or an errno value, never exit, and
+ *          report entries through a visitor callback, so no memory crosses the
+ *          interface. Directories below the root that cannot be read are
+ *          skipped with a message on stderr, like the command line does.
+ * @author  Arun, Sagar, Saurav
+ * @date    March 7, 2024
+ ******************************************************************************
+ */
+
+#ifndef DIFO_H
+#define DIFO_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#if defined(DIFO_BUILDING)
+#define DIFO_API __attribute__((visibility("default")))
+#else
+#define DIFO_API
+#endif
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/** Version of this interface; structures only grow at the end, behind size fields. */
+#define DIFO_API_VERSION 1
+
+/**
+ * @brief Types of entries.
+ */
+enum difo_type
+{
+    DIFO_TYPE_UNKNOWN = 0, /**< Could not be stat-ed */
+    DIFO_TYPE_FILE = 1, /**< Regular file */
+    DIFO_TYPE_DIRECTORY = 2, /**< Directory */
+    DIFO_TYPE_SYMLINK = 3, /**< Symbolic link, not followed */
+    DIFO_TYPE_OTHER = 4 /**< Device, FIFO, socket or dangling link */
+};
+
+/**
+ * @brief What a visitor returns.
+ */
+enum difo_visit
+{
+    DIFO_CONTINUE = 0, /**< Go on, entering the entry if it is a directory */
+    DIFO_SKIP = 1, /**< Go on, without entering the entry */
+    DIFO_STOP = 2 /**< End the call, which then returns 0 */
+};
+
+/**
+ * @brief Sort keys of difo_list().
+ */
+enum difo_sort
+{
+    DIFO_SORT_NAME = 0, /**< Name, case-insensitive with numbers in numeric order */
+    DIFO_SORT_SIZE = 1, /**< Size in bytes */
+    DIFO_SORT_TIME = 2 /**< Modification time */
+};
+
+/**
+ * @brief Flags of difo_options.
+ */
+enum difo_flag
+{
+    DIFO_HIDDEN = 1 << 0, /**< Include entries whose name starts with '.' */
+    DIFO_ONE_FILE_SYSTEM = 1 << 1, /**< Stay on the file system of the root */
+    DIFO_GITIGNORE = 1 << 2, /**< Skip what .gitignore files ignore, and .git itself */
+    DIFO_POST_ORDER = 1 << 3, /**< difo_walk(): visit every entered directory again after its entries */
+    DIFO_UNSORTED = 1 << 4, /**< difo_walk(): visit entries in listing order instead of by name */
+    DIFO_DESCENDING = 1 << 5 /**< difo_list(): largest, newest or last name first */
+};
+
+/**
+ * @brief Options shared by the calls. Set up with difo_options_init().
+ */
+typedef struct difo_options
+{
+    size_t size; /**< sizeof(difo_options), set by difo_options_init(). */
+    unsigned flags; /**< difo_flag bits. */
+    unsigned jobs; /**< Walker threads of difo_disk_usage(), 0 for the number of hardware threads. */
+    unsigned max_depth; /**< Deepest level visited by difo_walk(), the root's entries being 1 (0 for no limit). */
+    uint64_t max_entries; /**< Entries after which difo_walk() stops (0 for no limit). */
+    const char *const *exclude; /**< Globs of skipped entries, like --exclude. */
+    size_t exclude_count; /**< Number of exclude globs. */
+    const char *const *include; /**< Globs of the only files kept, like --include. */
+    size_t include_count; /**< Number of include globs. */
+} difo_options;
+
+/**
+ * @brief One entry handed to a visitor, valid during the call only.
+ */
+typedef struct difo_entry
+{
+    const char *path; /**< Path relative to the root. */
+    const char *name; /**< Last component of the path. */
+    int type; /**< A difo_type. */
+    int is_symlink; /**< Whether the entry is a symbolic link. */
+    int leaving; /**< difo_walk() with DIFO_POST_ORDER: whether this is the visit after the entries. */
+    unsigned depth; /**< Level of the entry, the root's entries being 1. */
+    uint32_t mode; /**< st_mode. */
+    uint64_t nlink; /**< Number of hard links. */
+    uint64_t size; /**< Size in bytes; the recursive apparent size in difo_disk_usage(). */
+    uint64_t allocated; /**< Bytes allocated on disk; recursive in difo_disk_usage(). */
+    int64_t mtime_ns; /**< Modification time in nanoseconds since the epoch. */
+    uint64_t ino; /**< Inode number. */
+    uint64_t dev; /**< Device number. */
+} difo_entry;
+
+/**
+ * @brief Called for every entry.
+ * @param entry The entry.
+ * @param user_data The pointer given to the call.
+ * @return A difo_visit.
+ */
+typedef int (*difo_visitor)(const difo_entry *entry, void *user_data);
+
+/**
+ * @brief Gets the version of the library.
+ * @return DIFO_API_VERSION of the library, which may be newer than the header.
+ */
+DIFO_API int difo_version(void);
+
+/**
+ * @brief Sets options to the defaults: no flags, no limits, all hardware threads.
+ * @param options The options.
+ */
+DIFO_API void difo_options_init(difo_options *options);
+
+/**
+ * @brief Walks the entries below a directory depth first, one directory listed at a time.
+ *
+ * Symbolic links are reported, not followed. Directories are only listed when
+ * the walk enters them, so returning DIFO_SKIP or DIFO_STOP saves their work.
+ *
+ * @param root The directory.
+ * @param options The options, NULL for the defaults.
+ * @param visit Called for every entry, from the calling thread.
+ * @param user_data Passed to @p visit.
+ * @return 0, or the errno of opening @p root, EINVAL for a NULL argument.
+ */
+DIFO_API int difo_walk(const char *root, const difo_options *options, difo_visitor visit, void *user_data);
+
+/**
+ * @brief Computes the recursive disk usage of every entry of a directory.
+ *
+ * Subtrees are summed in parallel, hard links counted once and symbolic links
+ * not followed, like du. The visitor gets the entries of @p root only, in
+ * listing order, with size and allocated summed over their subtrees.
+ *
+ * @param root The directory.
+ * @param options The options, NULL for the defaults; max_depth and max_entries are ignored.
+ * @param visit Called for every entry of @p root, from the calling thread.
+ * @param user_data Passed to @p visit.
+ * @return 0, or the errno of opening @p root, EINVAL for a NULL argument.
+ */
+DIFO_API int difo_disk_usage(const char *root, const difo_options *options, difo_visitor visit, void *user_data);
+
+/**
+ * @brief Lists the entries of a directory sorted, as the --sort view does.
+ * @param root The directory.
+ * @param sort A difo_sort; ties are broken by name.
+ * @param options The options, NULL for the defaults; max_depth and max_entries are ignored.
+ * @param visit Called for every entry, in order, from the calling thread.
+ * @param user_data Passed to @p visit.
+ * @return 0, or the errno of opening @p root, EINVAL for a NULL argument or an unknown sort.
+ */
+DIFO_API int difo_list(const char *root, int sort, const difo_options *options, difo_visitor visit, void *user_data);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* DIFO_H */
@@ -0,0 +1,69 @@
+/**
+ ******************************************************************************
+ * @file    myBatch.hpp
+ * @brief   Declarations of the batched metadata backend.
+ *          The entries of one directory are stat-ed as a batch, submitted
+ *          through io_uring, or through a thread pool where io_uring is not
+ *          available, so that a high-latency file system answers many requests
+ *          per round trip instead of one.
+ * @author  Arun, Sagar, Saurav
+ * @date    March 7, 2024
+ ******************************************************************************
+ */
+
+#pragma once
+
+#include "myTypeDef.h"
+#include <cstddef>
+#include <sys/stat.h>
+
+/**
+ * @brief Default number of stat requests in flight per batch.
+ */
+constexpr unsigned IO_DEFAULT_DEPTH = 64;
+
+/**
+ * @brief Smallest number of entries worth a batch; smaller directories are stat-ed one by one.
+ */
+constexpr std::size_t IO_BATCH_MIN = 8;
+
+/**
+ * @brief One stat request of a batch.
+ */
+struct StatRequest
+{
+    const char *name = nullptr; /**< The name, relative to the directory. */
+    struct statx result = {}; /**< The metadata, valid when error is 0. */
+    int error = 0; /**< The errno of a failed request, 0 on success. */
+};
+
+/**
+ * @brief Sets how directories are stat-ed, before any scan starts.
+ * @param mode IO_AUTO to batch on network and FUSE file systems only, IO_BATCH
+ *        to batch everywhere, IO_SYNC to stat one entry at a time.
+ * @param depth The number of requests in flight per batch.
+ */
+void configure_batch_stat(IoModeDef mode, unsigned depth);
+
+/**
+ * @brief Checks whether the entries of a directory should be stat-ed as a batch.
+ * @param dirfd The open directory.
+ * @param count The number of entries to stat.
+ * @return true to call batch_stat(), false to stat the entries one by one.
+ */
+bool batch_stat_wanted(int dirfd, std::size_t count);
+
+/**
+ * @brief Stats a batch of entries of one directory.
+ * @param dirfd The open directory the names are relative to.
+ * @param requests The requests.
+ * @param count The number of requests.
+ * @param follow_links Whether to stat the targets of symbolic links.
+ */
+void batch_stat(int dirfd, StatRequest *requests, std::size_t count, bool follow_links);
+
+/**
+ * @brief Gets the name of the backend used by batches.
+ * @return "io_uring", "threads", or "none" if no batch ran.
+ */
+const char *batch_stat_backend();
@@ -0,0 +1,113 @@
+/**
+ ******************************************************************************
+ * @file    myCollate.hpp
+ * @brief   Declarations of the name order shared by the views: every name is
+ *          turned once into a binary sort key, and keys compare with memcmp.
+ * @author  Arun, Sagar, Saurav
+ * @date    March 7, 2024
+ ******************************************************************************
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/**
+ * @brief What a name sort key folds, as bits.
+ */
+enum NameOrderDef
+{
+    NAME_FOLD_CASE = 1 << 0, /**< ASCII letters compare without case */
+    NAME_NATURAL = 1 << 1, /**< Runs of digits compare by value, file2 before file10 */
+    NAME_FOLD_UNICODE = 1 << 2, /**< Latin, Greek and Cyrillic letters compare without case too */
+    NAME_ORDER_DEFAULT = NAME_FOLD_CASE | NAME_NATURAL | NAME_FOLD_UNICODE /**< The order of the views */
+};
+
+/**
+ * @brief Appends the sort key of a name.
+ *
+ * The key is the folded name, then a 0 byte and the name itself, so keys
+ * only tie for equal names and a name sorts before its extensions. A run of
+ * digits becomes '0', its length without leading zeros and those digits, so
+ * at equal positions shorter numbers go first and a number sorts where a
+ * digit would among other characters.
+ *
+ * @param key The key, appended to.
+ * @param name The name.
+ * @param flags The NameOrderDef bits.
+ */
+void append_name_key(std::string &key, std::string_view name, unsigned flags = NAME_ORDER_DEFAULT);
+
+/**
+ * @brief Compares two names in the order of the views.
+ *
+ * Builds both keys, for occasional comparisons; sorts build the keys once
+ * with NameKeys or sort_by_name().
+ *
+ * @param a The first name.
+ * @param b The second name.
+ * @return true if @p a goes before @p b.
+ */
+bool name_less(std::string_view a, std::string_view b);
+
+/**
+ * @brief Sort keys of many names, packed in one buffer.
+ */
+class NameKeys
+{
+public:
+    /**
+     * @brief Reserves room for names.
+     * @param count The number of names.
+     * @param bytes Their total length.
+     */
+    void reserve(std::size_t count, std::size_t bytes);
+
+    /**
+     * @brief Appends the key of a name.
+     * @param name The name.
+     * @param flags The NameOrderDef bits.
+     */
+    void add(std::string_view name, unsigned flags = NAME_ORDER_DEFAULT);
+
+    /**
+     * @brief Gets a key.
+     * @param index The index of the name, in the order added.
+     * @return The key.
+     */
+    std::string_view key(std::size_t index) const
+    {
+        return std::string_view(buffer.data() + offsets[index], offsets[index + 1] - offsets[index]);
+    }
+
+    /**
+     * @brief Compares two keys.
+     * @param a The index of the first name.
+     * @param b The index of the second name.
+     * @return true if name @p a goes before name @p b.
+     */
+    bool less(std::size_t a, std::size_t b) const { return key(a) < key(b); }
+
+private:
+    std::string buffer; /**< The keys, one after the other. */
+    std::vector<uint32_t> offsets = {0}; /**< Offset of every key in the buffer, then the end of the last one. */
+};
+
+/**
+ * @brief Sorts items by name, in the order of the views.
+ *
+ * Every name is turned into a key once, then the keys are sorted by index
+ * and the items moved into place.
+ *
+ * @tparam T The type of the items.
+ * @tparam GetName Returns the name of an item, as something convertible to std::string_view.
+ * @param items The items.
+ * @param get_name Gets the name of an item.
+ */
+template <typename T, typename GetName>
+void sort_by_name(std::vector<T> &items, GetName get_name);
+
+#include "myCollate.tpp"
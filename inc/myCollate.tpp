@@ -0,0 +1,46 @@
+/**
+ ******************************************************************************
+ * @file    myCollate.tpp
+ * @brief   Implementation of the sort_by_name() template.
+ * @author  Arun, Sagar, Saurav
+ * @date    March 7, 2024
+ ******************************************************************************
+ */
+
+#include "myCollate.hpp"
+#include <algorithm>
+#include <numeric>
+#include <utility>
+
+template <typename T, typename GetName>
+void sort_by_name(std::vector<T> &items, GetName get_name)
+{
+    std::size_t count = items.size();
+    if (count < 2)
+        return;
+
+    std::size_t bytes = 0;
+    for (const T &item : items)
+    {
+        bytes += std::string_view(get_name(item)).size();
+    }
+    NameKeys keys;
+    keys.reserve(count, bytes);
+    for (const T &item : items)
+    {
+        keys.add(get_name(item));
+    }
+
+    std::vector<uint32_t> order(count);
+    std::iota(order.begin(), order.end(), 0);
+    std::sort(order.begin(), order.end(), [&keys](uint32_t a, uint32_t b)
+              { return keys.less(a, b); });
+
+    std::vector<T> sorted;
+    sorted.reserve(count);
+    for (uint32_t index : order)
+    {
+        sorted.push_back(std::move(items[index]));
+    }
+    items = std::move(sorted);
+}
@@ -9,65 +9,84 @@
 
 #pragma once
 
-#include <string>
+#include "myEntry.hpp"
+#include <string_view>
 
 /**
  * @brief ANSI color escape codes for text formatting.
  *
- * These escape codes are used to format text with colors.
+ * These escape codes are used to format text with colors. They are constant
+ * byte spans written straight into the output buffer, no string is built.
  */
-const std::string COLOR_RED             = "\033[91m";
-const std::string COLOR_GREEN           = "\033[92m";
-const std::string COLOR_YELLOW          = "\033[93m";
-const std::string COLOR_BLUE            = "\033[94m";
-const std::string COLOR_MAGENTA         = "\033[95m";
-const std::string COLOR_CYAN            = "\033[96m";
-const std::string COLOR_WHITE           = "\033[97m";
-const std::string COLOR_BRIGHT_BLACK    = "\033[90m";
-const std::string COLOR_FAINT_RED       = "\033[2;91m";
-const std::string COLOR_FAINT_GREEN     = "\033[2;92m";
-const std::string COLOR_FAINT_YELLOW    = "\033[2;93m";
-const std::string COLOR_FAINT_BLUE      = "\033[2;94m";
-const std::string COLOR_FAINT_MAGENTA   = "\033[2;95m";
-const std::string COLOR_FAINT_CYAN      = "\033[2;96m";
-const std::string COLOR_FAINT_WHITE     = "\033[2;97m";
-const std::string COLOR_RESET           = "\033[0m";
+constexpr std::string_view COLOR_RED               = "\033[91m";
+constexpr std::string_view COLOR_GREEN             = "\033[92m";
+constexpr std::string_view COLOR_YELLOW            = "\033[93m";
+constexpr std::string_view COLOR_BLUE              = "\033[94m";
+constexpr std::string_view COLOR_MAGENTA           = "\033[95m";
+constexpr std::string_view COLOR_CYAN              = "\033[96m";
+constexpr std::string_view COLOR_WHITE             = "\033[97m";
+constexpr std::string_view COLOR_BRIGHT_BLACK      = "\033[90m";
+constexpr std::string_view COLOR_FAINT_RED         = "\033[2;91m";
+constexpr std::string_view COLOR_FAINT_GREEN       = "\033[2;92m";
+constexpr std::string_view COLOR_FAINT_YELLOW      = "\033[2;93m";
+constexpr std::string_view COLOR_FAINT_BLUE        = "\033[2;94m";
+constexpr std::string_view COLOR_FAINT_MAGENTA     = "\033[2;95m";
+constexpr std::string_view COLOR_FAINT_CYAN        = "\033[2;96m";
+constexpr std::string_view COLOR_FAINT_WHITE       = "\033[2;97m";
+constexpr std::string_view COLOR_RESET             = "\033[0m";
 
 /**
  * @brief Color variables for file types.
  *
  * These variables define colors for different types of files and folders.
  */
-const std::string COLOR_FOLDER              = COLOR_YELLOW;            /**< Color for regular folders */
-const std::string COLOR_HIDDEN_FOLDER       = COLOR_FAINT_YELLOW;     /**< Color for hidden folders */
-const std::string COLOR_FILE                = COLOR_BLUE;              /**< Color for regular files */
-const std::string COLOR_HIDDEN_FILE         = COLOR_FAINT_BLUE;       /**< Color for hidden files */
-const std::string COLOR_EXECUTABLE          = COLOR_RED;               /**< Color for executable files */
-const std::string COLOR_HIDDEN_EXECUTABLE   = COLOR_FAINT_RED;        /**< Color for hidden executable files */
+constexpr std::string_view COLOR_FOLDER            = COLOR_YELLOW;       /**< Color for regular folders */
+constexpr std::string_view COLOR_HIDDEN_FOLDER     = COLOR_FAINT_YELLOW; /**< Color for hidden folders */
+constexpr std::string_view COLOR_FILE              = COLOR_BLUE;         /**< Color for regular files */
+constexpr std::string_view COLOR_HIDDEN_FILE       = COLOR_FAINT_BLUE;   /**< Color for hidden files */
+constexpr std::string_view COLOR_EXECUTABLE        = COLOR_RED;          /**< Color for executable files */
+constexpr std::string_view COLOR_HIDDEN_EXECUTABLE = COLOR_FAINT_RED;    /**< Color for hidden executable files */
 
 /**
  * @brief Color variables for bars and text
  */
-const std::string COLOR_BAR  = COLOR_GREEN;
-const std::string COLOR_TEXT = COLOR_CYAN;
+constexpr std::string_view COLOR_BAR               = COLOR_GREEN;
+constexpr std::string_view COLOR_TEXT              = COLOR_CYAN;
 
 /**
  * @brief Print colored text to the console.
  *
- * This function prints the given text in the specified color.
+ * This function prints the given text in the specified color. The escape codes
+ * are left out when the output sink has colors disabled.
  *
  * @param text The text to be printed.
  * @param color The color to be used for printing.
  */
-void print_colored_text(const std::string &text, const std::string &color);
+void print_colored_text(std::string_view text, std::string_view color);
 
 /**
- * @brief Get the color for a file based on its name and visibility.
+ * @brief Get the color for a file from its type, permission bits and name.
  *
- * This function determines the appropriate color for a file based on its name and visibility.
+ * Directories and executables get their colors first, whatever their name;
+ * other regular files get the color of their extension, if it has one. The
+ * extension colors come from LS_COLORS when it is set, otherwise from a table
+ * compiled in. No system call is made.
  *
- * @param filename The name of the file.
+ * @param type The entry type, symbolic links resolved.
+ * @param is_executable Whether an executable bit is set.
  * @param is_hidden A boolean indicating whether the file is hidden or not.
+ * @param name The name of the file, for its extension.
  * @return The color code for the file.
  */
-std::string get_file_color(const std::string &filename, bool is_hidden);
+std::string_view get_file_color(EntryTypeDef type, bool is_executable, bool is_hidden, std::string_view name = {});
+
+/**
+ * @brief Get the color for a directory entry from its cached metadata.
+ *
+ * Regular files must have been stat-ed for the executable bits to be known.
+ *
+ * @param entry The cached metadata of the entry.
+ * @param is_hidden A boolean indicating whether the file is hidden or not.
+ * @return The color code for the entry.
+ */
+std::string_view get_file_color(const EntryInfo &entry, bool is_hidden);
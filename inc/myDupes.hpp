@@ -0,0 +1,57 @@
+/**
+ ******************************************************************************
+ * @file    myDupes.hpp
+ * @brief   Declarations of the duplicate-file view: files with identical
+ *          contents, found by size, then by their first and last blocks, and
+ *          only then by a hash of their whole contents.
+ * @author  Arun, Sagar, Saurav
+ * @date    March 7, 2024
+ ******************************************************************************
+ */
+
+#pragma once
+
+#include "myWalk.hpp"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+constexpr std::size_t DUPES_EDGE_SIZE = 4096; /**< Bytes hashed at each end of a file in the second stage. */
+constexpr std::size_t DUPES_READ_SIZE = 1 << 20; /**< Size of the sequential reads of the full hash. */
+
+/**
+ * @brief Files with identical contents.
+ */
+struct DupeGroup
+{
+    uint64_t size; /**< The size of every file of the group. */
+    std::vector<std::string> paths; /**< The paths relative to the walked directory, sorted, one per inode. */
+};
+
+/**
+ * @brief Finds the files with identical contents below a directory.
+ *
+ * The subtree is walked in parallel and the regular, non-empty files are
+ * grouped by size. Files of a size shared by several inodes are hashed on
+ * their first and last DUPES_EDGE_SIZE bytes, and the files that still
+ * collide are hashed in full, each in large sequential reads, by all the
+ * walker threads. Files whose hashes match are then compared byte by byte
+ * with the first file of their group, so a group only ever holds files with
+ * identical contents, whatever the hash collisions. Hard links are one file, named by the first of their paths
+ * in name order. Symbolic links are not followed, hidden entries are skipped
+ * unless show_hidden.
+ *
+ * @param path The path to the directory.
+ * @param options The scan options (jobs, show_hidden, one_file_system, filter).
+ * @param groups Set to the groups, the most space wasted first.
+ * @return true on success, false with a message on the error stream if @p path is not a directory.
+ */
+bool find_duplicates(const std::string &path, const ScanOptions &options, std::vector<DupeGroup> &groups);
+
+/**
+ * @brief Prints the groups of duplicate files below a directory.
+ * @param path The path to the directory.
+ * @param options The scan options.
+ * @return true on success, false with a message on the error stream if @p path is not a directory.
+ */
+bool print_dupes(const std::string &path, const ScanOptions &options);
@@ -0,0 +1,144 @@
+/**
+ ******************************************************************************
+ * @file    myEntry.hpp
+ * @brief   Declarations of the shared directory entry metadata layer.
+ *          Directory entries are read once with their type from dirent::d_type,
+ *          and stat-ed lazily, at most once, relative to the open directory.
+ * @author  Arun, Sagar, Saurav
+ * @date    March 7, 2024
+ ******************************************************************************
+ */
+
+#pragma once
+
+#include "myTypeDef.h"
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+#include <dirent.h>
+#include <sys/stat.h>
+
+/**
+ * @brief Cached metadata of one directory entry.
+ *
+ * Only name and type are filled by reading the directory. The remaining fields
+ * are valid once has_stat is true.
+ */
+struct EntryInfo
+{
+    std::string name; /**< The name of the entry. */
+    EntryTypeDef type = ENTRY_UNKNOWN; /**< The entry type, symlinks resolved once stat-ed. */
+    bool is_symlink = false; /**< Whether the entry itself is a symbolic link. */
+    bool has_stat = false; /**< Whether the fields below are valid. */
+    bool stat_failed = false; /**< Whether the stat was attempted and failed. */
+    uint32_t mode = 0; /**< The st_mode bits. */
+    uint32_t nlink = 0; /**< The number of hard links. */
+    uint64_t size = 0; /**< The apparent size in bytes. */
+    uint64_t blocks = 0; /**< The allocated size in 512-byte blocks. */
+    int64_t mtime_ns = 0; /**< The modification time in nanoseconds since the epoch. */
+    uint64_t ino = 0; /**< The inode number. */
+    uint64_t dev = 0; /**< The device number. */
+};
+
+/**
+ * @brief Reads the entries of one directory and stats them on demand.
+ *
+ * The directory stays open for the lifetime of the reader so that entries are
+ * stat-ed with fstatat() relative to it instead of resolving the full path.
+ */
+class DirectoryReader
+{
+public:
+    std::vector<EntryInfo> entries; /**< The entries, without "." and "..", in readdir order. */
+
+    /**
+     * @brief Constructor. Opens and reads the directory.
+     * @param directory The path to the directory.
+     */
+    explicit DirectoryReader(const std::string &directory);
+
+    /**
+     * @brief Destructor. Closes the directory and publishes the stat counter.
+     */
+    ~DirectoryReader();
+
+    DirectoryReader(const DirectoryReader &) = delete;
+    DirectoryReader &operator=(const DirectoryReader &) = delete;
+
+    /**
+     * @brief Checks whether the directory could be opened.
+     * @return true if the directory was read, false otherwise.
+     */
+    bool is_open() const;
+
+    /**
+     * @brief Gets the errno of a failed open.
+     * @return The error number, 0 if the directory was opened.
+     */
+    int error() const;
+
+    /**
+     * @brief Stats an entry unless it was already stat-ed.
+     * @param entry The entry, which must belong to this reader.
+     * @param follow_links Whether to stat the target of a symbolic link.
+     * @return true if the metadata fields are valid, false otherwise.
+     */
+    bool stat(EntryInfo &entry, bool follow_links = true);
+
+    /**
+     * @brief Stats every entry not stat-ed yet, as one batch when the directory is large enough.
+     *
+     * On network and FUSE file systems a batch costs about one round trip
+     * instead of one per entry, see configure_batch_stat().
+     *
+     * @param follow_links Whether to stat the targets of symbolic links.
+     * @param wanted Optional filter selecting the entries to stat.
+     */
+    void stat_all(bool follow_links = true, const std::function<bool(const EntryInfo &)> &wanted = nullptr);
+
+    /**
+     * @brief Resolves the type of an entry, stat-ing it only when d_type was not enough.
+     * @param entry The entry, which must belong to this reader.
+     * @return The type of the entry, symbolic links followed.
+     */
+    EntryTypeDef resolve_type(EntryInfo &entry);
+
+private:
+    /**
+     * @brief Stats entries, as one batch when there are enough of them.
+     * @param pending The entries, none of them of unknown type when links are followed.
+     * @param follow_links Whether to stat the targets of symbolic links.
+     */
+    void stat_batch(const std::vector<EntryInfo *> &pending, bool follow_links);
+
+    DIR *dir; /**< The open directory stream. */
+    int open_error; /**< The errno of a failed open. */
+    uint64_t stat_calls; /**< Number of stat calls made through this reader. */
+};
+
+/**
+ * @brief Calls stat or lstat on a path, counted and timed for --stats.
+ * @param path The path.
+ * @param st Receives the metadata.
+ * @param follow_links Whether to stat the target of a symbolic link.
+ * @return 0 on success, -1 with errno set otherwise.
+ */
+int timed_stat(const std::string &path, struct stat &st, bool follow_links = true);
+
+/**
+ * @brief Stats a single path, for entries that are not read through a DirectoryReader.
+ * @param path The full path of the entry.
+ * @param entry The entry receiving the metadata; its name is left untouched.
+ * @param follow_links Whether to stat the target of a symbolic link.
+ * @return true if the metadata fields are valid, false otherwise.
+ */
+bool stat_path(const std::string &path, EntryInfo &entry, bool follow_links = true);
+
+/**
+ * @brief Gets the error message of a failed directory open.
+ * @param directory The path to the directory.
+ * @param error The errno value.
+ * @return The error message.
+ */
+std::string directory_error(const std::string &directory, int error);
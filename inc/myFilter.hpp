@@ -0,0 +1,229 @@
+/**
+ ******************************************************************************
+ * @file    myFilter.hpp
+ * @brief   Declarations of the traversal-time path filter.
+ *          --exclude/--include globs and .gitignore rules are compiled once into
+ *          glob automata and applied to every directory listing, so excluded
+ *          subtrees are never opened.
+ * @author  Arun, Sagar, Saurav
+ * @date    March 7, 2024
+ ******************************************************************************
+ */
+
+#pragma once
+
+#include "myEntry.hpp"
+#include <bitset>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/**
+ * @brief A set of glob patterns matched together by one automaton.
+ *
+ * Every pattern is compiled into a chain of NFA states, and a text is matched
+ * by advancing the set of active states of all patterns one character at a
+ * time (Thompson's construction), so matching is linear in the length of the
+ * text and never backtracks.
+ *
+ * Supported syntax: `*` (anything but '/'), `?`, `[a-z]`, `[!a-z]`, `\\x`,
+ * `**` (anything, '/' included) and `**` followed by '/' (zero or more directories).
+ */
+class GlobSet
+{
+public:
+    /**
+     * @brief Compiles a pattern into the set.
+     * @param pattern The glob pattern, matched against the whole text.
+     * @param directory_only Whether the pattern only matches directories.
+     * @return The index of the pattern, in order of addition.
+     */
+    std::size_t add(std::string_view pattern, bool directory_only = false);
+
+    /**
+     * @brief Checks whether the set has no pattern.
+     * @return true if no pattern was added.
+     */
+    bool empty() const { return starts.empty(); }
+
+    /**
+     * @brief Finds the last added pattern matching a text.
+     * @param text The text, a name or a relative path.
+     * @param is_directory Whether the text names a directory, for directory-only patterns.
+     * @return The index of the pattern, -1 if none matches.
+     */
+    long last_match(std::string_view text, bool is_directory) const;
+
+    /**
+     * @brief Checks whether any pattern matches a text.
+     * @param text The text, a name or a relative path.
+     * @param is_directory Whether the text names a directory.
+     * @return true if a pattern matches.
+     */
+    bool matches(std::string_view text, bool is_directory) const { return last_match(text, is_directory) >= 0; }
+
+private:
+    /**
+     * @brief Kinds of NFA states.
+     */
+    enum GlobStateDef : uint8_t
+    {
+        GLOB_LITERAL, /**< One given character */
+        GLOB_ANY, /**< '?', any character but '/' */
+        GLOB_CLASS, /**< '[...]', a character of a class, '/' excluded */
+        GLOB_STAR, /**< '*', any run of characters without '/' */
+        GLOB_GLOBSTAR, /**< '**', any run of characters */
+        GLOB_DIRS, /**< '**' followed by '/', zero or more leading directories */
+        GLOB_ACCEPT /**< End of a pattern */
+    };
+
+    /**
+     * @brief One NFA state. The next state of the chain is the following one.
+     */
+    struct GlobState
+    {
+        GlobStateDef kind; /**< The kind of state. */
+        unsigned char literal; /**< GLOB_LITERAL: the character. */
+        uint32_t data; /**< GLOB_CLASS: index in classes; GLOB_ACCEPT: the pattern. */
+    };
+
+    std::vector<GlobState> states; /**< The states of all patterns, chained. */
+    std::vector<std::bitset<256>> classes; /**< The character classes. */
+    std::vector<uint32_t> starts; /**< The first state of every pattern. */
+    std::vector<bool> directory_only; /**< Whether every pattern only matches directories. */
+
+    void activate(uint32_t state, std::vector<uint32_t> &active, std::vector<uint32_t> &marks, uint32_t generation) const;
+};
+
+/**
+ * @brief Outcomes of matching a path against .gitignore rules.
+ */
+enum IgnoreMatchDef
+{
+    IGNORE_NONE, /**< No rule matches */
+    IGNORE_EXCLUDED, /**< The last matching rule ignores the path */
+    IGNORE_KEPT /**< The last matching rule is a negated ("!") one */
+};
+
+/**
+ * @brief The rules of one .gitignore file.
+ */
+class IgnoreRules
+{
+public:
+    /**
+     * @brief Reads and compiles a .gitignore file.
+     * @param file The path to the file.
+     * @return true if the file had at least one rule.
+     */
+    bool load(const std::string &file);
+
+    /**
+     * @brief Matches a path against the rules, the last matching rule winning.
+     * @param relative The path relative to the directory of the file.
+     * @param name The last component of the path.
+     * @param is_directory Whether the path is a directory.
+     * @return The outcome.
+     */
+    IgnoreMatchDef match(std::string_view relative, std::string_view name, bool is_directory) const;
+
+    /**
+     * @brief Checks whether the file had no rule.
+     * @return true if there is no rule.
+     */
+    bool empty() const { return negated.empty(); }
+
+    /**
+     * @brief Checks whether some rule is matched against the relative path, not only the name.
+     * @return true if match() needs the relative path.
+     */
+    bool needs_path() const { return !paths.empty(); }
+
+private:
+    GlobSet names; /**< Rules without a '/', matched against the name at any depth. */
+    GlobSet paths; /**< Rules with a '/', matched against the relative path. */
+    std::vector<uint32_t> name_rules; /**< Rule number of every pattern of names. */
+    std::vector<uint32_t> path_rules; /**< Rule number of every pattern of paths. */
+    std::vector<bool> negated; /**< Whether every rule starts with '!'. */
+};
+
+/**
+ * @brief The .gitignore rules in effect for a directory and everything below it.
+ *
+ * Scopes are chained to the scope of the parent directory, and shared by all
+ * the subdirectories that add no .gitignore of their own.
+ */
+struct FilterScope
+{
+    std::shared_ptr<const FilterScope> parent; /**< The enclosing scope, or nullptr. */
+    std::size_t base_length = 0; /**< Length of the path of the directory the rules are relative to. */
+    std::size_t root_length = 0; /**< Length of the path of the walked root, for --exclude/--include paths. */
+    IgnoreRules rules; /**< The rules of the directory, possibly none. */
+};
+
+/**
+ * @brief The compiled --exclude, --include and --gitignore settings.
+ *
+ * Read-only once set up, so the walker threads share one filter.
+ */
+class PathFilter
+{
+public:
+    /**
+     * @brief Adds an --exclude glob. Matching files and directories are skipped.
+     *
+     * A glob without '/' matches names at any depth, one with '/' matches paths
+     * relative to the walked directory.
+     *
+     * @param glob The glob.
+     */
+    void exclude(const std::string &glob);
+
+    /**
+     * @brief Adds an --include glob. Files matching no include glob are skipped, directories are kept.
+     * @param glob The glob.
+     */
+    void include(const std::string &glob);
+
+    /**
+     * @brief Enables --gitignore: skips what .gitignore files ignore, and .git itself.
+     */
+    void use_gitignore();
+
+    /**
+     * @brief Checks whether the filter does anything.
+     * @return true if a glob was added or --gitignore enabled.
+     */
+    bool active() const;
+
+    /**
+     * @brief Gets the scope to walk a directory with.
+     *
+     * With --gitignore, the .gitignore files between the enclosing git work tree
+     * and @p path (excluded) are loaded, and .git/info/exclude.
+     *
+     * @param path The walked directory.
+     * @return The scope to pass to apply() for @p path.
+     */
+    std::shared_ptr<const FilterScope> root(const std::string &path) const;
+
+    /**
+     * @brief Removes the excluded entries of a directory listing.
+     * @param scope The scope of the parent directory (root() for the walked directory).
+     * @param directory The path of the listed directory.
+     * @param reader The listing; entries of unknown type are stat-ed without following links.
+     * @return The scope of the subdirectories of @p directory.
+     */
+    std::shared_ptr<const FilterScope> apply(const std::shared_ptr<const FilterScope> &scope, const std::string &directory, DirectoryReader &reader) const;
+
+private:
+    GlobSet excluded_names; /**< --exclude globs without '/'. */
+    GlobSet excluded_paths; /**< --exclude globs with '/'. */
+    GlobSet included_names; /**< --include globs without '/'. */
+    GlobSet included_paths; /**< --include globs with '/'. */
+    bool gitignore = false; /**< Whether --gitignore is on. */
+
+    bool is_excluded(const FilterScope &scope, const std::string &directory, std::string_view name, bool is_directory) const;
+};
@@ -0,0 +1,180 @@
+/**
+ ******************************************************************************
+ * @file    myIndex.hpp
+ * @brief   Declarations of the persistent scan index.
+ *          A scanned tree is saved as one binary file holding the node table, the
+ *          name pool and the metadata of every node. Later runs map the file and
+ *          only re-read the directories whose modification time changed.
+ * @author  Arun, Sagar, Saurav
+ * @date    March 7, 2024
+ ******************************************************************************
+ */
+
+#pragma once
+
+#include "myEntry.hpp"
+#include "myNodeStore.hpp"
+#include "myWalk.hpp"
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/**
+ * @brief Bits of IndexNode::flags.
+ */
+enum IndexFlagDef : uint8_t
+{
+    INDEX_SYMLINK = 1 << 0, /**< The node is a symbolic link; it is never descended into. */
+    INDEX_STAT_FAILED = 1 << 1 /**< The node could not be stat-ed; only its type is known. */
+};
+
+/**
+ * @brief One node of the index, stored as is in the index file.
+ *
+ * The children of a directory are contiguous and sorted by the bytes of their names. The metadata
+ * comes from lstat(), except type and mode, which follow symbolic links.
+ */
+struct IndexNode
+{
+    NodeId parent = NO_NODE; /**< The parent node. */
+    NodeId first_child = NO_NODE; /**< The first child. */
+    uint32_t child_count = 0; /**< Number of children. */
+    uint32_t name = 0; /**< Offset of the name in the name pool. */
+    uint8_t name_length = 0; /**< Length of the name. */
+    uint8_t type = ENTRY_UNKNOWN; /**< The EntryTypeDef, symbolic links followed. */
+    uint8_t flags = 0; /**< Combination of IndexFlagDef bits. */
+    uint8_t reserved = 0; /**< Padding, always zero. */
+    uint32_t mode = 0; /**< The st_mode bits, symbolic links followed. */
+    uint32_t nlink = 0; /**< The number of hard links. */
+    uint32_t reserved2 = 0; /**< Padding, always zero. */
+    uint64_t size = 0; /**< The apparent size in bytes. */
+    uint64_t blocks = 0; /**< The allocated size in 512-byte blocks. */
+    int64_t mtime_ns = 0; /**< The modification time in nanoseconds since the epoch. */
+    uint64_t ino = 0; /**< The inode number. */
+    uint64_t dev = 0; /**< The device number. */
+
+    /**
+     * @brief Checks if the node is a directory whose entries are in the index.
+     * @return true for directories that are not symbolic links, false otherwise.
+     */
+    bool is_directory() const { return type == ENTRY_DIRECTORY && !(flags & INDEX_SYMLINK); }
+};
+
+/**
+ * @brief A scanned tree saved in, and mapped from, an index file.
+ *
+ * The index always holds hidden entries, so one file serves runs with and
+ * without --all. It is read-only once loaded.
+ */
+class ScanIndex
+{
+public:
+    /**
+     * @brief Constructor. Creates an empty index.
+     */
+    ScanIndex();
+
+    /**
+     * @brief Destructor. Unmaps the index file.
+     */
+    ~ScanIndex();
+
+    ScanIndex(const ScanIndex &) = delete;
+    ScanIndex &operator=(const ScanIndex &) = delete;
+
+    /**
+     * @brief Loads an index file and brings it up to date with the file system.
+     *
+     * Directories whose modification time, inode or device changed are read
+     * again, all others are taken from the file. The file is rewritten only when
+     * something changed. A missing file, or one made for another root or other
+     * scan options, is replaced by a full scan.
+     *
+     * @param file The path to the index file.
+     * @param path The directory to serve, which must be the indexed root or below it.
+     * @param options The scan options.
+     * @return true if the index is usable, false if @p file is not an index or the tree
+     *         does not fit in one (an error is printed).
+     */
+    bool load(const std::string &file, const std::string &path, const ScanOptions &options);
+
+    /**
+     * @brief Scans a directory into memory, without an index file.
+     *
+     * Unlike load(), the scan applies the filter of @p options: filtered entries
+     * are left out of the index, which is why such an index is never saved.
+     *
+     * @param path The directory.
+     * @param options The scan options, the filter included.
+     * @return true if the index is usable, false if the tree does not fit (an error is printed).
+     */
+    bool scan(const std::string &path, const ScanOptions &options);
+
+    /**
+     * @brief Gets the path of the indexed root directory.
+     * @return The path.
+     */
+    const std::string &root() const { return root_path; }
+
+    /**
+     * @brief Gets the number of nodes.
+     * @return The number of nodes.
+     */
+    std::size_t size() const { return node_count; }
+
+    /**
+     * @brief Gets a node.
+     * @param id The node id.
+     * @return The node.
+     */
+    const IndexNode &node(NodeId id) const { return nodes[id]; }
+
+    /**
+     * @brief Gets the name of a node.
+     * @param id The node id.
+     * @return The name; the root path for the root node.
+     */
+    std::string_view name(NodeId id) const;
+
+    /**
+     * @brief Rebuilds the full path of a node from its ancestors.
+     * @param id The node id.
+     * @return The full path.
+     */
+    std::string path(NodeId id) const;
+
+    /**
+     * @brief Finds the node of a directory.
+     * @param path The path, the indexed root or below it.
+     * @return The node, or NO_NODE if the path is not an indexed directory.
+     */
+    NodeId find(const std::string &path) const;
+
+    /**
+     * @brief Converts the children of a directory to entries, as a DirectoryReader would fill them.
+     * @param directory The directory node.
+     * @param follow_links Whether the entries look stat-ed with links followed (tree, sort)
+     *        or not (size). Symbolic links are stat-ed again to follow them.
+     * @return The entries, in the byte order of their names.
+     */
+    std::vector<EntryInfo> entries(NodeId directory, bool follow_links) const;
+
+private:
+    std::string root_path; /**< The indexed root directory. */
+    bool one_file_system; /**< Whether the scan stayed on the root's file system. */
+    void *map; /**< The mapped index file, or nullptr. */
+    std::size_t map_size; /**< The size of the mapping. */
+    const IndexNode *nodes; /**< The node table, mapped or in node_buffer. */
+    const char *names; /**< The name pool, mapped or in name_buffer. */
+    std::size_t node_count; /**< Number of nodes. */
+    std::vector<IndexNode> node_buffer; /**< The node table after a refresh. */
+    std::string name_buffer; /**< The name pool after a refresh. */
+
+    bool map_file(const std::string &file, bool &is_index);
+    void unmap();
+    std::vector<uint8_t> check(unsigned jobs, bool &changed) const;
+    bool rebuild(const std::string &path, const std::vector<uint8_t> &changed, unsigned jobs, const PathFilter *filter = nullptr);
+    bool save(const std::string &file) const;
+    NodeId find_child(NodeId directory, std::string_view name) const;
+};
@@ -0,0 +1,183 @@
+/**
+ ******************************************************************************
+ * @file    myIterator.hpp
+ * @brief   Declaration of a lazy, pull-based iterator over the entries below a
+ *          directory. Directories are listed only when the walk reaches them,
+ *          so a caller that stops early does no more work than it used.
+ * @author  Arun, Sagar, Saurav
+ * @date    March 7, 2024
+ ******************************************************************************
+ */
+
+#pragma once
+
+#include "myEntry.hpp"
+#include "myFilter.hpp"
+#include "myWalk.hpp"
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Which entries an EntryIterator stats, as one batch per directory.
+ */
+enum IterStatDef
+{
+    ITER_STAT_TYPES, /**< Only the entries whose type the listing did not give, and symbolic links */
+    ITER_STAT_FILES, /**< Every entry but directories, for the mode bits */
+    ITER_STAT_ALL /**< Every entry */
+};
+
+/**
+ * @brief How an EntryIterator walks.
+ */
+struct IteratorOptions
+{
+    bool sorted = true; /**< Yield the entries of every directory sorted by name, otherwise in listing order. */
+    bool post_order = false; /**< Yield every opened directory a second time, after its entries. */
+    IterStatDef stat = ITER_STAT_TYPES; /**< Which entries are stat-ed. */
+    bool follow_links = true; /**< Whether stat follows symbolic links; links are never descended into. */
+};
+
+/**
+ * @brief Depth-first iterator over the entries below a directory.
+ *
+ * Pulls one entry at a time: next() lists a directory only when the walk
+ * enters it, so nothing is read ahead of the caller. Memory holds the
+ * listings of the directories on the current path, not the whole tree.
+ * Hidden entries, filtered entries and the depth and entry limits of the
+ * scan options are applied while listing. The root itself is not yielded.
+ *
+ * @code
+ * EntryIterator it(path, options);
+ * while (it.next())
+ *     if (it.entry().name == "node_modules")
+ *         it.skip();
+ * @endcode
+ */
+class EntryIterator
+{
+public:
+    /**
+     * @brief Constructor. Lists the root directory.
+     * @param root The path to the directory walked.
+     * @param options The scan options; jobs is ignored, the walk is sequential.
+     * @param iteration How to walk.
+     */
+    EntryIterator(const std::string &root, const ScanOptions &options, const IteratorOptions &iteration = IteratorOptions());
+
+    EntryIterator(const EntryIterator &) = delete;
+    EntryIterator &operator=(const EntryIterator &) = delete;
+
+    /**
+     * @brief Moves to the next entry, entering the current one first if it is a directory not skipped.
+     * @return true if there is an entry, false at the end of the walk.
+     */
+    bool next();
+
+    /**
+     * @brief Gets the current entry, valid until the next call to next().
+     * @return The entry.
+     */
+    EntryInfo &entry() const { return *current; }
+
+    /**
+     * @brief Gets the path of the directory holding the current entry.
+     * @return The root path, followed by the names of the directories entered.
+     */
+    const std::string &directory() const { return directory_path; }
+
+    /**
+     * @brief Gets the full path of the current entry.
+     * @return directory() followed by the name of the entry.
+     */
+    std::string path() const { return directory_path + "/" + current->name; }
+
+    /**
+     * @brief Gets the level of the current entry.
+     * @return 1 for the entries of the root, 2 for theirs, and so on.
+     */
+    unsigned depth() const { return current_depth; }
+
+    /**
+     * @brief Checks whether the current entry is the last one yielded from its directory.
+     * @return true for the last entry.
+     */
+    bool is_last() const { return current_last; }
+
+    /**
+     * @brief Checks whether the current entry is a directory yielded after its entries.
+     * @return true on the post-order visit, only with IteratorOptions::post_order.
+     */
+    bool leaving() const { return current_leaving; }
+
+    /**
+     * @brief Checks whether the current entry will be entered by the next call to next().
+     * @return true for a directory that is not a link, not skipped and within the limits.
+     */
+    bool will_enter() const { return descend; }
+
+    /**
+     * @brief Leaves the current directory entry unopened; its entries are never listed.
+     */
+    void skip() { descend = false; }
+
+    /**
+     * @brief Ends the walk: the next call to next() returns false.
+     */
+    void stop() { stopped = true; }
+
+    /**
+     * @brief Checks whether the entry limit of the scan options ended the walk.
+     * @return true if entries were left out, false if the walk was complete or stopped.
+     */
+    bool limited() const { return limit_reached; }
+
+    /**
+     * @brief Gets the number of entries yielded, post-order visits not counted.
+     * @return The number of entries.
+     */
+    uint64_t count() const { return yielded; }
+
+    /**
+     * @brief Gets the errno of a failed open of the root.
+     * @return The error number, 0 if the root was listed.
+     */
+    int error() const { return root_error; }
+
+    /**
+     * @brief Gets the filter scope of the subdirectories of the directory holding the current entry.
+     * @return The scope, nullptr without a filter.
+     */
+    const std::shared_ptr<const FilterScope> &scope() const { return stack.back().scope; }
+
+private:
+    /**
+     * @brief A directory of the current path.
+     */
+    struct Frame
+    {
+        std::vector<EntryInfo> entries; /**< The listed entries, in the order yielded. */
+        std::size_t next = 0; /**< Index of the next entry to yield. */
+        std::size_t path_length = 0; /**< The path length to restore when leaving the directory. */
+        std::shared_ptr<const FilterScope> scope; /**< The filter scope of the entries' subdirectories. */
+    };
+
+    ScanOptions options; /**< The scan options. */
+    IteratorOptions iteration; /**< How to walk. */
+    std::vector<Frame> stack; /**< The directories of the current path, the root first. */
+    std::string directory_path; /**< The path of the innermost directory. */
+    uint64_t root_dev = 0; /**< The device of the root, for options.one_file_system. */
+    EntryInfo *current = nullptr; /**< The current entry. */
+    unsigned current_depth = 0; /**< The level of the current entry. */
+    bool current_last = false; /**< Whether the current entry is the last of its directory. */
+    bool current_leaving = false; /**< Whether the current entry is a post-order visit. */
+    bool descend = false; /**< Whether next() enters the current entry. */
+    bool stopped = false; /**< Whether stop() was called or the walk ended. */
+    bool limit_reached = false; /**< Whether options.max_entries ended the walk. */
+    uint64_t yielded = 0; /**< Entries yielded, post-order visits not counted. */
+    int root_error = 0; /**< The errno of a failed open of the root. */
+
+    int list(Frame &frame, const std::shared_ptr<const FilterScope> &scope);
+};
@@ -0,0 +1,208 @@
+/**
+ ******************************************************************************
+ * @file    myNodeStore.hpp
+ * @brief   Declarations of the compact, arena-backed storage of directory tree nodes.
+ *          Nodes are fixed-size records linked by index, names are interned in one pool.
+ * @author  Arun, Sagar, Saurav
+ * @date    March 7, 2024
+ ******************************************************************************
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/**
+ * @brief Index of a node in a NodeStore.
+ */
+using NodeId = uint32_t;
+
+/**
+ * @brief Index used for "no node" (no parent, no child or no sibling).
+ */
+constexpr NodeId NO_NODE = 0xFFFFFFFF;
+
+/**
+ * @brief Bits of TreeNode::flags.
+ */
+enum NodeFlagDef : uint8_t
+{
+    NODE_FILE = 1 << 0, /**< The node is a regular file. */
+    NODE_DIRECTORY = 1 << 1, /**< The node is a directory (symbolic links followed). */
+    NODE_EXECUTABLE = 1 << 2, /**< The node has an executable bit set. */
+    NODE_LAST = 1 << 3, /**< The node is the last entry of its directory listing. */
+    NODE_HIDDEN = 1 << 4 /**< The node name starts with a dot. */
+};
+
+/**
+ * @brief Represents a node in a directory tree.
+ *
+ * A node is 20 bytes. It holds no strings: the name lives in the store's name
+ * pool and the full path is rebuilt on demand by walking the parent indices.
+ */
+struct TreeNode
+{
+    NodeId parent = NO_NODE; /**< The parent node. */
+    NodeId first_child = NO_NODE; /**< The first child, in sorted order. */
+    NodeId next_sibling = NO_NODE; /**< The next sibling, in sorted order. */
+    uint32_t name = 0; /**< Offset of the interned name in the name pool. */
+    uint8_t flags = 0; /**< Combination of NodeFlagDef bits. */
+
+    /**
+     * @brief Checks if the node is a regular file.
+     * @return true if the node is a file, false otherwise.
+     */
+    bool is_file() const { return flags & NODE_FILE; }
+
+    /**
+     * @brief Checks if the node is a leaf node (has no children).
+     * @return true if the node is a leaf node, false otherwise.
+     */
+    bool isLeaf() const { return first_child == NO_NODE; }
+};
+
+/**
+ * @brief Arena of tree nodes and interned names.
+ *
+ * Nodes and names are allocated in fixed-size chunks that never move, so a
+ * NodeId or name offset stays valid while other threads keep appending.
+ * Appending is thread-safe; reading is safe for nodes whose creation
+ * happened-before the read (e.g. after the walker finished).
+ */
+class NodeStore
+{
+public:
+    /**
+     * @brief Constructor. Creates an empty store.
+     */
+    NodeStore();
+
+    NodeStore(const NodeStore &) = delete;
+    NodeStore &operator=(const NodeStore &) = delete;
+
+    /**
+     * @brief Adds the root node.
+     * @param path The path of the root, used as its name.
+     * @return The id of the root node.
+     */
+    NodeId add_root(const std::string &path);
+
+    /**
+     * @brief Locks the store for a batch of add_child() calls.
+     * @return The lock, released when it goes out of scope.
+     */
+    std::unique_lock<std::mutex> lock();
+
+    /**
+     * @brief Appends a node as the next child of @p parent. The store must be locked.
+     * @param parent The parent node.
+     * @param previous The previously added child of @p parent, or NO_NODE for the first one.
+     * @param name The name of the new node.
+     * @param flags The NodeFlagDef bits of the new node.
+     * @return The id of the new node, NO_NODE if the store is full.
+     */
+    NodeId add_child(NodeId parent, NodeId previous, std::string_view name, uint8_t flags);
+
+    /**
+     * @brief Inserts a node among the children of @p parent, keeping them in name order. The store must be locked.
+     *
+     * NODE_LAST is set on the new node, and cleared on its predecessor, when it becomes the last child.
+     *
+     * @param parent The parent node.
+     * @param name The name of the new node.
+     * @param flags The NodeFlagDef bits of the new node, NODE_LAST ignored.
+     * @return The id of the new node, NO_NODE if the store is full.
+     */
+    NodeId insert_child(NodeId parent, std::string_view name, uint8_t flags);
+
+    /**
+     * @brief Unlinks a node, with its subtree, from its parent. The store must be locked.
+     *
+     * The nodes stay in the arena, unreachable. NODE_LAST moves to the new last child.
+     *
+     * @param id The node to unlink.
+     */
+    void remove_child(NodeId id);
+
+    /**
+     * @brief Finds a child by name, walking the sibling links.
+     * @param parent The parent node.
+     * @param name The name of the child.
+     * @return The child, or NO_NODE if there is none.
+     */
+    NodeId find_child(NodeId parent, std::string_view name) const;
+
+    /**
+     * @brief Gets a node.
+     * @param id The node id.
+     * @return The node.
+     */
+    TreeNode &node(NodeId id) { return node_chunks[id >> NODE_CHUNK_BITS][id & NODE_CHUNK_MASK]; }
+
+    /**
+     * @brief Gets a node.
+     * @param id The node id.
+     * @return The node.
+     */
+    const TreeNode &node(NodeId id) const { return node_chunks[id >> NODE_CHUNK_BITS][id & NODE_CHUNK_MASK]; }
+
+    /**
+     * @brief Gets the name of a node.
+     * @param id The node id.
+     * @return The interned name.
+     */
+    std::string_view name(NodeId id) const;
+
+    /**
+     * @brief Rebuilds the full path of a node from its ancestors.
+     * @param id The node id.
+     * @return The full path.
+     */
+    std::string path(NodeId id) const;
+
+    /**
+     * @brief Gets the number of nodes.
+     * @return The number of nodes.
+     */
+    std::size_t size() const { return node_count; }
+
+    /**
+     * @brief Gets the number of bytes used by the name pool.
+     * @return The number of bytes.
+     */
+    std::size_t name_bytes() const { return name_end; }
+
+    /**
+     * @brief Checks whether a node could not be added, its ids or its name pool being exhausted.
+     * @return true once add_child() or insert_child() returned NO_NODE.
+     */
+    bool full() const { return is_full.load(std::memory_order_relaxed); }
+
+private:
+    static constexpr unsigned NODE_CHUNK_BITS = 16; /**< 64K nodes per chunk. */
+    static constexpr uint32_t NODE_CHUNK_MASK = (1u << NODE_CHUNK_BITS) - 1;
+    static constexpr unsigned NAME_CHUNK_BITS = 20; /**< 1 MiB of names per chunk. */
+    static constexpr uint32_t NAME_CHUNK_MASK = (1u << NAME_CHUNK_BITS) - 1;
+    static constexpr uint32_t NO_NAME = 0xFFFFFFFF; /**< Offset returned when the name pool is full. */
+
+    std::mutex mutex; /**< Serialises appends. */
+    std::atomic<bool> is_full; /**< Whether a node could not be added. */
+    std::string root_name; /**< The name of the root, a path that may exceed a pool entry. */
+    std::vector<std::unique_ptr<TreeNode[]>> node_chunks; /**< Node arena, reserved up front so it never reallocates. */
+    std::vector<std::unique_ptr<char[]>> name_chunks; /**< Name pool, reserved up front so it never reallocates. */
+    std::size_t node_count; /**< Number of nodes. */
+    std::size_t name_end; /**< End of the used part of the name pool. */
+    std::vector<uint32_t> intern_table; /**< Open-addressing table of name offsets + 1 (0 is empty). */
+    std::size_t intern_count; /**< Number of distinct names. */
+
+    NodeId allocate(NodeId parent, std::string_view name, uint8_t flags);
+    uint32_t intern(std::string_view name);
+    uint32_t store_name(std::string_view name);
+    void grow_intern_table();
+};
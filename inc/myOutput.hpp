@@ -0,0 +1,172 @@
+/**
+ ******************************************************************************
+ * @file    myOutput.hpp
+ * @brief   Declarations of the buffered output sink shared by all views.
+ *          Output is collected in a large user-space buffer and written with few
+ *          system calls; color escapes are dropped when the output is not a terminal.
+ * @author  Arun, Sagar, Saurav
+ * @date    March 7, 2024
+ ******************************************************************************
+ */
+
+#pragma once
+
+#include <charconv>
+#include <cstdint>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+#include <unistd.h>
+
+/**
+ * @brief Buffered writer on a file descriptor.
+ *
+ * Nothing is written until the buffer is full, flush() is called or the sink
+ * is destroyed. The sink is not thread-safe.
+ */
+class Output
+{
+public:
+    /**
+     * @brief Constructor.
+     * @param fd The file descriptor to write to.
+     * @param capacity The size of the user-space buffer in bytes.
+     */
+    explicit Output(int fd = STDOUT_FILENO, std::size_t capacity = 256 * 1024);
+
+    /**
+     * @brief Destructor. Flushes the buffer.
+     */
+    ~Output();
+
+    Output(const Output &) = delete;
+    Output &operator=(const Output &) = delete;
+
+    /**
+     * @brief Appends raw bytes.
+     * @param data The bytes to append.
+     * @param size The number of bytes.
+     */
+    void write(const char *data, std::size_t size);
+
+    /**
+     * @brief Appends a color escape, or nothing when colors are disabled.
+     * @param code The escape sequence.
+     */
+    void color(std::string_view code);
+
+    /**
+     * @brief Appends @p count copies of a character.
+     * @param count The number of characters.
+     * @param c The character.
+     */
+    void pad(std::size_t count, char c = ' ');
+
+    /**
+     * @brief Writes the buffered bytes to the file descriptor.
+     */
+    void flush();
+
+    /**
+     * @brief Checks whether color escapes are written.
+     * @return true if colors are enabled, false otherwise.
+     */
+    bool colors() const { return use_colors; }
+
+    /**
+     * @brief Enables or disables color escapes.
+     * @param enabled Whether to write color escapes.
+     */
+    void set_colors(bool enabled) { use_colors = enabled; }
+
+    /**
+     * @brief Checks whether the file descriptor is a terminal.
+     * @return true if the output is a terminal, false otherwise.
+     */
+    bool is_terminal() const { return terminal; }
+
+    /**
+     * @brief Gets the width of the terminal.
+     *
+     * The columns of the terminal when TIOCGWINSZ reports them. Otherwise
+     * $COLUMNS when it holds a positive number, for pipes and files as well as
+     * for a terminal whose size cannot be read, and 80 without it.
+     *
+     * @return The number of columns.
+     */
+    int width() const;
+
+    /**
+     * @brief Gets the height of the terminal.
+     *
+     * The rows of the terminal when TIOCGWINSZ reports them. Otherwise
+     * $LINES when it holds a positive number, for pipes and files as well as
+     * for a terminal whose size cannot be read, and 24 without it.
+     *
+     * @return The number of rows.
+     */
+    int height() const;
+
+    /**
+     * @brief Gets the total number of bytes written to the file descriptor.
+     * @return The number of bytes.
+     */
+    uint64_t bytes_written() const { return written; }
+
+    /**
+     * @brief Appends text.
+     * @param text The text.
+     * @return This sink.
+     */
+    Output &operator<<(std::string_view text)
+    {
+        write(text.data(), text.size());
+        return *this;
+    }
+
+    /**
+     * @brief Appends a character.
+     * @param c The character.
+     * @return This sink.
+     */
+    Output &operator<<(char c)
+    {
+        if (used == buffer.size())
+            flush();
+        buffer[used++] = c;
+        return *this;
+    }
+
+    /**
+     * @brief Appends an integer in decimal without going through iostreams.
+     * @param value The integer.
+     * @return This sink.
+     */
+    template <typename T, typename = std::enable_if_t<std::is_integral_v<T> && !std::is_same_v<T, char> && !std::is_same_v<T, bool>>>
+    Output &operator<<(T value)
+    {
+        char digits[24];
+        auto result = std::to_chars(digits, digits + sizeof(digits), value);
+        write(digits, result.ptr - digits);
+        return *this;
+    }
+
+private:
+    int fd; /**< The file descriptor. */
+    bool terminal; /**< Whether fd is a terminal. */
+    bool use_colors; /**< Whether color escapes are written. */
+    std::vector<char> buffer; /**< The user-space buffer. */
+    std::size_t used; /**< Number of buffered bytes. */
+    uint64_t written; /**< Total bytes written to fd. */
+
+    void write_all(const char *data, std::size_t size);
+};
+
+/**
+ * @brief Gets the standard output sink used by all views.
+ *
+ * Colors are enabled when standard output is a terminal and NO_COLOR is unset or empty.
+ *
+ * @return The sink.
+ */
+Output &out();
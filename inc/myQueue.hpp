@@ -1,7 +1,8 @@
 /**
  ******************************************************************************
  * @file    myQueue.hpp
- * @brief   Definition of a templated queue data structure.
+ * @brief   Definition of a templated single-producer, single-consumer ring
+ *          buffer, handing elements from one thread to another without locks.
  * @author  Arun, Sagar, Saurav
  * @date    March 7, 2024
  ******************************************************************************
@@ -9,21 +10,28 @@
 
 #pragma once
 
+#include <atomic>
+#include <cstddef>
+#include <type_traits>
+
 /**
- * @brief Templated queue class.
+ * @brief Templated lock-free ring buffer for one producer and one consumer thread.
  *
- * This class implements a queue data structure using templates.
+ * The producer only calls is_full(), push() and push_n(), the consumer only
+ * is_empty(), pop() and pop_n(); size() may be called from either. The head and
+ * tail indexes grow without wrapping and sit on cache lines of their own, next
+ * to the copy of the other side's index each side reads first, so the threads
+ * only share a cache line when the ring looks full or empty to them. Elements
+ * are copied with memcpy, in at most two blocks per bulk call.
  *
- * @tparam T The type of elements stored in the queue.
- * @tparam MAX_SIZE The maximum capacity of the queue (default is 128).
+ * @tparam T The type of elements stored in the queue, trivially copyable.
+ * @tparam CAPACITY The maximum number of elements, a power of two (default is 128).
  */
-template <typename T, int MAX_SIZE = 128>
+template <typename T, std::size_t CAPACITY = 128>
 class Queue
 {
-private:
-    int front; /**< Index of the front element in the queue. */
-    int rear; /**< Index of the rear element in the queue. */
-    T items[MAX_SIZE]; /**< Array to store elements of the queue. */
+    static_assert(CAPACITY >= 2 && (CAPACITY & (CAPACITY - 1)) == 0, "the capacity is a power of two");
+    static_assert(std::is_trivially_copyable<T>::value, "elements are copied with memcpy");
 
 public:
     /**
@@ -33,40 +41,80 @@ public:
      */
     Queue();
 
+    Queue(const Queue &) = delete;
+    Queue &operator=(const Queue &) = delete;
+
     /**
-     * @brief Check if the queue is empty.
+     * @brief Check if the queue is empty. Consumer side.
      *
      * @return true if the queue is empty, false otherwise.
      */
-    bool is_empty();
+    bool is_empty() const;
 
     /**
-     * @brief Check if the queue is full.
+     * @brief Check if the queue is full. Producer side.
      *
      * @return true if the queue is full, false otherwise.
      */
-    bool is_full();
+    bool is_full() const;
+
+    /**
+     * @brief Get the number of elements, which the other thread may be changing.
+     *
+     * @return The number of elements.
+     */
+    std::size_t size() const;
+
+    /**
+     * @brief Get the maximum number of elements.
+     *
+     * @return CAPACITY.
+     */
+    static constexpr std::size_t capacity() { return CAPACITY; }
 
     /**
-     * @brief Add an element to the rear of the queue.
+     * @brief Add an element to the rear of the queue. Producer side.
      *
      * @param item The item to be added to the queue.
+     * @return true if the item was added, false if the queue is full.
      */
-    void enqueue(T item);
+    bool push(const T &item);
 
     /**
-     * @brief Remove and return the element from the front of the queue.
+     * @brief Remove the element from the front of the queue. Consumer side.
      *
-     * @return The element removed from the front of the queue.
+     * @param item Set to the element removed.
+     * @return true if an element was removed, false if the queue is empty.
      */
-    T dequeue();
+    bool pop(T &item);
 
     /**
-     * @brief Clear the queue.
+     * @brief Add as many elements as fit to the rear of the queue. Producer side.
      *
-     * Removes all elements from the queue.
+     * @param data The elements.
+     * @param count The number of elements.
+     * @return The number of elements added, from the first one.
      */
-    void clear();
+    std::size_t push_n(const T *data, std::size_t count);
+
+    /**
+     * @brief Remove up to @p count elements from the front of the queue. Consumer side.
+     *
+     * @param data Receives the elements.
+     * @param count The largest number of elements removed.
+     * @return The number of elements removed.
+     */
+    std::size_t pop_n(T *data, std::size_t count);
+
+private:
+    static constexpr std::size_t CACHE_LINE = 64; /**< Size of a cache line, to keep the two sides apart. */
+    static constexpr std::size_t MASK = CAPACITY - 1; /**< Turns an index into a position in the array. */
+
+    alignas(CACHE_LINE) std::atomic<std::size_t> head; /**< Index of the front element, written by the consumer. */
+    mutable std::size_t tail_cache; /**< The consumer's last reading of tail. */
+    alignas(CACHE_LINE) std::atomic<std::size_t> tail; /**< Index past the rear element, written by the producer. */
+    mutable std::size_t head_cache; /**< The producer's last reading of head. */
+    alignas(CACHE_LINE) T items[CAPACITY]; /**< Array to store elements of the queue. */
 };
 
 #include "myQueue.tpp"
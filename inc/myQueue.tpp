@@ -1,74 +1,109 @@
 /**
  ******************************************************************************
  * @file    myQueue.tpp
- * @brief   Implementation of the Queue class template for managing a queue data structure.
+ * @brief   Implementation of the Queue class template, a lock-free ring buffer.
  * @author  Arun, Sagar, Saurav
  * @date    March 7, 2024
  ******************************************************************************
  */
 
 #include "myQueue.hpp"
-#include <iostream>
+#include <algorithm>
+#include <cstring>
 
-template <typename T, int MAX_SIZE>
-Queue<T, MAX_SIZE>::Queue() : front(-1), rear(-1) {}
+template <typename T, std::size_t CAPACITY>
+Queue<T, CAPACITY>::Queue() : head(0), tail_cache(0), tail(0), head_cache(0) {}
 
-template <typename T, int MAX_SIZE>
-bool Queue<T, MAX_SIZE>::is_empty()
+template <typename T, std::size_t CAPACITY>
+bool Queue<T, CAPACITY>::is_empty() const
 {
-    return front == -1;
+    std::size_t front = head.load(std::memory_order_relaxed);
+    if (front != tail_cache)
+        return false;
+    tail_cache = tail.load(std::memory_order_acquire);
+    return front == tail_cache;
 }
 
-template <typename T, int MAX_SIZE>
-bool Queue<T, MAX_SIZE>::is_full()
+template <typename T, std::size_t CAPACITY>
+bool Queue<T, CAPACITY>::is_full() const
 {
-    return rear == MAX_SIZE - 1;
+    std::size_t rear = tail.load(std::memory_order_relaxed);
+    if (rear - head_cache < CAPACITY)
+        return false;
+    head_cache = head.load(std::memory_order_acquire);
+    return rear - head_cache == CAPACITY;
 }
 
-template <typename T, int MAX_SIZE>
-void Queue<T, MAX_SIZE>::enqueue(T item)
+template <typename T, std::size_t CAPACITY>
+std::size_t Queue<T, CAPACITY>::size() const
 {
-    if (is_full())
-    {
-        std::cout << "Queue is full. Enqueue operation blocked.\n";
-        return;
-    }
+    std::size_t front = head.load(std::memory_order_acquire);
+    return tail.load(std::memory_order_acquire) - front;
+}
 
-    if (is_empty())
+template <typename T, std::size_t CAPACITY>
+bool Queue<T, CAPACITY>::push(const T &item)
+{
+    std::size_t rear = tail.load(std::memory_order_relaxed);
+    if (rear - head_cache == CAPACITY)
     {
-        front = 0;
+        head_cache = head.load(std::memory_order_acquire);
+        if (rear - head_cache == CAPACITY)
+            return false;
     }
-
-    items[++rear] = item;
+    items[rear & MASK] = item;
+    tail.store(rear + 1, std::memory_order_release);
+    return true;
 }
 
-template <typename T, int MAX_SIZE>
-T Queue<T, MAX_SIZE>::dequeue()
+template <typename T, std::size_t CAPACITY>
+bool Queue<T, CAPACITY>::pop(T &item)
 {
-    if (is_empty())
+    std::size_t front = head.load(std::memory_order_relaxed);
+    if (front == tail_cache)
     {
-        std::cout << "Queue is empty. Cannot dequeue.\n";
-        return T(); // Return a default-initialized value
+        tail_cache = tail.load(std::memory_order_acquire);
+        if (front == tail_cache)
+            return false;
     }
+    item = items[front & MASK];
+    head.store(front + 1, std::memory_order_release);
+    return true;
+}
 
-    T item = items[front];
-
-    if (front == rear)
-    {
-        front = -1;
-        rear = -1;
-    }
-    else
-    {
-        ++front;
-    }
+template <typename T, std::size_t CAPACITY>
+std::size_t Queue<T, CAPACITY>::push_n(const T *data, std::size_t count)
+{
+    std::size_t rear = tail.load(std::memory_order_relaxed);
+    if (CAPACITY - (rear - head_cache) < count)
+        head_cache = head.load(std::memory_order_acquire); // Only read the consumer's line when the old reading is short
+    count = std::min(count, CAPACITY - (rear - head_cache));
+    if (count == 0)
+        return 0;
 
-    return item;
+    // The free space wraps around the end of the array at most once
+    std::size_t start = rear & MASK;
+    std::size_t first = std::min(count, CAPACITY - start);
+    std::memcpy(items + start, data, first * sizeof(T));
+    std::memcpy(items, data + first, (count - first) * sizeof(T));
+    tail.store(rear + count, std::memory_order_release);
+    return count;
 }
 
-template <typename T, int MAX_SIZE>
-void Queue<T, MAX_SIZE>::clear()
+template <typename T, std::size_t CAPACITY>
+std::size_t Queue<T, CAPACITY>::pop_n(T *data, std::size_t count)
 {
-    front = -1;
-    rear = -1;
+    std::size_t front = head.load(std::memory_order_relaxed);
+    if (tail_cache - front < count)
+        tail_cache = tail.load(std::memory_order_acquire); // Only read the producer's line when the old reading is short
+    count = std::min(count, tail_cache - front);
+    if (count == 0)
+        return 0;
+
+    std::size_t start = front & MASK;
+    std::size_t first = std::min(count, CAPACITY - start);
+    std::memcpy(data, items + start, first * sizeof(T));
+    std::memcpy(data + first, items, (count - first) * sizeof(T));
+    head.store(front + count, std::memory_order_release);
+    return count;
 }
@@ -0,0 +1,72 @@
+/**
+ ******************************************************************************
+ * @file    myRecord.hpp
+ * @brief   Declarations of the machine-readable output formats: one NDJSON
+ *          line or one binary record per entry, written as entries are found.
+ * @author  Arun, Sagar, Saurav
+ * @date    March 7, 2024
+ ******************************************************************************
+ */
+
+#pragma once
+
+#include "myTypeDef.h"
+#include "myEntry.hpp"
+#include "myWalk.hpp"
+#include <string>
+#include <string_view>
+#include <vector>
+
+constexpr std::string_view RECORD_MAGIC = "DIFOREC1"; /**< First 8 bytes of a binary stream. */
+constexpr std::size_t RECORD_HEADER_SIZE = 40; /**< Fixed part of a binary record, the path follows. */
+
+/**
+ * @brief Flags of a binary record.
+ */
+enum RecordFlagDef
+{
+    RECORD_SYMLINK = 1, /**< The entry is a symbolic link */
+    RECORD_STAT_FAILED = 2 /**< The entry could not be stat-ed, the numbers are 0 */
+};
+
+/**
+ * @brief Appends the record of one entry to a buffer.
+ *
+ * NDJSON: `{"path":...,"type":...,"size":...,"blocks":...,"mtime_ns":...,"inode":...}`
+ * and a newline. Bytes of the path that are not valid UTF-8 become U+FFFD.
+ *
+ * Binary, all integers little-endian: u32 path length, u8 type (EntryTypeDef),
+ * u8 flags (RecordFlagDef), u16 reserved, u64 size, u64 blocks, i64 mtime_ns,
+ * u64 inode, then the raw bytes of the path.
+ *
+ * @param buffer The buffer.
+ * @param format FORMAT_NDJSON or FORMAT_BIN.
+ * @param path The path of the entry.
+ * @param entry The entry.
+ */
+void encode_record(std::string &buffer, OutputFormatDef format, std::string_view path, const EntryInfo &entry);
+
+/**
+ * @brief Writes the records of a list of entries, in order.
+ *
+ * Used by the size view, with the recursive sizes in the entries, and by the sort view.
+ *
+ * @param entries The entries.
+ * @param show_hidden Whether to include hidden entries.
+ * @param format FORMAT_NDJSON or FORMAT_BIN.
+ */
+void print_records(const std::vector<EntryInfo> &entries, bool show_hidden, OutputFormatDef format);
+
+/**
+ * @brief Writes the records of every entry below a directory, as the walk finds them.
+ *
+ * The walk is parallel and keeps nothing once a directory is written, so memory
+ * does not grow with the tree. The entries of one directory are written together;
+ * the directories come in the order the walker visits them.
+ *
+ * @param path The path to the directory; record paths are relative to it.
+ * @param options The scan options, depth and entry limits included.
+ * @param format FORMAT_NDJSON or FORMAT_BIN.
+ * @return true on success, false with a message on the error stream if @p path is not a directory.
+ */
+bool print_tree_records(const std::string &path, const ScanOptions &options, OutputFormatDef format);
@@ -1,7 +1,7 @@
 /**
  ******************************************************************************
  * @file    mySize.hpp
- * @brief   Declarations of functions for printing directory sizes and drawing size bars.
+ * @brief   Declarations of functions for computing recursive disk usage and drawing size bars.
  * @author  Arun, Sagar, Saurav
  * @date    March 7, 2024
  ******************************************************************************
@@ -9,25 +9,101 @@
 
 #pragma once
 
+#include "myEntry.hpp"
+#include "myFilter.hpp"
+#include "myIndex.hpp"
+#include "myTypeDef.h"
+#include "myWalk.hpp"
+#include <cstdint>
+#include <memory>
 #include <string>
+#include <vector>
 
 /**
- * @brief Print the size of a directory.
+ * @brief Recursive size of a file or directory.
+ */
+struct DiskUsage
+{
+    uint64_t apparent = 0; /**< Sum of st_size, in bytes. */
+    uint64_t allocated = 0; /**< Sum of st_blocks, in bytes. */
+};
+
+/**
+ * @brief Compute the recursive disk usage of the entries of a directory.
  *
- * This function prints the size of the specified directory.
+ * Subdirectories are walked in parallel. Symbolic links are not followed and
+ * files with several hard links are counted only once, like du does, under
+ * the first top-level entry by name. With options.one_file_system, mount
+ * points are neither counted nor entered, like du -x.
  *
  * @param directory The path to the directory.
- * @param max_size The maximum size to consider.
- * @param show_hidden Whether to include hidden files and directories in the size calculation.
+ * @param entries The entries of the directory, already stat-ed without following links.
+ * @param root_dev The device of @p directory, used by options.one_file_system.
+ * @param options The scan options; hidden entries of @p directory are skipped unless
+ *        options.show_hidden, hidden entries below them are always counted.
+ * @param scope The filter scope of the subdirectories of @p directory, when options.filter is set.
+ * @return The disk usage of every entry, in the same order as @p entries.
+ */
+std::vector<DiskUsage> disk_usage(const std::string &directory, const std::vector<EntryInfo> &entries, uint64_t root_dev, const ScanOptions &options,
+                                  const std::shared_ptr<const FilterScope> &scope = nullptr);
+
+/**
+ * @brief Compute the recursive disk usage of the children of an indexed directory.
+ *
+ * Same rules as disk_usage(), summed from the index without touching the file system.
+ *
+ * @param index The loaded index.
+ * @param directory The node of the directory.
+ * @param options The scan options.
+ * @return The disk usage of every child, in the same order as ScanIndex::entries().
+ */
+std::vector<DiskUsage> disk_usage(const ScanIndex &index, NodeId directory, const ScanOptions &options);
+
+/**
+ * @brief Lists a directory and computes the recursive disk usage of its entries.
+ * @param path The path to the directory.
+ * @param options The scan options; the depth and entry limits are ignored.
+ * @param entries Set to the entries of the directory, hidden ones left out unless options.show_hidden.
+ * @param usage Set to the disk usage of every entry, in the same order as @p entries.
+ * @return 0 on success, the errno of opening @p path otherwise.
+ */
+int directory_usage(const std::string &path, const ScanOptions &options, std::vector<EntryInfo> &entries, std::vector<DiskUsage> &usage);
+
+/**
+ * @brief Print the size of a directory.
+ *
+ * This function prints one bar per entry, scaled to the biggest entry.
+ *
+ * @param entries The entries of the directory.
+ * @param usage The recursive disk usage of every entry.
+ * @param show_hidden Whether to include hidden files and directories.
+ * @param apparent_size Whether the bars show the apparent size instead of the allocated size.
  */
-void print_size(const std::string &directory, long long max_size, bool show_hidden);
+void print_size(const std::vector<EntryInfo> &entries, const std::vector<DiskUsage> &usage, bool show_hidden, bool apparent_size);
 
 /**
  * @brief Draw a size bar for a directory.
  *
- * This function draws a visual representation of the size of the specified directory.
+ * This function draws a visual representation of the recursive size of every entry
+ * of the specified directory.
  *
- * @param show_hidden Whether to include hidden files and directories in the size calculation.
  * @param path The path to the directory.
+ * @param options The scan options.
+ * @param apparent_size Whether the bars show the apparent size instead of the allocated size.
+ * @param format The output format; records carry the recursive sizes.
+ * @return true on success, false with a message on the error stream if @p path is not a directory.
+ */
+bool draw_size_bar(const std::string &path, const ScanOptions &options, bool apparent_size = false, OutputFormatDef format = FORMAT_TEXT);
+
+/**
+ * @brief Draw a size bar for an indexed directory.
+ *
+ * The entries are listed in the same order as a live scan of the directory.
+ *
+ * @param index The loaded index.
+ * @param directory The node of the directory.
+ * @param options The scan options.
+ * @param apparent_size Whether the bars show the apparent size instead of the allocated size.
+ * @param format The output format; records carry the recursive sizes.
  */
-void draw_size_bar(bool show_hidden, const std::string &path);
+void draw_size_bar(const ScanIndex &index, NodeId directory, const ScanOptions &options, bool apparent_size = false, OutputFormatDef format = FORMAT_TEXT);
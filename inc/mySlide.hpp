@@ -11,6 +11,7 @@
 
 #pragma once
 
+#include <cstdint>
 #include <string>
 
 /**
@@ -19,7 +20,12 @@
  * This function reads the content from the specified file and prints it line by line 
  * with a sliding effect controlled by the slide speed parameter.
  *
- * @param file_path The path to the file containing the content to be printed.
- * @param slide_speed The speed of the sliding animation, in seconds per line.
+ * Regular files are mapped, other inputs such as pipes are read in chunks by a
+ * thread. Characters are UTF-8, a multibyte one is written whole.
+ *
+ * @param file_path The path to the file containing the content to be printed, "-" for the standard input.
+ * @param slide_speed The speed of the sliding animation, 1.0 being one character per 20ms.
+ * @param from_offset The number of bytes skipped at the start, without reading them when the input can seek.
+ * @return true on success, false with a message on the error stream if the file cannot be opened or read.
  */
-void print_content_with_slide(const std::string &file_path, float slide_speed);
+bool print_content_with_slide(const std::string &file_path, float slide_speed, uint64_t from_offset = 0);
@@ -2,7 +2,7 @@
  ******************************************************************************
  * @file    mySort.hpp
  * @brief   Declarations of functions for sorting files and directories based on specified criteria.
- *          Includes functions for case-insensitive string comparison and sorting files in a directory.
+ *          Includes functions for sorting files in a directory.
  *          Sorting can be done based on various criteria such as file name, size, or modification time.
  * @author  Arun, Sagar, Saurav
  * @date    March 7, 2024
@@ -12,20 +12,11 @@
 #pragma once
 
 #include "myColors.hpp"
+#include "myEntry.hpp"
+#include "myFilter.hpp"
 #include "myTypeDef.h"
+#include <cstdint>
 #include <vector>
-#include <functional>
-
-/**
- * @brief Case-insensitive comparison of two strings.
- *
- * This function performs a case-insensitive comparison of two strings.
- *
- * @param a The first string.
- * @param b The second string.
- * @return true if strings are equal (case-insensitive), false otherwise.
- */
-bool caseInsensitiveCompare(const std::string &a, const std::string &b);
 
 /**
  * @brief Format size in human-readable format.
@@ -38,42 +29,145 @@ bool caseInsensitiveCompare(const std::string &a, const std::string &b);
 std::string format_size(double size);
 
 /**
- * @brief Merge two sorted subarrays into one sorted array.
+ * @brief Sort key of one directory entry, filled by a single stat.
+ *
+ * Records are compared by index, so the entries themselves are never moved
+ * while sorting.
+ */
+struct SortKey
+{
+    uint64_t size; /**< The size in bytes. */
+    int64_t mtime_ns; /**< The modification time in nanoseconds. */
+    uint32_t name_offset; /**< Offset of the name sort key in the key buffer. */
+    uint32_t name_length; /**< Length of the name sort key. */
+};
+
+/**
+ * @brief Comparator of sort key indices, specialised at compile time.
+ *
+ * Size and time ties are broken by the name sort key, which only ties for equal names.
+ *
+ * @tparam Type The sort criterion.
+ * @tparam Order The sort order; DESC swaps the operands, so equal keys keep their order.
+ */
+template <SortTypeDef Type, SortOrderDef Order>
+struct SortKeyLess
+{
+    const SortKey *keys; /**< The key records. */
+    const char *names; /**< The name sort keys. */
+
+    /**
+     * @brief Compares two records.
+     * @param a The index of the first record.
+     * @param b The index of the second record.
+     * @return true if record @p a goes before record @p b.
+     */
+    bool operator()(uint32_t a, uint32_t b) const;
+};
+
+/**
+ * @brief Merge two sorted runs of indices into one sorted run.
  *
- * This function merges two sorted subarrays into one sorted array.
+ * This function merges arr[l, m) and arr[m, r) into scratch[l, r).
  *
- * @param arr The array to be merged.
- * @param l The left index of the subarray.
- * @param m The middle index of the subarray.
- * @param r The right index of the subarray.
+ * @param arr The array holding both runs.
+ * @param l The start of the left run.
+ * @param m The end of the left run and start of the right run.
+ * @param r The end of the right run.
+ * @param scratch The destination array, at least as long as @p arr.
  * @param comparator The function used for comparison.
  */
-void merge(std::vector<std::string> &arr, int l, int m, int r, std::function<bool(const std::string &, const std::string &)> comparator);
+template <typename Compare>
+void merge(const uint32_t *arr, std::size_t l, std::size_t m, std::size_t r, uint32_t *scratch, Compare comparator);
 
 /**
- * @brief Implementation of merge sort algorithm.
+ * @brief Implementation of a stable, bottom-up merge sort algorithm.
  *
- * This function recursively sorts the array using the merge sort algorithm.
+ * Short runs are sorted by insertion, then runs are merged back and forth
+ * between @p arr and @p scratch. Nothing is allocated.
  *
  * @param arr The array to be sorted.
- * @param l The left index of the array.
- * @param r The right index of the array.
+ * @param n The number of elements.
+ * @param scratch A buffer of at least @p n elements.
  * @param comparator The function used for comparison.
  */
-void mergeSort(std::vector<std::string> &arr, int l, int r, std::function<bool(const std::string &, const std::string &)> comparator);
+template <typename Compare>
+void mergeSort(uint32_t *arr, std::size_t n, uint32_t *scratch, Compare comparator);
+
+/**
+ * @brief Unsigned 128-bit integer holding a composite radix key.
+ */
+using WideKey = unsigned __int128;
+
+/**
+ * @brief Record sorted by radixSort(): a fixed-width key and the index it stands for.
+ * @tparam Key An unsigned integer type (uint64_t or WideKey).
+ */
+template <typename Key>
+struct RadixRecord
+{
+    Key key; /**< The key, already inverted for descending order. */
+    uint32_t index; /**< The index of the sorted item. */
+};
+
+/**
+ * @brief Packs two 64-bit keys into one wide key ordered by @p primary, then @p secondary.
+ * @param primary The most significant key.
+ * @param secondary The tiebreak key.
+ * @return The composite key.
+ */
+inline WideKey pack_key(uint64_t primary, uint64_t secondary)
+{
+    return (static_cast<WideKey>(primary) << 64) | secondary;
+}
+
+/**
+ * @brief Stable LSD radix sort of records by key, one byte per pass.
+ *
+ * All byte histograms are counted in a single pass, and passes whose byte is
+ * the same for every record (e.g. the high bytes of small sizes) are skipped.
+ *
+ * @param records The records to sort.
+ * @param scratch A buffer at least as long as @p records.
+ * @param n The number of records.
+ */
+template <typename Key>
+void radixSort(RadixRecord<Key> *records, RadixRecord<Key> *scratch, std::size_t n);
+
+/**
+ * @brief Number of entries below which sort_files() uses the comparison sort instead of radix sort.
+ */
+constexpr std::size_t RADIX_SORT_THRESHOLD = 256;
+
+/**
+ * @brief Sort stat-ed directory entries based on specified criteria.
+ *
+ * Names are compared by key records; sizes and times of large directories are
+ * radix-sorted on a (key, name prefix) composite.
+ *
+ * @param entries The entries, already stat-ed with links followed.
+ * @param sort_type The type of sorting criteria (e.g., name, size, modification time).
+ * @param sort_order The order in which files should be sorted (ascending or descending).
+ * @return The sorted entries.
+ */
+std::vector<EntryInfo> sort_entries(std::vector<EntryInfo> entries, const SortTypeDef &sort_type, const SortOrderDef &sort_order);
 
 /**
  * @brief Sort files in a directory based on specified criteria.
  *
  * This function sorts the files in the specified directory based on the provided sort type
  * (e.g., name, size, modification time) and sort order (ascending or descending).
+ * Every entry is listed and stat-ed by an EntryIterator, one level deep, then sorted by sort_entries().
  *
  * @param directory The path to the directory containing the files to be sorted.
  * @param sort_type The type of sorting criteria (e.g., name, size, modification time).
  * @param sort_order The order in which files should be sorted (ascending or descending).
- * @return A vector of sorted file names.
+ * @param filter Optional --exclude/--include/--gitignore filter, applied before stat-ing.
+ * @param error Optional, set to the errno of opening @p directory, 0 on success.
+ * @return A vector of sorted entries with their metadata, empty if @p directory cannot be read.
  */
-std::vector<std::string> sort_files(const std::string &directory, const SortTypeDef &sort_type, const SortOrderDef &sort_order);
+std::vector<EntryInfo> sort_files(const std::string &directory, const SortTypeDef &sort_type, const SortOrderDef &sort_order, const PathFilter *filter = nullptr,
+                                  int *error = nullptr);
 
 /**
  * @brief Sort files in a directory based on specified criteria and display them.
@@ -86,5 +180,16 @@ std::vector<std::string> sort_files(const std::string &directory, const SortType
  * @param order The order in which files should be sorted (ascending or descending).
  * @param path The path to the directory containing the files to be sorted.
  * @param show_hidden Whether to include hidden files in the sorting.
+ * @param filter Optional --exclude/--include/--gitignore filter.
  */
-void sort(const SortTypeDef &sort_type, const SortOrderDef &order, const std::string &path, bool show_hidden);
+void sort(const SortTypeDef &sort_type, const SortOrderDef &order, const std::string &path, bool show_hidden, const PathFilter *filter = nullptr);
+
+/**
+ * @brief Display sorted files with the detail of the sort criterion.
+ * @param sorted_files The sorted entries.
+ * @param sort_type The sort criterion, which selects the detail column.
+ * @param show_hidden Whether to include hidden files.
+ */
+void print_sorted(const std::vector<EntryInfo> &sorted_files, const SortTypeDef &sort_type, bool show_hidden);
+
+#include "mySort.tpp"
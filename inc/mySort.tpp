@@ -0,0 +1,139 @@
+/**
+ ******************************************************************************
+ * @file    mySort.tpp
+ * @brief   Implementation of the sort key comparator and merge sort templates.
+ * @author  Arun, Sagar, Saurav
+ * @date    March 7, 2024
+ ******************************************************************************
+ */
+
+#include "mySort.hpp"
+#include <cstring>
+#include <utility>
+
+template <SortTypeDef Type, SortOrderDef Order>
+bool SortKeyLess<Type, Order>::operator()(uint32_t a, uint32_t b) const
+{
+    if constexpr (Order == DESC)
+        std::swap(a, b);
+
+    const SortKey &ka = keys[a];
+    const SortKey &kb = keys[b];
+    if constexpr (Type == SORT_SIZE)
+    {
+        if (ka.size != kb.size)
+            return ka.size < kb.size;
+    }
+    else if constexpr (Type == SORT_TIME)
+    {
+        if (ka.mtime_ns != kb.mtime_ns)
+            return ka.mtime_ns < kb.mtime_ns;
+    }
+
+    uint32_t length = ka.name_length < kb.name_length ? ka.name_length : kb.name_length;
+    int result = std::memcmp(names + ka.name_offset, names + kb.name_offset, length);
+    return result != 0 ? result < 0 : ka.name_length < kb.name_length;
+}
+
+template <typename Key>
+void radixSort(RadixRecord<Key> *records, RadixRecord<Key> *scratch, std::size_t n)
+{
+    constexpr std::size_t BYTES = sizeof(Key);
+    std::size_t counts[BYTES][256] = {};
+    if (n == 0)
+        return;
+
+    for (std::size_t i = 0; i < n; ++i)
+    {
+        Key key = records[i].key;
+        for (std::size_t byte = 0; byte < BYTES; ++byte)
+        {
+            counts[byte][static_cast<uint8_t>(key >> (8 * byte))]++;
+        }
+    }
+
+    RadixRecord<Key> *from = records;
+    RadixRecord<Key> *to = scratch;
+    for (std::size_t byte = 0; byte < BYTES; ++byte)
+    {
+        std::size_t *count = counts[byte];
+        if (count[static_cast<uint8_t>(from[0].key >> (8 * byte))] == n)
+            continue; // Every record has the same byte here
+
+        std::size_t offset = 0;
+        for (std::size_t bucket = 0; bucket < 256; ++bucket)
+        {
+            std::size_t size = count[bucket];
+            count[bucket] = offset;
+            offset += size;
+        }
+        for (std::size_t i = 0; i < n; ++i)
+        {
+            to[count[static_cast<uint8_t>(from[i].key >> (8 * byte))]++] = from[i];
+        }
+        std::swap(from, to);
+    }
+
+    if (from != records)
+        std::memcpy(static_cast<void *>(records), from, n * sizeof(RadixRecord<Key>));
+}
+
+template <typename Compare>
+void merge(const uint32_t *arr, std::size_t l, std::size_t m, std::size_t r, uint32_t *scratch, Compare comparator)
+{
+    std::size_t i = l;
+    std::size_t j = m;
+    std::size_t k = l;
+
+    // Take from the right run only when strictly smaller, which keeps the sort stable
+    while (i < m && j < r)
+    {
+        scratch[k++] = comparator(arr[j], arr[i]) ? arr[j++] : arr[i++];
+    }
+    while (i < m)
+    {
+        scratch[k++] = arr[i++];
+    }
+    while (j < r)
+    {
+        scratch[k++] = arr[j++];
+    }
+}
+
+template <typename Compare>
+void mergeSort(uint32_t *arr, std::size_t n, uint32_t *scratch, Compare comparator)
+{
+    const std::size_t run = 16;
+
+    for (std::size_t start = 0; start < n; start += run)
+    {
+        std::size_t end = start + run < n ? start + run : n;
+        for (std::size_t i = start + 1; i < end; ++i)
+        {
+            uint32_t value = arr[i];
+            std::size_t j = i;
+            while (j > start && comparator(value, arr[j - 1]))
+            {
+                arr[j] = arr[j - 1];
+                --j;
+            }
+            arr[j] = value;
+        }
+    }
+
+    uint32_t *from = arr;
+    uint32_t *to = scratch;
+    for (std::size_t width = run; width < n; width *= 2)
+    {
+        for (std::size_t l = 0; l < n; l += 2 * width)
+        {
+            std::size_t m = l + width < n ? l + width : n;
+            std::size_t r = l + 2 * width < n ? l + 2 * width : n;
+            merge(from, l, m, r, to, comparator);
+        }
+        std::swap(from, to);
+    }
+
+    if (from != arr)
+        std::memcpy(arr, from, n * sizeof(uint32_t));
+}
@@ -0,0 +1,220 @@
+/**
+ ******************************************************************************
+ * @file    myStats.hpp
+ * @brief   Declarations of the scan counters and the per-thread phase timers
+ *          reported by the --stats option.
+ * @author  Arun, Sagar, Saurav
+ * @date    March 7, 2024
+ ******************************************************************************
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <ctime>
+
+/**
+ * @brief Counters collected while scanning directories.
+ *
+ * Readers accumulate locally and publish once per directory, so the atomics
+ * are not contended by the parallel walker.
+ */
+struct ScanStats
+{
+    std::atomic<uint64_t> directories{0}; /**< Directories opened. */
+    std::atomic<uint64_t> entries{0}; /**< Entries read from directories. */
+    std::atomic<uint64_t> stat_calls{0}; /**< Calls to stat/fstatat, batched ones included. */
+    std::atomic<uint64_t> stat_batches{0}; /**< Batches of stat calls submitted together. */
+    std::atomic<uint64_t> bytes_hashed{0}; /**< File contents read by the duplicate finder. */
+    std::atomic<uint64_t> bytes_compared{0}; /**< File contents read by the byte comparison of duplicates. */
+};
+
+/**
+ * @brief The process-wide scan counters.
+ */
+extern ScanStats scan_stats;
+
+/**
+ * @brief Phases whose time --stats reports.
+ */
+enum StatsPhaseDef
+{
+    PHASE_READDIR, /**< Opening and reading directories */
+    PHASE_STAT, /**< Stat calls, single or batched */
+    PHASE_FILTER, /**< Matching entries against --exclude/--include/--gitignore */
+    PHASE_SORT, /**< Sorting entries */
+    PHASE_COLOR, /**< Picking the colors of entries */
+    PHASE_OUTPUT, /**< Writing the output to the kernel */
+    PHASE_HASH, /**< Reading and hashing file contents */
+    PHASE_COUNT /**< Number of phases */
+};
+
+/**
+ * @brief System calls whose number --stats reports.
+ */
+enum StatsCallDef
+{
+    CALL_OPENDIR, /**< opendir (open and fstat) */
+    CALL_STAT, /**< stat, lstat or fstatat, one entry at a time */
+    CALL_STATX, /**< statx issued in a batch, through io_uring or the thread pool */
+    CALL_URING_ENTER, /**< io_uring_enter */
+    CALL_OPEN, /**< open of a file */
+    CALL_READ, /**< read or pread of a file */
+    CALL_WRITE, /**< write of the output */
+    CALL_COUNT /**< Number of system calls */
+};
+
+/**
+ * @brief The counters of one thread.
+ *
+ * Only the owning thread writes them, with relaxed loads and stores instead of
+ * locked read-modify-writes, so counting costs the same as on a plain integer
+ * and the walker threads never share a cache line.
+ */
+struct alignas(64) ThreadStats
+{
+    std::atomic<uint64_t> phase_ns[PHASE_COUNT]; /**< Time spent in every phase. */
+    std::atomic<uint64_t> calls[CALL_COUNT]; /**< Number of every system call. */
+    std::atomic<uint64_t> allocations; /**< Calls to operator new. */
+    std::atomic<bool> in_use; /**< Whether a live thread owns the counters. */
+    ThreadStats *next; /**< The next counters of the registry. */
+};
+
+/**
+ * @brief Whether --stats is on. Written once by enable_stats() before any thread starts.
+ */
+extern bool stats_enabled;
+
+/**
+ * @brief Whether heap allocations are counted: on with --stats, and in the benchmarks,
+ *        once install_allocation_hook() was called.
+ */
+extern bool allocations_counted;
+
+/**
+ * @brief Turns the per-thread counters on and starts the wall clock.
+ */
+void enable_stats();
+
+/**
+ * @brief Counts heap allocations only, leaving the phase timers off.
+ */
+void count_allocations();
+
+/**
+ * @brief Tells the counters that operator new reports to count_allocation().
+ */
+void install_allocation_hook();
+
+/**
+ * @brief Counts one heap allocation of the calling thread.
+ */
+void count_allocation();
+
+/**
+ * @brief Gets the counters of the calling thread.
+ * @return The counters, registered on first use and handed over to a later thread on exit.
+ */
+ThreadStats &thread_stats();
+
+/**
+ * @brief Adds to a counter of the calling thread.
+ * @param counter The counter.
+ * @param amount The amount added.
+ */
+inline void add_stat(std::atomic<uint64_t> &counter, uint64_t amount)
+{
+    counter.store(counter.load(std::memory_order_relaxed) + amount, std::memory_order_relaxed);
+}
+
+/**
+ * @brief Counts system calls, when --stats is on.
+ * @param call The system call.
+ * @param count The number of calls.
+ */
+inline void count_call(StatsCallDef call, uint64_t count = 1)
+{
+    if (stats_enabled)
+        add_stat(thread_stats().calls[call], count);
+}
+
+/**
+ * @brief Gets the monotonic clock.
+ * @return The time in nanoseconds.
+ */
+inline uint64_t stats_clock()
+{
+    timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return static_cast<uint64_t>(now.tv_sec) * 1000000000 + now.tv_nsec;
+}
+
+/**
+ * @brief Adds the time from its construction to its destruction to a phase, when --stats is on.
+ *
+ * Timers nest: while an inner timer runs, the outer one is paused, so every
+ * nanosecond is charged to exactly one phase, the innermost.
+ */
+class PhaseTimer
+{
+public:
+    /**
+     * @brief Constructor. Pauses the enclosing timer and starts this one.
+     * @param phase The phase.
+     */
+    explicit PhaseTimer(StatsPhaseDef phase) : phase(phase), start(0), parent(nullptr)
+    {
+        if (!stats_enabled)
+            return;
+        start = stats_clock();
+        parent = active;
+        if (parent)
+            parent->charge(start);
+        active = this;
+    }
+
+    /**
+     * @brief Destructor. Adds the elapsed time to the phase and resumes the enclosing timer.
+     */
+    ~PhaseTimer()
+    {
+        if (start == 0)
+            return;
+        uint64_t now = stats_clock();
+        charge(now);
+        if (parent)
+            parent->start = now;
+        active = parent;
+    }
+
+    PhaseTimer(const PhaseTimer &) = delete;
+    PhaseTimer &operator=(const PhaseTimer &) = delete;
+
+private:
+    StatsPhaseDef phase; /**< The phase. */
+    uint64_t start; /**< When the timer last started or resumed, 0 when --stats is off. */
+    PhaseTimer *parent; /**< The enclosing timer of the thread, paused while this one runs. */
+    static thread_local PhaseTimer *active; /**< The innermost running timer of the thread. */
+
+    void charge(uint64_t now)
+    {
+        add_stat(thread_stats().phase_ns[phase], now - start);
+        start = now;
+    }
+};
+
+/**
+ * @brief Gets the number of heap allocations counted so far, summed over all threads.
+ * @return The number of calls to operator new.
+ */
+uint64_t total_allocations();
+
+/**
+ * @brief Print the counters to the error stream.
+ *
+ * Call once the walker threads are done: the counters of the other threads are read as they are.
+ *
+ * @param json Whether to print one JSON object instead of text.
+ */
+void print_stats(bool json = false);
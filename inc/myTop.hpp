@@ -0,0 +1,92 @@
+/**
+ ******************************************************************************
+ * @file    myTop.hpp
+ * @brief   Declarations of the top-N view: the largest files and directories of
+ *          a whole subtree, found in one parallel walk with bounded memory.
+ * @author  Arun, Sagar, Saurav
+ * @date    March 7, 2024
+ ******************************************************************************
+ */
+
+#pragma once
+
+#include "myWalk.hpp"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+ * @brief One ranked file or directory.
+ */
+struct TopItem
+{
+    uint64_t size; /**< The size, recursive for directories. */
+    std::string path; /**< The path relative to the walked directory. */
+};
+
+/**
+ * @brief Keeps the N largest items offered to it in a min-heap.
+ *
+ * The smallest kept item is at the root, so an item that does not make the
+ * cut is rejected in O(1) before its path is even built.
+ */
+class TopList
+{
+public:
+    /**
+     * @brief Constructor.
+     * @param capacity The number of items kept.
+     */
+    explicit TopList(std::size_t capacity = 0) : capacity(capacity) {}
+
+    /**
+     * @brief Checks whether an item of a given size would be kept.
+     * @param size The size.
+     * @return true if push() would keep it.
+     */
+    bool wants(uint64_t size) const { return capacity > 0 && (heap.size() < capacity || size > heap.front().size); }
+
+    /**
+     * @brief Offers an item, evicting the smallest one when full.
+     * @param size The size.
+     * @param path The path.
+     */
+    void push(uint64_t size, std::string path);
+
+    /**
+     * @brief Offers all the items of another list.
+     * @param other The list, emptied.
+     */
+    void merge(TopList &other);
+
+    /**
+     * @brief Takes the items out, largest first.
+     * @return The items, ties ordered by path.
+     */
+    std::vector<TopItem> sorted();
+
+private:
+    std::size_t capacity; /**< The number of items kept. */
+    std::vector<TopItem> heap; /**< Min-heap on size. */
+};
+
+/**
+ * @brief Prints the N largest files and the N largest directories below a directory.
+ *
+ * The subtree is walked in parallel. Every worker ranks into its own TopList,
+ * and directory sizes are summed bottom-up as subtrees complete, so memory
+ * stays O(N) per worker plus the directories still being walked, whatever the
+ * size of the tree. Files with several hard links, and the directories above
+ * them, are held until the walk ends and then counted once, under their first
+ * path by name, so the result does not depend on --jobs. Sizes follow the
+ * size view: the root's own blocks count, links are not followed, and -x
+ * stays on one file system.
+ *
+ * @param path The path to the directory.
+ * @param count N, the number of files and of directories listed.
+ * @param options The scan options; without show_hidden, hidden entries are
+ *        counted in the sizes of their parents but not listed.
+ * @param apparent_size Whether to rank by apparent size instead of allocated size.
+ * @return true on success, false with a message on the error stream if @p path is not a directory.
+ */
+bool print_top(const std::string &path, std::size_t count, const ScanOptions &options, bool apparent_size = false);
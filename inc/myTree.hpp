@@ -1,8 +1,9 @@
 /**
  ******************************************************************************
  * @file    myTree.hpp
- * @brief   Declarations of functions and classes for building and printing directory trees.
- *          Includes classes for representing tree nodes and functions for building, counting, and printing trees.
+ * @brief   Declarations of functions for building and printing directory trees.
+ *          Trees are stored compactly in a NodeStore; includes functions for building,
+ *          counting, and printing trees.
  * @author  Arun, Sagar, Saurav
  * @date    March 7, 2024
  ******************************************************************************
@@ -10,67 +11,111 @@
 
 #pragma once
 
+#include "myIndex.hpp"
+#include "myNodeStore.hpp"
+#include "myEntry.hpp"
+#include "myFilter.hpp"
+#include "myWalk.hpp"
+#include <functional>
 #include <string>
 #include <vector>
 
 /**
- * @brief Represents a node in a directory tree.
+ * @brief Called by build_tree() for every directory it lists, from the walker threads.
+ *
+ * @p children has one slot per entry of @p reader, NO_NODE for hidden entries
+ * that were left out; filtered entries are already removed from @p reader.
+ * The store is not locked during the call.
  */
-class TreeNode
-{
-public:
-    std::string full_path; /**< The full path of the node. */
-    std::string name; /**< The name of the node. */
-    bool is_file; /**< Indicates whether the node is a file. */
-    std::vector<TreeNode *> children; /**< Children nodes of the current node. */
+using TreeListener = std::function<void(const std::string &path, NodeId node, DirectoryReader &reader, const std::vector<NodeId> &children)>;
 
-    /**
-     * @brief Constructor for TreeNode class.
-     * @param fullPath The full path of the node.
-     * @param nodeName The name of the node.
-     * @param isFile Indicates whether the node is a file.
-     */
-    TreeNode(const std::string &fullPath, const std::string &nodeName, bool isFile);
-
-    /**
-     * @brief Adds a child node to the current node.
-     * @param child Pointer to the child node to be added.
-     */
-    void addChild(TreeNode *child);
-
-    /**
-     * @brief Checks if the node is a leaf node (has no children).
-     * @return true if the node is a leaf node, false otherwise.
-     */
-    bool isLeaf() const;
-};
+/**
+ * @brief Computes the node flags of a directory entry.
+ * @param entry The entry, with its type resolved.
+ * @param is_last Whether the entry is the last of its directory listing.
+ * @return The NodeFlagDef bits.
+ */
+uint8_t node_flags(const EntryInfo &entry, bool is_last);
 
 /**
  * @brief Builds a tree representing the directory structure.
+ *
+ * Directories are listed in parallel by a work-stealing walker. Each directory's
+ * children are sorted by name and linked as siblings, so the finished tree does
+ * not depend on the order in which the workers visited it. Symbolic links to
+ * directories are shown but not followed.
+ *
  * @param directory The path to the directory to build the tree from.
- * @param parent The parent node of the current directory.
+ * @param store The store receiving the nodes.
+ * @param parent The node of @p directory in @p store.
  * @param show_hidden Flag indicating whether to include hidden files/directories.
- * @param prefix Prefix to prepend to each line in the tree (for formatting).
+ * @param jobs Number of worker threads (0 picks the number of hardware threads).
+ * @param listener Optional hook called for every listed directory.
+ * @param filter Optional --exclude/--include/--gitignore filter; excluded directories are not opened.
+ * @return true if the whole tree was stored, false if the store filled up (an error is printed).
  */
-void build_tree(const std::string &directory, TreeNode *parent, bool show_hidden = false, const std::string &prefix = "");
+bool build_tree(const std::string &directory, NodeStore &store, NodeId parent, bool show_hidden = false, unsigned jobs = 0, const TreeListener &listener = nullptr,
+                const PathFilter *filter = nullptr);
 
 /**
- * @brief Counts the number of directories recursively starting from a given node.
- * @param node The starting node for counting directories.
+ * @brief Counts the number of directories in a store with a linear scan.
+ *
+ * Every node that is not a regular file counts as a directory, the root excluded.
+ *
+ * @param store The store to scan.
  * @return The number of directories.
  */
-int count_directories(TreeNode *node);
+std::size_t count_directories(const NodeStore &store);
 
 /**
- * @brief Counts the number of files recursively starting from a given node.
- * @param node The starting node for counting files.
+ * @brief Counts the number of files in a store with a linear scan.
+ * @param store The store to scan.
  * @return The number of files.
  */
-int count_files(TreeNode *node);
+std::size_t count_files(const NodeStore &store);
+
+/**
+ * @brief Prints the descendants of a node in tree format.
+ *
+ * The tree is walked iteratively through the sibling links, extending and
+ * truncating one prefix string instead of copying it for every level.
+ *
+ * @param store The store holding the tree.
+ * @param node The node whose descendants are printed.
+ */
+void print_tree_nodes(const NodeStore &store, NodeId node);
 
 /**
  * @brief Prints the directory tree rooted at the specified path.
  * @param path The root path of the directory tree.
  * @param show_hidden Flag indicating whether to include hidden files/directories.
+ * @param jobs Number of worker threads used to build the tree (0 picks the number of hardware threads).
+ * @param filter Optional --exclude/--include/--gitignore filter.
+ */
+void print_tree(const std::string &path, bool show_hidden, unsigned jobs = 0, const PathFilter *filter = nullptr);
+
+/**
+ * @brief Prints the directory tree rooted at the specified path while walking it.
+ *
+ * Built on EntryIterator: nothing is stored beyond the sorted listings of the
+ * directories on the current path, so memory grows with depth times the widest
+ * directory instead of the total number of entries, and a reader that goes away
+ * stops the walk. Directories and files are counted as they are printed.
+ *
+ * @param path The root path of the directory tree.
+ * @param options The scan options; jobs is ignored, the walk is sequential.
+ */
+void print_tree_stream(const std::string &path, const ScanOptions &options);
+
+/**
+ * @brief Prints a directory tree from a scan index.
+ *
+ * The output is the same as print_tree_stream() would give for the indexed state,
+ * including the depth and entry limits.
+ *
+ * @param index The loaded index.
+ * @param directory The node of the directory to print.
+ * @param path The path printed for the directory.
+ * @param options The scan options; jobs and one_file_system are ignored.
  */
-void print_tree(const std::string &path, bool show_hidden);
+void print_tree_index(const ScanIndex &index, NodeId directory, const std::string &path, const ScanOptions &options);
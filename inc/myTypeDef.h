@@ -17,6 +17,8 @@ enum ViewTypeDef
     TREE, /**< Tree view */
     SIZE, /**< Size view */
     SORT, /**< Sort view */
+    TOP, /**< Top-N view */
+    DUPES, /**< Duplicate files view */
     SLIDE, /**< Slide view */
     HELP /**< Help view */
 };
@@ -49,3 +51,35 @@ enum ErrorTypeDef
     ARG_FAILURE, /**< Argument failure */
     OPEN_FAILURE /**< Opening failure */
 };
+
+/**
+ * @brief Enumerates different directory entry types.
+ */
+enum EntryTypeDef
+{
+    ENTRY_UNKNOWN, /**< Type not known yet (needs a stat) */
+    ENTRY_FILE, /**< Regular file */
+    ENTRY_DIRECTORY, /**< Directory */
+    ENTRY_SYMLINK, /**< Symbolic link not resolved yet */
+    ENTRY_OTHER /**< Device, FIFO, socket or dangling link */
+};
+
+/**
+ * @brief Enumerates the ways directory entries are stat-ed.
+ */
+enum IoModeDef
+{
+    IO_AUTO, /**< Batched on network and FUSE file systems, one by one elsewhere */
+    IO_BATCH, /**< Batched everywhere */
+    IO_SYNC /**< One by one */
+};
+
+/**
+ * @brief Enumerates the output formats of the scanning views.
+ */
+enum OutputFormatDef
+{
+    FORMAT_TEXT, /**< Colored, aligned text for people */
+    FORMAT_NDJSON, /**< One JSON object per line and entry */
+    FORMAT_BIN /**< Fixed-size little-endian record headers followed by the path */
+};
@@ -0,0 +1,110 @@
+/**
+ ******************************************************************************
+ * @file    myWalk.hpp
+ * @brief   Definition of a multi-threaded, work-stealing directory walker.
+ *          Each worker owns a deque of pending directories, pops from its back
+ *          and steals from the front of other workers when it runs dry.
+ * @author  Arun, Sagar, Saurav
+ * @date    March 7, 2024
+ ******************************************************************************
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+/**
+ * @brief Work-stealing walker template.
+ *
+ * The walker knows nothing about the filesystem: it schedules tasks of type T
+ * over a pool of workers. The visitor processes one task (usually one directory)
+ * and appends the tasks it discovers (usually its subdirectories) to @p spawned.
+ * The visitor must not throw.
+ *
+ * @tparam T The type of a task, e.g. a directory path plus the node it fills.
+ */
+template <typename T>
+class Walker
+{
+public:
+    /**
+     * @brief Visitor called for every task.
+     * @param worker Index of the worker running the task (0 .. jobs - 1).
+     * @param task The task to process.
+     * @param spawned Output list of new tasks to schedule.
+     */
+    using Visitor = std::function<void(unsigned worker, T &task, std::vector<T> &spawned)>;
+
+    /**
+     * @brief Constructor.
+     * @param jobs Number of worker threads (0 picks the number of hardware threads).
+     */
+    explicit Walker(unsigned jobs = 0);
+
+    /**
+     * @brief Get the number of workers.
+     * @return The number of workers used by run().
+     */
+    unsigned jobs() const;
+
+    /**
+     * @brief Process @p root and every task spawned from it, then return.
+     * @param root The first task.
+     * @param visit The visitor called for every task.
+     */
+    void run(T root, const Visitor &visit);
+
+    /**
+     * @brief Process several roots and every task spawned from them, then return.
+     * @param roots The first tasks, spread over the workers.
+     * @param visit The visitor called for every task.
+     */
+    void run(std::vector<T> roots, const Visitor &visit);
+
+private:
+    /**
+     * @brief Per-worker deque, padded to its own cache line.
+     */
+    struct alignas(64) WorkerDeque
+    {
+        std::mutex mutex; /**< Protects items. */
+        std::deque<T> items; /**< Pending tasks owned by the worker. */
+    };
+
+    unsigned num_jobs; /**< Number of workers. */
+    std::vector<std::unique_ptr<WorkerDeque>> deques; /**< One deque per worker. */
+    std::atomic<std::size_t> pending; /**< Tasks queued or running. */
+
+    bool pop_local(unsigned worker, T &task);
+    bool steal(unsigned thief, T &task);
+    void work(unsigned worker, const Visitor &visit);
+};
+
+class PathFilter;
+
+/**
+ * @brief Options shared by the views that scan directories.
+ */
+struct ScanOptions
+{
+    unsigned jobs = 0; /**< Number of walker threads (0 picks the number of hardware threads). */
+    bool show_hidden = false; /**< Whether to include hidden files/directories. */
+    bool one_file_system = false; /**< Whether to stay on the file system of the root directory. */
+    unsigned max_depth = 0; /**< Deepest level listed, the root's children being level 1 (0 for no limit). */
+    uint64_t max_entries = 0; /**< Number of entries after which the scan stops (0 for no limit). */
+    const PathFilter *filter = nullptr; /**< The --exclude/--include/--gitignore filter, nullptr for none. */
+};
+
+/**
+ * @brief Get the default number of walker jobs.
+ * @return The number of hardware threads, at least 1.
+ */
+unsigned default_jobs();
+
+#include "myWalk.tpp"
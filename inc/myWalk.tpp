@@ -0,0 +1,140 @@
+/**
+ ******************************************************************************
+ * @file    myWalk.tpp
+ * @brief   Implementation of the Walker class template.
+ * @author  Arun, Sagar, Saurav
+ * @date    March 7, 2024
+ ******************************************************************************
+ */
+
+#include "myWalk.hpp"
+#include <chrono>
+#include <thread>
+
+template <typename T>
+Walker<T>::Walker(unsigned jobs) : num_jobs(jobs ? jobs : default_jobs()), pending(0)
+{
+    for (unsigned i = 0; i < num_jobs; ++i)
+    {
+        deques.push_back(std::make_unique<WorkerDeque>());
+    }
+}
+
+template <typename T>
+unsigned Walker<T>::jobs() const
+{
+    return num_jobs;
+}
+
+template <typename T>
+void Walker<T>::run(T root, const Visitor &visit)
+{
+    std::vector<T> roots;
+    roots.push_back(std::move(root));
+    run(std::move(roots), visit);
+}
+
+template <typename T>
+void Walker<T>::run(std::vector<T> roots, const Visitor &visit)
+{
+    if (roots.empty())
+        return;
+
+    pending = roots.size();
+    for (std::size_t i = 0; i < roots.size(); ++i)
+    {
+        deques[i % num_jobs]->items.push_back(std::move(roots[i]));
+    }
+
+    if (num_jobs == 1)
+    {
+        work(0, visit); // No threads needed, walk on the caller's thread
+        return;
+    }
+
+    std::vector<std::thread> threads;
+    for (unsigned i = 1; i < num_jobs; ++i)
+    {
+        threads.emplace_back(&Walker<T>::work, this, i, std::cref(visit));
+    }
+    work(0, visit);
+    for (auto &thread : threads)
+    {
+        thread.join();
+    }
+}
+
+template <typename T>
+bool Walker<T>::pop_local(unsigned worker, T &task)
+{
+    WorkerDeque &own = *deques[worker];
+    std::lock_guard<std::mutex> lock(own.mutex);
+    if (own.items.empty())
+        return false;
+
+    // LIFO on the own deque keeps the walk depth-first and cache friendly
+    task = std::move(own.items.back());
+    own.items.pop_back();
+    return true;
+}
+
+template <typename T>
+bool Walker<T>::steal(unsigned thief, T &task)
+{
+    for (unsigned offset = 1; offset < num_jobs; ++offset)
+    {
+        WorkerDeque &victim = *deques[(thief + offset) % num_jobs];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if (!victim.items.empty())
+        {
+            // FIFO when stealing takes the oldest, and usually biggest, subtree
+            task = std::move(victim.items.front());
+            victim.items.pop_front();
+            return true;
+        }
+    }
+    return false;
+}
+
+template <typename T>
+void Walker<T>::work(unsigned worker, const Visitor &visit)
+{
+    std::vector<T> spawned;
+    unsigned idle_rounds = 0;
+
+    while (true)
+    {
+        T task;
+        if (pop_local(worker, task) || steal(worker, task))
+        {
+            idle_rounds = 0;
+            spawned.clear();
+            visit(worker, task, spawned);
+
+            if (!spawned.empty())
+            {
+                // Count the children before retiring the parent so pending never hits 0 early
+                pending += spawned.size();
+                WorkerDeque &own = *deques[worker];
+                std::lock_guard<std::mutex> lock(own.mutex);
+                for (auto it = spawned.rbegin(); it != spawned.rend(); ++it)
+                {
+                    own.items.push_back(std::move(*it));
+                }
+            }
+            pending--;
+        }
+        else if (pending == 0)
+        {
+            break;
+        }
+        else if (++idle_rounds < 64)
+        {
+            std::this_thread::yield();
+        }
+        else
+        {
+            std::this_thread::sleep_for(std::chrono::microseconds(50));
+        }
+    }
+}
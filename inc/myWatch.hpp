@@ -0,0 +1,136 @@
+/**
+ ******************************************************************************
+ * @file    myWatch.hpp
+ * @brief   Declarations of the continuous watch mode of the tree and size views.
+ *          The tree is scanned once, then kept up to date from inotify events
+ *          and redrawn at a capped frame rate, rewriting only the changed lines.
+ * @author  Arun, Sagar, Saurav
+ * @date    March 7, 2024
+ ******************************************************************************
+ */
+
+#pragma once
+
+#include "myEntry.hpp"
+#include "myNodeStore.hpp"
+#include "mySize.hpp"
+#include "myTypeDef.h"
+#include "myWalk.hpp"
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+/**
+ * @brief Minimum time between two redraws, in milliseconds.
+ */
+constexpr int WATCH_FRAME_MS = 200;
+
+/**
+ * @brief Size bookkeeping of one watched node.
+ */
+struct WatchState
+{
+    DiskUsage usage; /**< The node's own size, from lstat(). */
+    DiskUsage total; /**< The counted size of the node and everything below it. */
+    uint64_t dev = 0; /**< The device number. */
+    uint64_t ino = 0; /**< The inode number. */
+    uint32_t mode = 0; /**< The st_mode bits, from lstat(). */
+    int wd = -1; /**< The inotify watch of a directory, -1 if none. */
+    uint8_t type = ENTRY_UNKNOWN; /**< The EntryTypeDef, from lstat(). */
+    bool has_stat = false; /**< Whether the node could be stat-ed. */
+    bool shared = false; /**< Whether the node is in the inode table. */
+    bool counted = false; /**< Whether usage is part of total. */
+};
+
+/**
+ * @brief A scanned tree kept up to date from inotify events.
+ *
+ * Created, deleted and moved entries are inserted into or unlinked from the
+ * NodeStore, and the size change is added to every ancestor's total, so an
+ * event costs O(depth) instead of a rescan. A queue overflow falls back to a
+ * full rescan.
+ */
+class TreeWatcher
+{
+public:
+    /**
+     * @brief Constructor.
+     * @param view TREE or SIZE.
+     * @param path The root directory.
+     * @param options The scan options.
+     * @param apparent_size Size view: whether the bars show the apparent size.
+     */
+    TreeWatcher(ViewTypeDef view, const std::string &path, const ScanOptions &options, bool apparent_size);
+
+    /**
+     * @brief Destructor. Closes the inotify instance.
+     */
+    ~TreeWatcher();
+
+    TreeWatcher(const TreeWatcher &) = delete;
+    TreeWatcher &operator=(const TreeWatcher &) = delete;
+
+    /**
+     * @brief Scans, then redraws on every change until interrupted.
+     * @return The exit status.
+     */
+    int run();
+
+private:
+    /**
+     * @brief Hash of a (device, inode) pair.
+     */
+    struct KeyHash
+    {
+        std::size_t operator()(const std::pair<uint64_t, uint64_t> &key) const { return key.second ^ (key.first * 0x9E3779B97F4A7C15ull); }
+    };
+
+    ViewTypeDef view; /**< TREE or SIZE. */
+    std::string root_path; /**< The root directory. */
+    ScanOptions options; /**< The scan options. */
+    bool apparent_size; /**< Size view: whether the bars show the apparent size. */
+    bool keep_hidden; /**< Whether hidden entries are kept in the store. */
+    std::unique_ptr<NodeStore> store; /**< The tree. */
+    std::vector<WatchState> states; /**< The bookkeeping, by NodeId. */
+    std::unordered_map<int, NodeId> watches; /**< Directory of every inotify watch. */
+    std::unordered_map<std::pair<uint64_t, uint64_t>, std::vector<NodeId>, KeyHash> links; /**< Nodes of every file inode, the first one counted. */
+    std::mutex mutex; /**< Serialises the bookkeeping while scanning in parallel. */
+    int inotify_fd; /**< The inotify instance. */
+    uint64_t root_dev; /**< The device of the root, for options.one_file_system. */
+    std::size_t directories; /**< Number of directories in the tree, the root excluded. */
+    std::size_t files; /**< Number of files in the tree. */
+    std::size_t dead_nodes; /**< Number of unlinked nodes left in the arena. */
+    bool limit_reported; /**< Whether running out of inotify watches was reported. */
+    std::vector<std::string> frame; /**< The lines on the screen. */
+    int frame_width; /**< The terminal width the frame was drawn for. */
+    int frame_height; /**< The terminal height the frame was drawn for. */
+
+    bool scan();
+    void scan_subtree(NodeId node, const std::string &path);
+    void listed(const std::string &path, NodeId directory, DirectoryReader &reader, const std::vector<NodeId> &children);
+    void add_watch(NodeId node, const std::string &path);
+    void claim(NodeId node, const EntryInfo &entry, bool propagate);
+    void release(NodeId node);
+    void add_total(NodeId node, int64_t apparent, int64_t allocated);
+    bool read_events();
+    void apply(NodeId directory, const std::string &name, uint32_t mask);
+    void add_entry(NodeId directory, const std::string &name);
+    void remove_entry(NodeId node);
+    void refresh_directory(NodeId directory);
+    std::vector<std::string> render() const;
+    void draw(const std::vector<std::string> &lines);
+};
+
+/**
+ * @brief Watch a directory and keep the tree or size view on screen up to date.
+ * @param view TREE or SIZE.
+ * @param path The root directory.
+ * @param options The scan options.
+ * @param apparent_size Size view: whether the bars show the apparent size.
+ * @return The exit status.
+ */
+int watch(ViewTypeDef view, const std::string &path, const ScanOptions &options, bool apparent_size = false);
@@ -9,11 +9,22 @@
  */
 
 #include "myTypeDef.h"
+#include "myBatch.hpp"
+#include "myFilter.hpp"
+#include "myIndex.hpp"
+#include "myRecord.hpp"
 #include "myTree.hpp"
 #include "mySize.hpp"
 #include "mySort.hpp"
 #include "mySlide.hpp"
+#include "myTop.hpp"
 #include "myColors.hpp"
+#include "myDupes.hpp"
+#include "myOutput.hpp"
+#include "myStats.hpp"
+#include "myWalk.hpp"
+#include "myWatch.hpp"
+#include <algorithm>
 #include <iostream>
 #include <string>
 #include <filesystem>
@@ -23,15 +34,34 @@
  */
 std::string help_msg =
     "Directory Information: display tree view, directory sizes and do sorting.\n\n"
-    "usage: difo.py [-h] [--tree] [--size] [--sort <type> <order>] [-a] [--slide <speed>] [directory]\n\n"
+    "usage: difo.py [-h] [--tree] [--size] [--sort <type> <order>] [--top <n>] [--dupes] [-a] [-x] [--apparent-size] [--slide <speed>] [--from-offset <n>] [--jobs <n>] [--stream] [-L <depth>] [--max-entries <n>] [--index <file>] [--watch] [--exclude <glob>] [--include <glob>] [--gitignore] [--io <mode>] [--io-depth <n>] [--format <format>] [--stats[=json]] [directory]\n\n"
     "positional arguments:\n"
-    "  directory                 Directory path (default: current directory)\n\n"
+    "  directory                 Directory path (default: current directory), or file of the slide view ('-' for stdin)\n\n"
     "options:\n"
     "  --tree, -t                Display directory tree\n"
-    "  --size, -z                Display size of directories and files in current directory\n"
+    "  --size, -z                Display recursive size of directories and files in current directory\n"
     "  --sort [sorting options]  Sort by type in order (-asc or -desc)\n"
+    "  --top <n>                 List the <n> largest files and directories of the whole subtree\n"
+    "  --dupes                   List the files with identical contents in the whole subtree\n"
     "  --slide, -l [speed]       Slide speed in seconds (default: 1.0 impled 1 character per 20ms)\n"
+    "  --from-offset <n>         Slide view: start <n> bytes into the file, without reading them when it can seek\n"
     "  -a, --all                 Show hidden files and directories\n"
+    "  -j, --jobs <n>            Number of threads walking the tree (default: number of CPUs)\n"
+    "  --stream                  Tree view: print while walking, with memory bounded by the tree depth (default with -L or --max-entries)\n"
+    "  -L, --level <depth>       Tree view: descend at most <depth> levels (implies --stream)\n"
+    "  --max-entries <n>         Tree view: stop after <n> entries (implies --stream)\n"
+    "  --tree --size --sort ...  Tree, size and sort views can be combined, rendered in order from one scan\n"
+    "  -i, --index <file>        Serve tree, size and sort views from an index file, refreshing changed directories\n"
+    "  -w, --watch               Tree and size views: keep the view on screen, updated as the directory changes\n"
+    "  -x, --one-file-system     Size, top and dupes views: do not count directories on other file systems\n"
+    "  --apparent-size           Size and top views: measure apparent sizes instead of allocated blocks\n"
+    "  --exclude <glob>          Skip files and directories matching <glob>, without opening them (repeatable)\n"
+    "  --include <glob>          Only show files matching <glob>, directories are kept (repeatable)\n"
+    "  --gitignore               Skip what .gitignore files ignore, and .git itself\n"
+    "  --io <mode>               How entries are stat-ed: auto (batched on network and FUSE mounts), batch or sync\n"
+    "  --io-depth <n>            Number of stat requests in flight per batch (default: 64)\n"
+    "  --format <format>         Tree, size and sort views: text, ndjson (one JSON object per entry) or bin\n"
+    "  --stats[=json]            Print the time of every phase, system calls, allocations and peak memory to stderr\n"
     "  -h, --help                Show this help message and exit\n\n"
     "sorting options:\n"
     "  --sort-name, -n           Sort by name\n"
@@ -58,10 +88,30 @@ int main(int argc, char *argv[])
 {
     // Default values and variables for parsing command-line arguments
     ViewTypeDef view = TREE;
+    std::vector<ViewTypeDef> views; // Every view asked for, in order
+    auto add_view = [&](ViewTypeDef added)
+    {
+        view = added;
+        if (std::find(views.begin(), views.end(), added) == views.end())
+            views.push_back(added);
+    };
     SortTypeDef sort_type = SORT_NAME;
     SortOrderDef sort_order = ASC;
-    bool show_hidden = false;
+    ScanOptions options;
+    options.jobs = default_jobs();
+    bool apparent_size = false;
+    std::size_t top_count = 0;
     float slide_speed = 1.0f;
+    uint64_t slide_offset = 0;
+    bool show_stats = false;
+    bool stats_json = false;
+    bool stream_tree = false;
+    std::string index_file;
+    bool watch_view = false;
+    PathFilter filter;
+    IoModeDef io_mode = IO_AUTO;
+    unsigned io_depth = IO_DEFAULT_DEPTH;
+    OutputFormatDef format = FORMAT_TEXT;
     std::string directory = ".";
 
     // Parse command-line arguments
@@ -71,29 +121,29 @@ int main(int argc, char *argv[])
 
         if (arg == "--tree" || arg == "-t")
         {
-            view = TREE;
+            add_view(TREE);
         }
         else if (arg == "--size" || arg == "-z")
         {
-            view = SIZE;
+            add_view(SIZE);
         }
         else if (arg == "--sort" || arg == "-s")
         {
-            view = SORT;
+            add_view(SORT);
         }
         else if (arg == "--sort-name" || arg == "-n")
         {
-            view = SORT;
+            add_view(SORT);
             sort_type = SORT_NAME;
         }
         else if (arg == "--sort-time" || arg == "-d")
         {
-            view = SORT;
+            add_view(SORT);
             sort_type = SORT_TIME;
         }
         else if (arg == "--sort-size" || arg == "-s") // Change from -d to -s
         {
-            view = SORT;
+            add_view(SORT);
             sort_type = SORT_SIZE;
         }
         else if (arg == "--ascending" || arg == "-asc")
@@ -104,23 +154,172 @@ int main(int argc, char *argv[])
         {
             sort_order = DESC;
         }
+        else if (arg == "--top")
+        {
+            long long value = i + 1 < argc ? std::atoll(argv[i + 1]) : 0;
+            if (value <= 0)
+            {
+                std::cerr << "difo: option '" << arg << "' requires a positive number" << std::endl;
+                std::cout << "see 'difo --help'" << std::endl;
+                return ARG_FAILURE;
+            }
+            add_view(TOP);
+            top_count = static_cast<std::size_t>(value);
+            ++i;
+        }
+        else if (arg == "--dupes")
+        {
+            add_view(DUPES);
+        }
         else if (arg == "--slide" || arg == "-l")
         {
-            view = SLIDE;
+            add_view(SLIDE);
         }
         else if (arg.substr(0, 2) == "-f")
         {
-            slide_speed = std::stof(arg.substr(2));
+            slide_speed = std::strtof(arg.c_str() + 2, nullptr);
+            if (!(slide_speed > 0.0f))
+            {
+                std::cerr << "difo: option '-f' requires a positive speed" << std::endl;
+                std::cout << "see 'difo --help'" << std::endl;
+                return ARG_FAILURE;
+            }
+        }
+        else if (arg == "--from-offset")
+        {
+            char *end = nullptr;
+            const char *value = i + 1 < argc ? argv[i + 1] : "";
+            unsigned long long offset = std::strtoull(value, &end, 10);
+            if (*value < '0' || *value > '9' || *end != '\0')
+            {
+                std::cerr << "difo: option '" << arg << "' requires a number of bytes" << std::endl;
+                std::cout << "see 'difo --help'" << std::endl;
+                return ARG_FAILURE;
+            }
+            slide_offset = static_cast<uint64_t>(offset);
+            ++i;
         }
         else if (arg == "--all" || arg == "-a")
         {
-            show_hidden = true;
+            options.show_hidden = true;
+        }
+        else if (arg == "--jobs" || arg == "-j")
+        {
+            int value = i + 1 < argc ? std::atoi(argv[i + 1]) : 0;
+            if (value <= 0)
+            {
+                std::cerr << "difo: option '" << arg << "' requires a positive number" << std::endl;
+                std::cout << "see 'difo --help'" << std::endl;
+                return ARG_FAILURE;
+            }
+            options.jobs = static_cast<unsigned>(value);
+            ++i;
+        }
+        else if (arg == "--stream")
+        {
+            stream_tree = true;
+        }
+        else if (arg == "--level" || arg == "-L" || arg == "--max-entries")
+        {
+            long long value = i + 1 < argc ? std::atoll(argv[i + 1]) : 0;
+            if (value <= 0)
+            {
+                std::cerr << "difo: option '" << arg << "' requires a positive number" << std::endl;
+                std::cout << "see 'difo --help'" << std::endl;
+                return ARG_FAILURE;
+            }
+            if (arg == "--max-entries")
+                options.max_entries = static_cast<uint64_t>(value);
+            else
+                options.max_depth = static_cast<unsigned>(value);
+            stream_tree = true;
+            ++i;
+        }
+        else if (arg == "--index" || arg == "-i")
+        {
+            if (i + 1 >= argc)
+            {
+                std::cerr << "difo: option '" << arg << "' requires a file" << std::endl;
+                std::cout << "see 'difo --help'" << std::endl;
+                return ARG_FAILURE;
+            }
+            index_file = argv[++i];
+        }
+        else if (arg == "--exclude" || arg == "--include")
+        {
+            if (i + 1 >= argc)
+            {
+                std::cerr << "difo: option '" << arg << "' requires a glob" << std::endl;
+                std::cout << "see 'difo --help'" << std::endl;
+                return ARG_FAILURE;
+            }
+            if (arg == "--exclude")
+                filter.exclude(argv[++i]);
+            else
+                filter.include(argv[++i]);
+        }
+        else if (arg == "--gitignore")
+        {
+            filter.use_gitignore();
+        }
+        else if (arg == "--io")
+        {
+            std::string mode = i + 1 < argc ? argv[i + 1] : "";
+            if (mode != "auto" && mode != "batch" && mode != "sync")
+            {
+                std::cerr << "difo: option '--io' requires 'auto', 'batch' or 'sync'" << std::endl;
+                std::cout << "see 'difo --help'" << std::endl;
+                return ARG_FAILURE;
+            }
+            io_mode = mode == "batch" ? IO_BATCH : mode == "sync" ? IO_SYNC : IO_AUTO;
+            ++i;
+        }
+        else if (arg == "--io-depth")
+        {
+            long long value = i + 1 < argc ? std::atoll(argv[i + 1]) : 0;
+            if (value <= 0)
+            {
+                std::cerr << "difo: option '" << arg << "' requires a positive number" << std::endl;
+                std::cout << "see 'difo --help'" << std::endl;
+                return ARG_FAILURE;
+            }
+            io_depth = static_cast<unsigned>(std::min(value, 4096LL));
+            ++i;
+        }
+        else if (arg == "--format")
+        {
+            std::string name = i + 1 < argc ? argv[i + 1] : "";
+            if (name != "text" && name != "ndjson" && name != "bin")
+            {
+                std::cerr << "difo: option '--format' requires 'text', 'ndjson' or 'bin'" << std::endl;
+                std::cout << "see 'difo --help'" << std::endl;
+                return ARG_FAILURE;
+            }
+            format = name == "ndjson" ? FORMAT_NDJSON : name == "bin" ? FORMAT_BIN : FORMAT_TEXT;
+            ++i;
+        }
+        else if (arg == "--watch" || arg == "-w")
+        {
+            watch_view = true;
+        }
+        else if (arg == "--one-file-system" || arg == "-x")
+        {
+            options.one_file_system = true;
+        }
+        else if (arg == "--apparent-size")
+        {
+            apparent_size = true;
+        }
+        else if (arg == "--stats" || arg == "--stats=json")
+        {
+            show_stats = true;
+            stats_json = arg == "--stats=json";
         }
         else if (arg == "--help" || arg == "-h")
         {
             view = HELP;
         }
-        else if (arg[0] != '-')
+        else if (arg[0] != '-' || arg == "-")
         {
             directory = arg;
         }
@@ -132,44 +331,189 @@ int main(int argc, char *argv[])
         }
     }
 
-    // Check if the specified directory exists
-    if (!std::filesystem::exists(directory))
+    // Check if the specified directory exists; '-' is the standard input of the slide view
+    if (directory == "-" && view != SLIDE && view != HELP)
+    {
+        std::cerr << "difo: reading the standard input requires the slide view" << std::endl;
+        std::cout << "see 'difo --help'" << std::endl;
+        return ARG_FAILURE;
+    }
+    if (directory != "-" && !std::filesystem::exists(directory))
     {
         std::cerr << "difo: cannot access '" << directory << "': No such file or directory" << std::endl;
         return OPEN_FAILURE;
     }
 
-    // Get the absolute path of the directory
-    std::string path = std::filesystem::absolute(directory).string();
+    configure_batch_stat(io_mode, io_depth);
+    if (filter.active())
+    {
+        // The index and the watcher keep every entry, the filter only prunes live walks
+        if (!index_file.empty() || watch_view)
+        {
+            std::cerr << "difo: --exclude, --include and --gitignore cannot be combined with " << (watch_view ? "--watch" : "--index") << std::endl;
+            std::cout << "see 'difo --help'" << std::endl;
+            return ARG_FAILURE;
+        }
+        options.filter = &filter;
+    }
 
-    // Perform the action based on the specified view
-    switch (view)
+    // Counted from here on, before any walker thread starts
+    if (show_stats)
+        enable_stats();
+
+    // Several views render from one scan of the tree
+    bool multi_view = views.size() > 1 && view != HELP;
+    if (multi_view)
     {
-    case TREE:
-        print_tree(path, show_hidden);
-        break;
+        for (ViewTypeDef shown : views)
+        {
+            if (shown != TREE && shown != SIZE && shown != SORT)
+            {
+                std::cerr << "difo: only the tree, size and sort views can be combined" << std::endl;
+                std::cout << "see 'difo --help'" << std::endl;
+                return ARG_FAILURE;
+            }
+        }
+        if (watch_view || format != FORMAT_TEXT)
+        {
+            std::cerr << "difo: combined views cannot be used with " << (watch_view ? "--watch" : "--format") << std::endl;
+            std::cout << "see 'difo --help'" << std::endl;
+            return ARG_FAILURE;
+        }
+    }
 
-    case SIZE:
-        draw_size_bar(show_hidden, path);
-        break;
+    // Records are written by the scanning views, from live walks for the tree
+    if (format != FORMAT_TEXT && (watch_view || (view != TREE && view != SIZE && view != SORT) || (view == TREE && !index_file.empty())))
+    {
+        std::cerr << "difo: option '--format' requires the tree, size or sort view, and cannot be combined with --watch or with --index for the tree" << std::endl;
+        std::cout << "see 'difo --help'" << std::endl;
+        return ARG_FAILURE;
+    }
 
-    case SORT:
-        sort(sort_type, sort_order, path, show_hidden);
-        break;
+    // Get the absolute path of the directory
+    std::string path = directory == "-" ? directory : std::filesystem::absolute(directory).string();
+
+    // Keep the view on screen, updated from file system events instead of rescans
+    if (watch_view)
+    {
+        if (view != TREE && view != SIZE)
+        {
+            std::cerr << "difo: option '--watch' requires the tree or size view" << std::endl;
+            std::cout << "see 'difo --help'" << std::endl;
+            return ARG_FAILURE;
+        }
+        if (!std::filesystem::is_directory(path))
+        {
+            std::cerr << "difo: cannot watch '" << directory << "': Not a directory" << std::endl;
+            return OPEN_FAILURE;
+        }
+        return watch(view, path, options, apparent_size);
+    }
 
-    case SLIDE:
-        if (!std::filesystem::is_regular_file(path))
+    // Serve the scanning views from the index, refreshed where the file system changed
+    ScanIndex index;
+    NodeId index_node = NO_NODE;
+    if (!index_file.empty() && (view == TREE || view == SIZE || view == SORT))
+    {
+        if (!std::filesystem::is_directory(path))
         {
-            std::cerr << "difo: cannot open: '" << directory << "' is not a file" << std::endl;
+            std::cerr << "difo: cannot index '" << directory << "': Not a directory" << std::endl;
             return OPEN_FAILURE;
         }
-        print_content_with_slide(path, slide_speed);
-        break;
+        if (!index.load(index_file, path, options))
+            return OPEN_FAILURE;
+        index_node = index.find(path);
+    }
+    else if (multi_view)
+    {
+        if (!std::filesystem::is_directory(path))
+        {
+            std::cerr << "difo: cannot open: '" << directory << "' is not a directory" << std::endl;
+            return OPEN_FAILURE;
+        }
+        if (!index.scan(path, options))
+            return OPEN_FAILURE;
+        index_node = index.find(path);
+    }
 
-    case HELP:
-        std::cout << help_msg << std::flush;
-        break;
+    // Perform the actions based on the specified views
+    bool ok = true;
+    if (!multi_view)
+        views.assign(1, view);
+    for (std::size_t shown = 0; shown < views.size(); ++shown)
+    {
+        if (shown > 0)
+            out() << "\n";
+        switch (views[shown])
+        {
+        case TREE:
+            if (format != FORMAT_TEXT)
+                ok = print_tree_records(path, options, format);
+            else if (index_node != NO_NODE)
+                print_tree_index(index, index_node, path, options);
+            else if (stream_tree)
+                print_tree_stream(path, options);
+            else
+                print_tree(path, options.show_hidden, options.jobs, options.filter);
+            break;
+
+        case SIZE:
+            if (index_node != NO_NODE)
+                draw_size_bar(index, index_node, options, apparent_size, format);
+            else
+                ok = draw_size_bar(path, options, apparent_size, format);
+            break;
+
+        case SORT:
+            if (format != FORMAT_TEXT)
+                print_records(index_node != NO_NODE ? sort_entries(index.entries(index_node, true), sort_type, sort_order)
+                                                    : sort_files(path, sort_type, sort_order, options.filter),
+                              options.show_hidden, format);
+            else if (index_node != NO_NODE)
+                print_sorted(sort_entries(index.entries(index_node, true), sort_type, sort_order), sort_type, options.show_hidden);
+            else
+                sort(sort_type, sort_order, path, options.show_hidden, options.filter);
+            break;
+
+        case TOP:
+            if (!std::filesystem::is_directory(path))
+            {
+                std::cerr << "difo: cannot open: '" << directory << "' is not a directory" << std::endl;
+                return OPEN_FAILURE;
+            }
+            ok = print_top(path, top_count, options, apparent_size);
+            break;
+
+        case DUPES:
+            if (!std::filesystem::is_directory(path))
+            {
+                std::cerr << "difo: cannot open: '" << directory << "' is not a directory" << std::endl;
+                return OPEN_FAILURE;
+            }
+            ok = print_dupes(path, options);
+            break;
+
+        case SLIDE:
+            // Pipes and devices stream like the standard input
+            if (path != "-" && std::filesystem::is_directory(path))
+            {
+                std::cerr << "difo: cannot open: '" << directory << "' is not a file" << std::endl;
+                return OPEN_FAILURE;
+            }
+            ok = print_content_with_slide(path, slide_speed, slide_offset);
+            break;
+
+        case HELP:
+            out() << help_msg;
+            break;
+        }
+    }
+
+    out().flush();
+    if (show_stats)
+    {
+        print_stats(stats_json);
     }
 
-    return SUCCESS;
+    return ok ? SUCCESS : OPEN_FAILURE;
 }
@@ -0,0 +1,47 @@
+/**
+ ******************************************************************************
+ * @file    myAllocator.cpp
+ * @brief   Replacement of the global operator new and delete that counts heap
+ *          allocations for --stats and the benchmarks. Linked into the difo
+ *          and difo_bench executables only, never into libdifo.
+ * @author  Arun, Sagar, Saurav
+ * @date    March 7, 2024
+ ******************************************************************************
+ */
+
+#include "myStats.hpp"
+#include <algorithm>
+#include <cstdlib>
+#include <new>
+
+/**
+ * @brief Installs the allocation hook before main() runs.
+ */
+static struct AllocationHook
+{
+    AllocationHook() { install_allocation_hook(); }
+} allocation_hook;
+
+void *operator new(std::size_t size)
+{
+    if (allocations_counted)
+        count_allocation();
+    if (void *memory = std::malloc(size ? size : 1))
+        return memory;
+    throw std::bad_alloc();
+}
+
+void *operator new(std::size_t size, std::align_val_t alignment)
+{
+    if (allocations_counted)
+        count_allocation();
+    std::size_t align = static_cast<std::size_t>(alignment);
+    if (void *memory = std::aligned_alloc(align, (std::max<std::size_t>(size, 1) + align - 1) / align * align))
+        return memory;
+    throw std::bad_alloc();
+}
+
+void operator delete(void *memory) noexcept { std::free(memory); }
+void operator delete(void *memory, std::size_t) noexcept { std::free(memory); }
+void operator delete(void *memory, std::align_val_t) noexcept { std::free(memory); }
+void operator delete(void *memory, std::size_t, std::align_val_t) noexcept { std::free(memory); }
@@ -0,0 +1,520 @@
+/**
+ ******************************************************************************
+ * @file    myBatch.cpp
+ * @brief   Implementation of the batched metadata backend.
+ * @author  Arun, Sagar, Saurav
+ * @date    March 7, 2024
+ ******************************************************************************
+ */
+
+#include "myBatch.hpp"
+#include "myStats.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <fcntl.h>
+#include <fstream>
+#include <linux/io_uring.h>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/sysmacros.h>
+#include <thread>
+#include <unistd.h>
+#include <unordered_set>
+#include <vector>
+
+/**
+ * @brief Most threads of the fallback pool.
+ */
+constexpr unsigned IO_MAX_THREADS = 32;
+
+/**
+ * @brief Backends reported by batch_stat_backend().
+ */
+enum BatchBackendDef
+{
+    BACKEND_NONE, /**< No batch ran */
+    BACKEND_URING, /**< io_uring */
+    BACKEND_THREADS /**< Thread pool */
+};
+
+static IoModeDef io_mode = IO_AUTO; /**< How directories are stat-ed. */
+static unsigned io_depth = IO_DEFAULT_DEPTH; /**< Requests in flight per batch. */
+static std::atomic<bool> uring_unavailable{false}; /**< Set once io_uring failed to set up or lacks statx. */
+static std::atomic<int> used_backend{BACKEND_NONE}; /**< The backend of the last batch. */
+
+/**
+ * @brief Stats one request synchronously.
+ * @param dirfd The open directory.
+ * @param request The request.
+ * @param flags The statx flags.
+ */
+static void stat_one(int dirfd, StatRequest &request, int flags)
+{
+    count_call(CALL_STATX);
+    request.error = statx(dirfd, request.name, flags, STATX_BASIC_STATS, &request.result) == 0 ? 0 : errno;
+}
+
+/**
+ * @brief A minimal io_uring instance, driven through the raw system calls.
+ *
+ * Each walker thread owns one, so submissions need no locking.
+ */
+class UringRing
+{
+public:
+    /**
+     * @brief Constructor. Sets up the ring and checks that it supports statx.
+     * @param depth The number of submission queue entries.
+     */
+    explicit UringRing(unsigned depth) : fd(-1), ring(nullptr), ring_size(0), sqes(nullptr), sqes_size(0), usable(false)
+    {
+        struct io_uring_params params = {};
+        fd = static_cast<int>(syscall(__NR_io_uring_setup, depth, &params));
+        if (fd < 0)
+            return; // Old kernel, or disabled by seccomp or kernel.io_uring_disabled
+
+        // IORING_OP_STATX arrived with the probe, so a failing probe means no statx either
+        std::vector<char> buffer(sizeof(struct io_uring_probe) + 256 * sizeof(struct io_uring_probe_op), 0);
+        struct io_uring_probe *probe = reinterpret_cast<struct io_uring_probe *>(buffer.data());
+        if (syscall(__NR_io_uring_register, fd, IORING_REGISTER_PROBE, probe, 256) < 0 || probe->last_op < IORING_OP_STATX ||
+            !(probe->ops[IORING_OP_STATX].flags & IO_URING_OP_SUPPORTED))
+        {
+            return;
+        }
+        if (!(params.features & IORING_FEAT_SINGLE_MMAP))
+            return; // Kernels before 5.4, which lack statx anyway
+
+        ring_size = std::max(params.sq_off.array + params.sq_entries * sizeof(unsigned),
+                             params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe));
+        ring = mmap(nullptr, ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+        if (ring == MAP_FAILED)
+        {
+            ring = nullptr;
+            return;
+        }
+        sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
+        void *map = mmap(nullptr, sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+        if (map == MAP_FAILED)
+            return;
+        sqes = static_cast<struct io_uring_sqe *>(map);
+
+        char *base = static_cast<char *>(ring);
+        sq_head = reinterpret_cast<unsigned *>(base + params.sq_off.head);
+        sq_tail = reinterpret_cast<unsigned *>(base + params.sq_off.tail);
+        sq_mask = *reinterpret_cast<unsigned *>(base + params.sq_off.ring_mask);
+        sq_array = reinterpret_cast<unsigned *>(base + params.sq_off.array);
+        cq_head = reinterpret_cast<unsigned *>(base + params.cq_off.head);
+        cq_tail = reinterpret_cast<unsigned *>(base + params.cq_off.tail);
+        cq_mask = *reinterpret_cast<unsigned *>(base + params.cq_off.ring_mask);
+        cqes = reinterpret_cast<struct io_uring_cqe *>(base + params.cq_off.cqes);
+        entries = params.sq_entries;
+        usable = true;
+    }
+
+    /**
+     * @brief Destructor. Unmaps and closes the ring.
+     */
+    ~UringRing()
+    {
+        if (sqes)
+            munmap(sqes, sqes_size);
+        if (ring)
+            munmap(ring, ring_size);
+        if (fd >= 0)
+            close(fd);
+    }
+
+    UringRing(const UringRing &) = delete;
+    UringRing &operator=(const UringRing &) = delete;
+
+    /**
+     * @brief Checks whether the ring was set up and supports statx.
+     * @return true if run() can be used.
+     */
+    bool ok() const { return usable; }
+
+    /**
+     * @brief Stats a batch, keeping up to the ring size in flight.
+     * @param dirfd The open directory.
+     * @param requests The requests.
+     * @param count The number of requests.
+     * @param flags The statx flags.
+     */
+    void run(int dirfd, StatRequest *requests, std::size_t count, int flags)
+    {
+        for (std::size_t index = 0; index < count; ++index)
+        {
+            requests[index].error = EIO; // Left on requests lost to a failing ring
+        }
+
+        count_call(CALL_STATX, count);
+        std::size_t submitted = 0;
+        std::size_t completed = 0;
+        while (completed < count)
+        {
+            unsigned tail = *sq_tail;
+            while (submitted < count && submitted - completed < entries)
+            {
+                unsigned index = tail & sq_mask;
+                struct io_uring_sqe *sqe = &sqes[index];
+                std::memset(sqe, 0, sizeof(*sqe));
+                sqe->opcode = IORING_OP_STATX;
+                sqe->fd = dirfd;
+                sqe->addr = reinterpret_cast<uint64_t>(requests[submitted].name);
+                sqe->len = STATX_BASIC_STATS;
+                sqe->off = reinterpret_cast<uint64_t>(&requests[submitted].result);
+                sqe->statx_flags = static_cast<uint32_t>(flags);
+                sqe->user_data = submitted;
+                sq_array[index] = index;
+                ++tail;
+                ++submitted;
+            }
+            __atomic_store_n(sq_tail, tail, __ATOMIC_RELEASE);
+
+            // Entries the kernel has not consumed yet, including those of an interrupted call
+            unsigned to_submit = tail - __atomic_load_n(sq_head, __ATOMIC_ACQUIRE);
+            count_call(CALL_URING_ENTER);
+            if (syscall(__NR_io_uring_enter, fd, to_submit, 1, IORING_ENTER_GETEVENTS, nullptr, 0) < 0 &&
+                errno != EINTR && errno != EAGAIN && errno != EBUSY)
+            {
+                usable = false;
+                drain(requests, submitted, completed);
+                break;
+            }
+            reap(requests, completed);
+        }
+    }
+
+private:
+    /**
+     * @brief Records the completions posted so far.
+     * @param requests The requests of the batch.
+     * @param completed The number of completed requests, increased.
+     */
+    void reap(StatRequest *requests, std::size_t &completed)
+    {
+        unsigned head = *cq_head;
+        unsigned ready = __atomic_load_n(cq_tail, __ATOMIC_ACQUIRE);
+        for (; head != ready; ++head)
+        {
+            const struct io_uring_cqe &cqe = cqes[head & cq_mask];
+            requests[cqe.user_data].error = cqe.res < 0 ? -cqe.res : 0;
+            ++completed;
+        }
+        __atomic_store_n(cq_head, head, __ATOMIC_RELEASE);
+    }
+
+    /**
+     * @brief Waits for every request the kernel took before the ring is given up.
+     *
+     * The kernel writes the results into the requests until their completion is
+     * posted, so the batch cannot be redone, nor the ring closed, before that.
+     * Entries it never took are withdrawn from the submission queue.
+     *
+     * @param requests The requests of the batch.
+     * @param submitted The number of requests queued.
+     * @param completed The number of completed requests, increased.
+     */
+    void drain(StatRequest *requests, std::size_t submitted, std::size_t &completed)
+    {
+        unsigned head = __atomic_load_n(sq_head, __ATOMIC_ACQUIRE);
+        std::size_t taken = submitted - (*sq_tail - head);
+        __atomic_store_n(sq_tail, head, __ATOMIC_RELEASE);
+
+        reap(requests, completed);
+        while (completed < taken)
+        {
+            // Completions are posted to the mapped ring even when entering it keeps failing
+            count_call(CALL_URING_ENTER);
+            if (syscall(__NR_io_uring_enter, fd, 0, 1, IORING_ENTER_GETEVENTS, nullptr, 0) < 0 && errno != EINTR)
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            reap(requests, completed);
+        }
+    }
+
+    int fd; /**< The io_uring instance. */
+    void *ring; /**< The mapped submission and completion rings. */
+    std::size_t ring_size; /**< The size of the ring mapping. */
+    struct io_uring_sqe *sqes; /**< The mapped submission queue entries. */
+    std::size_t sqes_size; /**< The size of the entries mapping. */
+    bool usable; /**< Whether run() can be used. */
+    unsigned *sq_head = nullptr; /**< Submission queue head, advanced by the kernel. */
+    unsigned *sq_tail = nullptr; /**< Submission queue tail, advanced by us. */
+    unsigned sq_mask = 0; /**< Submission queue index mask. */
+    unsigned *sq_array = nullptr; /**< Submission queue indirection array. */
+    unsigned *cq_head = nullptr; /**< Completion queue head, advanced by us. */
+    unsigned *cq_tail = nullptr; /**< Completion queue tail, advanced by the kernel. */
+    unsigned cq_mask = 0; /**< Completion queue index mask. */
+    struct io_uring_cqe *cqes = nullptr; /**< The completion queue entries. */
+    unsigned entries = 0; /**< Number of submission queue entries. */
+};
+
+/**
+ * @brief One batch shared by the threads of the pool.
+ */
+struct StatJob
+{
+    int dirfd = -1; /**< The open directory. */
+    StatRequest *requests = nullptr; /**< The requests. */
+    std::size_t count = 0; /**< The number of requests. */
+    int flags = 0; /**< The statx flags. */
+    std::atomic<std::size_t> next{0}; /**< Next request to claim. */
+    std::atomic<std::size_t> done{0}; /**< Number of finished requests. */
+    std::mutex mutex; /**< Protects the wait for the last request. */
+    std::condition_variable finished; /**< Signalled when the last request is done. */
+
+    /**
+     * @brief Claims and runs requests until none are left.
+     */
+    void work()
+    {
+        std::size_t index;
+        while ((index = next.fetch_add(1)) < count)
+        {
+            stat_one(dirfd, requests[index], flags);
+            if (done.fetch_add(1) + 1 == count)
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                finished.notify_all();
+            }
+        }
+    }
+};
+
+/**
+ * @brief Pool of threads issuing blocking stat calls, the fallback when io_uring is not available.
+ *
+ * The submitting thread works on its own batch too, so a batch never waits for a free thread.
+ */
+class StatPool
+{
+public:
+    /**
+     * @brief Constructor. Starts the threads.
+     * @param size The number of threads.
+     */
+    explicit StatPool(unsigned size) : stopping(false)
+    {
+        for (unsigned i = 0; i < size; ++i)
+        {
+            threads.emplace_back(&StatPool::serve, this);
+        }
+    }
+
+    /**
+     * @brief Destructor. Stops and joins the threads.
+     */
+    ~StatPool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        wake.notify_all();
+        for (std::thread &thread : threads)
+        {
+            thread.join();
+        }
+    }
+
+    /**
+     * @brief Runs a batch and waits until all its requests are done.
+     * @param job The batch.
+     */
+    void run(const std::shared_ptr<StatJob> &job)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            jobs.push_back(job);
+        }
+        wake.notify_all();
+        job->work();
+
+        {
+            std::unique_lock<std::mutex> lock(job->mutex);
+            job->finished.wait(lock, [&]
+                               { return job->done == job->count; });
+        }
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = std::find(jobs.begin(), jobs.end(), job);
+        if (it != jobs.end())
+            jobs.erase(it);
+    }
+
+private:
+    std::mutex mutex; /**< Protects jobs and stopping. */
+    std::condition_variable wake; /**< Signalled when a job is queued or the pool stops. */
+    std::deque<std::shared_ptr<StatJob>> jobs; /**< Batches with requests left to claim. */
+    std::vector<std::thread> threads; /**< The threads. */
+    bool stopping; /**< Whether the threads must exit. */
+
+    /**
+     * @brief Thread body: helps the oldest batch until the pool stops.
+     */
+    void serve()
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        while (true)
+        {
+            wake.wait(lock, [&]
+                      { return stopping || !jobs.empty(); });
+            if (stopping)
+                return;
+
+            std::shared_ptr<StatJob> job = jobs.front();
+            if (job->next >= job->count)
+            {
+                jobs.pop_front();
+                continue;
+            }
+            lock.unlock();
+            job->work();
+            lock.lock();
+        }
+    }
+};
+
+/**
+ * @brief Checks whether a file system type is served over a network or by a FUSE daemon.
+ * @param type The type from /proc/self/mountinfo.
+ * @return true for file systems where a stat is a round trip.
+ */
+static bool is_remote_type(const std::string &type)
+{
+    static const char *const remote[] = {"nfs", "nfs4", "cifs", "smb3", "smbfs", "ncpfs", "9p", "ceph", "glusterfs",
+                                         "afs", "lustre", "gpfs", "beegfs", "fuse", "fuseblk"};
+    for (const char *name : remote)
+    {
+        if (type == name)
+            return true;
+    }
+    return type.compare(0, 5, "fuse.") == 0;
+}
+
+/**
+ * @brief Gets the devices of the mounted network and FUSE file systems, read once.
+ * @return The device numbers.
+ */
+static const std::unordered_set<uint64_t> &remote_devices()
+{
+    static const std::unordered_set<uint64_t> devices = []
+    {
+        std::unordered_set<uint64_t> result;
+        std::ifstream mountinfo("/proc/self/mountinfo");
+        std::string line;
+        while (std::getline(mountinfo, line))
+        {
+            // "id parent major:minor root mount-point options [tags...] - type source super-options"
+            std::istringstream fields(line);
+            std::string id, parent, device, field;
+            fields >> id >> parent >> device;
+            while (fields >> field && field != "-")
+            {
+            }
+            std::string type;
+            unsigned major_number = 0, minor_number = 0;
+            if (fields >> type && std::sscanf(device.c_str(), "%u:%u", &major_number, &minor_number) == 2 && is_remote_type(type))
+            {
+                result.insert(makedev(major_number, minor_number));
+            }
+        }
+        return result;
+    }();
+    return devices;
+}
+
+/**
+ * @brief Sets how directories are stat-ed, before any scan starts.
+ * @param mode IO_AUTO to batch on network and FUSE file systems only, IO_BATCH
+ *        to batch everywhere, IO_SYNC to stat one entry at a time.
+ * @param depth The number of requests in flight per batch.
+ */
+void configure_batch_stat(IoModeDef mode, unsigned depth)
+{
+    io_mode = mode;
+    io_depth = std::clamp(depth, 1u, 4096u);
+}
+
+/**
+ * @brief Checks whether the entries of a directory should be stat-ed as a batch.
+ * @param dirfd The open directory.
+ * @param count The number of entries to stat.
+ * @return true to call batch_stat(), false to stat the entries one by one.
+ */
+bool batch_stat_wanted(int dirfd, std::size_t count)
+{
+    if (io_mode == IO_SYNC || io_depth < 2 || count < IO_BATCH_MIN)
+        return false;
+    if (io_mode == IO_BATCH)
+        return true;
+
+    // On local file systems io_uring hands statx to worker threads, which only adds overhead
+    struct stat st;
+    const std::unordered_set<uint64_t> &remote = remote_devices();
+    return !remote.empty() && fstat(dirfd, &st) == 0 && remote.count(st.st_dev) > 0;
+}
+
+/**
+ * @brief Stats a batch of entries of one directory.
+ * @param dirfd The open directory the names are relative to.
+ * @param requests The requests.
+ * @param count The number of requests.
+ * @param follow_links Whether to stat the targets of symbolic links.
+ */
+void batch_stat(int dirfd, StatRequest *requests, std::size_t count, bool follow_links)
+{
+    int flags = follow_links ? 0 : AT_SYMLINK_NOFOLLOW;
+    scan_stats.stat_batches++;
+
+    if (!uring_unavailable)
+    {
+        thread_local std::unique_ptr<UringRing> ring;
+        if (!ring)
+            ring = std::make_unique<UringRing>(io_depth);
+        if (ring->ok())
+        {
+            used_backend = BACKEND_URING;
+            ring->run(dirfd, requests, count, flags);
+            if (ring->ok())
+                return;
+            ring.reset(); // The ring broke, the whole batch is redone through the pool
+        }
+        uring_unavailable = true;
+    }
+
+    static StatPool pool(std::min(io_depth, IO_MAX_THREADS) - 1);
+    auto job = std::make_shared<StatJob>();
+    job->dirfd = dirfd;
+    job->requests = requests;
+    job->count = count;
+    job->flags = flags;
+    used_backend = BACKEND_THREADS;
+    pool.run(job);
+}
+
+/**
+ * @brief Gets the name of the backend used by batches.
+ * @return "io_uring", "threads", or "none" if no batch ran.
+ */
+const char *batch_stat_backend()
+{
+    switch (used_backend)
+    {
+    case BACKEND_URING:
+        return "io_uring";
+    case BACKEND_THREADS:
+        return "threads";
+    default:
+        return "none";
+    }
+}
@@ -0,0 +1,212 @@
+/**
+ ******************************************************************************
+ * @file    myCollate.cpp
+ * @brief   Implementation of the name sort keys: case folding, natural number
+ *          runs and simple Unicode folding, without locale or ICU.
+ * @author  Arun, Sagar, Saurav
+ * @date    March 7, 2024
+ ******************************************************************************
+ */
+
+#include "myCollate.hpp"
+#include <algorithm>
+#include <cstring>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+/**
+ * @brief Lowercases the ASCII letters of a name and tells what else it holds.
+ *
+ * Sixteen bytes at a time with SSE2. Bytes of multibyte characters are left
+ * as they are.
+ *
+ * @param name The name.
+ * @param size The length of the name.
+ * @param out Receives @p size bytes.
+ * @param has_digit Set to whether the name holds a digit.
+ * @param has_multibyte Set to whether the name holds a byte above 0x7F.
+ */
+static void lower_ascii(const char *name, std::size_t size, char *out, bool &has_digit, bool &has_multibyte)
+{
+    std::size_t index = 0;
+    has_digit = false;
+    has_multibyte = false;
+#if defined(__SSE2__)
+    const __m128i before_upper = _mm_set1_epi8('A' - 1);
+    const __m128i after_upper = _mm_set1_epi8('Z' + 1);
+    const __m128i before_digit = _mm_set1_epi8('0' - 1);
+    const __m128i after_digit = _mm_set1_epi8('9' + 1);
+    const __m128i case_bit = _mm_set1_epi8(0x20);
+    int digits = 0;
+    int multibyte = 0;
+    for (; index + 16 <= size; index += 16)
+    {
+        __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i *>(name + index));
+        // Bytes above 0x7F are negative as signed, so they are neither letters nor digits
+        __m128i upper = _mm_and_si128(_mm_cmpgt_epi8(bytes, before_upper), _mm_cmplt_epi8(bytes, after_upper));
+        __m128i digit = _mm_and_si128(_mm_cmpgt_epi8(bytes, before_digit), _mm_cmplt_epi8(bytes, after_digit));
+        digits |= _mm_movemask_epi8(digit);
+        multibyte |= _mm_movemask_epi8(bytes);
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(out + index), _mm_or_si128(bytes, _mm_and_si128(upper, case_bit)));
+    }
+    has_digit = digits != 0;
+    has_multibyte = multibyte != 0;
+#endif
+    for (; index < size; ++index)
+    {
+        char c = name[index];
+        has_digit |= c >= '0' && c <= '9';
+        has_multibyte |= static_cast<unsigned char>(c) > 0x7F;
+        out[index] = c >= 'A' && c <= 'Z' ? static_cast<char>(c + 0x20) : c;
+    }
+}
+
+/**
+ * @brief Simple case folding of the upper case letters of Latin-1, Latin Extended-A, Greek and Cyrillic.
+ * @param code The code point.
+ * @return The lower case code point, @p code itself for anything else.
+ */
+static uint32_t fold_code_point(uint32_t code)
+{
+    if (code >= 0xC0 && code <= 0xDE && code != 0xD7)
+        return code + 0x20;
+    if ((code >= 0x100 && code <= 0x12F) || (code >= 0x132 && code <= 0x137) || (code >= 0x14A && code <= 0x177))
+        return code | 1;
+    if ((code >= 0x139 && code <= 0x148) || (code >= 0x179 && code <= 0x17E))
+        return code + (code & 1);
+    if (code == 0x178)
+        return 0xFF;
+    if (code >= 0x391 && code <= 0x3A9 && code != 0x3A2)
+        return code + 0x20;
+    if (code >= 0x410 && code <= 0x42F)
+        return code + 0x20;
+    if (code >= 0x400 && code <= 0x40F)
+        return code + 0x50;
+    return code;
+}
+
+/**
+ * @brief Decodes a two-byte UTF-8 character, the only length the folded letters use.
+ * @param data The bytes.
+ * @param size The number of bytes left.
+ * @param code Set to the code point.
+ * @return true for a well-formed two-byte character.
+ */
+static bool decode_two_bytes(const char *data, std::size_t size, uint32_t &code)
+{
+    unsigned char lead = static_cast<unsigned char>(data[0]);
+    if (size < 2 || lead < 0xC2 || lead > 0xDF || (data[1] & 0xC0) != 0x80)
+        return false;
+    code = (static_cast<uint32_t>(lead & 0x1F) << 6) | (data[1] & 0x3F);
+    return true;
+}
+
+/**
+ * @brief Appends the sort key of a name.
+ *
+ * The key is the folded name, then a 0 byte and the name itself, so keys
+ * only tie for equal names and a name sorts before its extensions. A run of
+ * digits becomes '0', its length without leading zeros and those digits, so
+ * at equal positions shorter numbers go first and a number sorts where a
+ * digit would among other characters.
+ *
+ * @param key The key, appended to.
+ * @param name The name.
+ * @param flags The NameOrderDef bits.
+ */
+void append_name_key(std::string &key, std::string_view name, unsigned flags)
+{
+    std::size_t start = key.size();
+    bool has_digit = true;
+    bool has_multibyte = true;
+    key.resize(start + name.size());
+    if (flags & NAME_FOLD_CASE)
+        lower_ascii(name.data(), name.size(), &key[start], has_digit, has_multibyte);
+    else if (!name.empty())
+        std::memcpy(&key[start], name.data(), name.size());
+
+    // Most names are plain ASCII words, the lowered bytes are their key
+    bool natural = (flags & NAME_NATURAL) && has_digit;
+    bool unicode = (flags & NAME_FOLD_UNICODE) && has_multibyte;
+    if (natural || unicode)
+    {
+        std::string folded = key.substr(start);
+        key.resize(start);
+        for (std::size_t index = 0; index < folded.size();)
+        {
+            char c = folded[index];
+            uint32_t code;
+            if (natural && c >= '0' && c <= '9')
+            {
+                std::size_t end = index;
+                while (end < folded.size() && folded[end] >= '0' && folded[end] <= '9')
+                {
+                    end++;
+                }
+                while (index + 1 < end && folded[index] == '0')
+                {
+                    index++;
+                }
+                // Names are at most 255 bytes, so is the length of a number; it is never 0
+                key += '0';
+                key += static_cast<char>(std::min<std::size_t>(end - index, 255));
+                key.append(folded, index, end - index);
+                index = end;
+            }
+            else if (unicode && decode_two_bytes(folded.data() + index, folded.size() - index, code))
+            {
+                code = fold_code_point(code);
+                key += static_cast<char>(0xC0 | (code >> 6));
+                key += static_cast<char>(0x80 | (code & 0x3F));
+                index += 2;
+            }
+            else
+            {
+                key += c;
+                index++;
+            }
+        }
+    }
+
+    key += '\0';
+    key.append(name.data(), name.size());
+}
+
+/**
+ * @brief Compares two names in the order of the views.
+ * @param a The first name.
+ * @param b The second name.
+ * @return true if @p a goes before @p b.
+ */
+bool name_less(std::string_view a, std::string_view b)
+{
+    std::string key_a;
+    std::string key_b;
+    append_name_key(key_a, a);
+    append_name_key(key_b, b);
+    return key_a < key_b;
+}
+
+/**
+ * @brief Reserves room for names.
+ * @param count The number of names.
+ * @param bytes Their total length.
+ */
+void NameKeys::reserve(std::size_t count, std::size_t bytes)
+{
+    offsets.reserve(count + 1);
+    buffer.reserve(bytes * 2 + count);
+}
+
+/**
+ * @brief Appends the key of a name.
+ * @param name The name.
+ * @param flags The NameOrderDef bits.
+ */
+void NameKeys::add(std::string_view name, unsigned flags)
+{
+    append_name_key(buffer, name, flags);
+    offsets.push_back(static_cast<uint32_t>(buffer.size()));
+}
@@ -8,83 +8,316 @@
  */
 
 #include "myColors.hpp"
-#include <iostream>
+#include "myOutput.hpp"
+#include "myStats.hpp"
+#include <cstdint>
+#include <cstdlib>
+#include <deque>
+#include <string>
 #include <sys/stat.h>
-#include <unistd.h>
+#include <unordered_map>
+#include <utility>
+#include <vector>
 
 /**
  * @brief Print colored text to the console.
  *
- * This function prints the given text in the specified color.
+ * This function prints the given text in the specified color. The escape codes
+ * are left out when the output sink has colors disabled.
  *
  * @param text The text to be printed.
  * @param color The color to be used for printing.
  */
-void print_colored_text(const std::string &text, const std::string &color) 
+void print_colored_text(std::string_view text, std::string_view color)
 {
-    std::cout << color << text << COLOR_RESET;
+    Output &sink = out();
+    sink.color(color);
+    sink << text;
+    sink.color(COLOR_RESET);
 }
 
 /**
- * @brief Get the color for a file based on its name and visibility.
- *
- * This function determines the appropriate color for a file based on its name and visibility.
- *
- * @param filename The name of the file.
- * @param is_hidden A boolean indicating whether the file is hidden or not.
- * @return The color code for the file.
+ * @brief The colors of one kind of file, shown and hidden.
+ */
+struct ColorPair
+{
+    std::string_view shown; /**< The color of visible files. */
+    std::string_view hidden; /**< The color of hidden files. */
+};
+
+/**
+ * @brief A file extension and its colors.
+ */
+struct ExtensionColor
+{
+    std::string_view extension; /**< The extension, lowercase and without the dot. */
+    ColorPair color; /**< Its colors. */
+};
+
+constexpr ColorPair COLORS_ARCHIVE = {COLOR_MAGENTA, COLOR_FAINT_MAGENTA};
+constexpr ColorPair COLORS_MEDIA = {COLOR_CYAN, COLOR_FAINT_CYAN};
+constexpr ColorPair COLORS_DOCUMENT = {COLOR_GREEN, COLOR_FAINT_GREEN};
+
+/**
+ * @brief The extension colors used when LS_COLORS is not set.
+ */
+constexpr ExtensionColor DEFAULT_EXTENSIONS[] = {
+    {"7z", COLORS_ARCHIVE}, {"bz2", COLORS_ARCHIVE}, {"deb", COLORS_ARCHIVE}, {"gz", COLORS_ARCHIVE},
+    {"iso", COLORS_ARCHIVE}, {"jar", COLORS_ARCHIVE}, {"lz4", COLORS_ARCHIVE}, {"rar", COLORS_ARCHIVE},
+    {"rpm", COLORS_ARCHIVE}, {"tar", COLORS_ARCHIVE}, {"tgz", COLORS_ARCHIVE}, {"xz", COLORS_ARCHIVE},
+    {"zip", COLORS_ARCHIVE}, {"zst", COLORS_ARCHIVE},
+    {"avi", COLORS_MEDIA}, {"bmp", COLORS_MEDIA}, {"flac", COLORS_MEDIA}, {"gif", COLORS_MEDIA},
+    {"ico", COLORS_MEDIA}, {"jpeg", COLORS_MEDIA}, {"jpg", COLORS_MEDIA}, {"mkv", COLORS_MEDIA},
+    {"mov", COLORS_MEDIA}, {"mp3", COLORS_MEDIA}, {"mp4", COLORS_MEDIA}, {"ogg", COLORS_MEDIA},
+    {"png", COLORS_MEDIA}, {"svg", COLORS_MEDIA}, {"wav", COLORS_MEDIA}, {"webm", COLORS_MEDIA},
+    {"webp", COLORS_MEDIA},
+    {"doc", COLORS_DOCUMENT}, {"docx", COLORS_DOCUMENT}, {"epub", COLORS_DOCUMENT}, {"md", COLORS_DOCUMENT},
+    {"odt", COLORS_DOCUMENT}, {"pdf", COLORS_DOCUMENT}, {"txt", COLORS_DOCUMENT},
+};
+constexpr std::size_t DEFAULT_EXTENSION_COUNT = sizeof(DEFAULT_EXTENSIONS) / sizeof(DEFAULT_EXTENSIONS[0]);
+constexpr std::size_t EXTENSION_SLOTS = 256; /**< Slots of the perfect hash, a power of two. */
+constexpr std::size_t EXTENSION_MAX = 15; /**< Longest extension looked up in the compiled-in table. */
+static_assert(DEFAULT_EXTENSION_COUNT < EXTENSION_SLOTS, "every extension needs a slot");
+
+/**
+ * @brief Hashes an extension with FNV-1a.
+ * @param extension The extension, lowercase.
+ * @param seed Mixed into the hash, to look for a seed without collisions.
+ * @return The hash.
  */
-std::string get_file_color(const std::string &filename, bool is_hidden)
+constexpr uint32_t extension_hash(std::string_view extension, uint32_t seed)
 {
-    struct stat file_stat;
-    if (stat(filename.c_str(), &file_stat) != 0)
+    uint32_t hash = 2166136261u ^ seed;
+    for (char c : extension)
     {
-        // Error occurred while retrieving file information
-        return COLOR_FAINT_WHITE;
+        hash = (hash ^ static_cast<unsigned char>(c)) * 16777619u;
     }
+    return hash;
+}
 
-    if (S_ISDIR(file_stat.st_mode))
+/**
+ * @brief A perfect hash of DEFAULT_EXTENSIONS: every extension in a slot of its own.
+ */
+struct ExtensionHash
+{
+    uint32_t seed = 0; /**< The seed giving no collision. */
+    uint8_t slots[EXTENSION_SLOTS] = {}; /**< Index + 1 of the extension in a slot, 0 for none. */
+};
+
+/**
+ * @brief Looks for the first seed that hashes every default extension to a different slot.
+ * @return The perfect hash.
+ */
+constexpr ExtensionHash build_extension_hash()
+{
+    for (uint32_t seed = 0;; ++seed)
     {
-        if (is_hidden)
-        {
-            return COLOR_HIDDEN_FOLDER;
-        }
-        else
+        ExtensionHash table;
+        table.seed = seed;
+        bool collision = false;
+        for (std::size_t index = 0; index < DEFAULT_EXTENSION_COUNT && !collision; ++index)
         {
-            return COLOR_FOLDER;
+            std::size_t slot = extension_hash(DEFAULT_EXTENSIONS[index].extension, seed) & (EXTENSION_SLOTS - 1);
+            collision = table.slots[slot] != 0;
+            table.slots[slot] = static_cast<uint8_t>(index + 1);
         }
+        if (!collision)
+            return table;
     }
-    else if (access(filename.c_str(), X_OK) == 0)
+}
+
+/**
+ * @brief The perfect hash, found by the compiler.
+ */
+constexpr ExtensionHash DEFAULT_EXTENSION_HASH = build_extension_hash();
+
+/**
+ * @brief The colors in use: the built-in ones, or those of LS_COLORS.
+ */
+struct ColorTable
+{
+    ColorPair directory = {COLOR_FOLDER, COLOR_HIDDEN_FOLDER}; /**< The colors of directories, LS_COLORS di. */
+    ColorPair file = {COLOR_FILE, COLOR_HIDDEN_FILE}; /**< The colors of regular files, LS_COLORS fi. */
+    ColorPair executable = {COLOR_EXECUTABLE, COLOR_HIDDEN_EXECUTABLE}; /**< The colors of executables, LS_COLORS ex. */
+    bool from_environment = false; /**< Whether LS_COLORS replaced the compiled-in extensions. */
+    std::unordered_map<std::string, ColorPair> extensions; /**< LS_COLORS *.ext entries, lowercase, without the dot. */
+    std::vector<std::pair<std::string, ColorPair>> suffixes; /**< Other LS_COLORS * entries, lowercase. */
+    std::deque<std::string> escapes; /**< The escape sequences built from LS_COLORS, which the pairs point into. */
+
+    /**
+     * @brief Turns an LS_COLORS value into colors.
+     * @param code SGR parameters, e.g. "01;34".
+     * @return The colors, the hidden one faint.
+     */
+    ColorPair make_pair(std::string_view code)
     {
-        if (is_hidden)
-        {
-            return COLOR_HIDDEN_EXECUTABLE;
-        }
-        else
-        {
-            return COLOR_EXECUTABLE;
-        }
+        escapes.push_back("\033[" + std::string(code) + "m");
+        std::string_view shown = escapes.back();
+        escapes.push_back("\033[2;" + std::string(code) + "m");
+        return {shown, escapes.back()};
     }
-    else if (S_ISREG(file_stat.st_mode))
+};
+
+/**
+ * @brief Lowercases ASCII letters.
+ * @param text The text.
+ * @return The text, lowercase.
+ */
+static std::string to_lower(std::string_view text)
+{
+    std::string lower(text);
+    for (char &c : lower)
+    {
+        if (c >= 'A' && c <= 'Z')
+            c = static_cast<char>(c - 'A' + 'a');
+    }
+    return lower;
+}
+
+/**
+ * @brief Builds the color table from LS_COLORS, once.
+ *
+ * Only the di, fi and ex keys and the * patterns are used; the others describe
+ * types the views do not tell apart. Values other than SGR parameters are
+ * ignored, so no other escape sequence reaches the output. As with ls, a set
+ * LS_COLORS replaces the compiled-in extension colors.
+ *
+ * @return The table.
+ */
+static const ColorTable &color_table()
+{
+    static const ColorTable table = []
     {
-        if (is_hidden)
+        ColorTable built;
+        const char *variable = std::getenv("LS_COLORS");
+        if (!variable || !*variable)
+            return built;
+
+        built.from_environment = true;
+        std::string_view entries = variable;
+        while (!entries.empty())
         {
-            return COLOR_HIDDEN_FILE;
+            std::size_t end = std::min(entries.find(':'), entries.size());
+            std::string_view entry = entries.substr(0, end);
+            entries.remove_prefix(std::min(end + 1, entries.size()));
+
+            std::size_t equals = entry.find('=');
+            if (equals == std::string_view::npos || equals == 0)
+                continue;
+            std::string_view key = entry.substr(0, equals);
+            std::string_view code = entry.substr(equals + 1);
+            if (code.empty() || code.find_first_not_of("0123456789;") != std::string_view::npos)
+                continue;
+
+            if (key == "di")
+                built.directory = built.make_pair(code);
+            else if (key == "fi")
+                built.file = built.make_pair(code);
+            else if (key == "ex")
+                built.executable = built.make_pair(code);
+            else if (key.size() > 2 && key.substr(0, 2) == "*." && key.find('.', 2) == std::string_view::npos)
+                built.extensions[to_lower(key.substr(2))] = built.make_pair(code);
+            else if (key.size() > 1 && key[0] == '*')
+                built.suffixes.emplace_back(to_lower(key.substr(1)), built.make_pair(code));
         }
-        else
+        return built;
+    }();
+    return table;
+}
+
+/**
+ * @brief Finds the colors of a file name from its extension.
+ * @param table The color table.
+ * @param name The name.
+ * @return The colors, nullptr when the extension has none.
+ */
+static const ColorPair *extension_color(const ColorTable &table, std::string_view name)
+{
+    // A leading dot makes a file hidden, it does not start an extension
+    std::size_t dot = name.rfind('.');
+    if (dot == std::string_view::npos || dot == 0 || dot + 1 == name.size())
+        return nullptr;
+    std::string_view extension = name.substr(dot + 1);
+
+    if (!table.from_environment)
+    {
+        if (extension.size() > EXTENSION_MAX)
+            return nullptr;
+        char lower[EXTENSION_MAX];
+        for (std::size_t index = 0; index < extension.size(); ++index)
         {
-            return COLOR_FILE;
+            char c = extension[index];
+            lower[index] = c >= 'A' && c <= 'Z' ? static_cast<char>(c - 'A' + 'a') : c;
         }
+        std::string_view key(lower, extension.size());
+        uint8_t slot = DEFAULT_EXTENSION_HASH.slots[extension_hash(key, DEFAULT_EXTENSION_HASH.seed) & (EXTENSION_SLOTS - 1)];
+        if (slot == 0 || DEFAULT_EXTENSIONS[slot - 1].extension != key)
+            return nullptr;
+        return &DEFAULT_EXTENSIONS[slot - 1].color;
+    }
+
+    std::string lower = to_lower(name);
+    for (const auto &suffix : table.suffixes)
+    {
+        if (lower.size() >= suffix.first.size() && lower.compare(lower.size() - suffix.first.size(), suffix.first.size(), suffix.first) == 0)
+            return &suffix.second;
+    }
+    auto found = table.extensions.find(lower.substr(dot + 1));
+    return found == table.extensions.end() ? nullptr : &found->second;
+}
+
+/**
+ * @brief Get the color for a file from its type, permission bits and name.
+ *
+ * Directories and executables get their colors first, whatever their name;
+ * other regular files get the color of their extension, if it has one. The
+ * extension colors come from LS_COLORS when it is set, otherwise from a table
+ * compiled in. No system call is made.
+ *
+ * @param type The entry type, symbolic links resolved.
+ * @param is_executable Whether an executable bit is set.
+ * @param is_hidden A boolean indicating whether the file is hidden or not.
+ * @param name The name of the file, for its extension.
+ * @return The color code for the file.
+ */
+std::string_view get_file_color(EntryTypeDef type, bool is_executable, bool is_hidden, std::string_view name)
+{
+    const ColorTable &table = color_table();
+    const ColorPair *color;
+    if (type == ENTRY_DIRECTORY)
+    {
+        color = &table.directory;
+    }
+    else if (is_executable)
+    {
+        color = &table.executable;
+    }
+    else if (type == ENTRY_FILE)
+    {
+        color = extension_color(table, name);
+        if (!color)
+            color = &table.file;
     }
     else
     {
-        if (is_hidden)
-        {
-            return COLOR_FAINT_WHITE;
-        }
-        else
-        {
-            return COLOR_FAINT_WHITE;
-        }
+        return COLOR_FAINT_WHITE;
     }
+    return is_hidden ? color->hidden : color->shown;
+}
+
+/**
+ * @brief Get the color for a directory entry from its cached metadata.
+ *
+ * Regular files must have been stat-ed for the executable bits to be known.
+ *
+ * @param entry The cached metadata of the entry.
+ * @param is_hidden A boolean indicating whether the file is hidden or not.
+ * @return The color code for the entry.
+ */
+std::string_view get_file_color(const EntryInfo &entry, bool is_hidden)
+{
+    PhaseTimer timer(PHASE_COLOR);
+    // The permission bits of an unresolved symbolic link are always rwx and mean nothing
+    bool is_executable = entry.has_stat && !S_ISLNK(entry.mode) && (entry.mode & (S_IXUSR | S_IXGRP | S_IXOTH));
+    return get_file_color(entry.type, is_executable, is_hidden, entry.name);
 }
@@ -0,0 +1,518 @@
+/**
+ ******************************************************************************
+ * @file    myDupes.cpp
+ * @brief   Implementation of the duplicate-file view.
+ * @author  Arun, Sagar, Saurav
+ * @date    March 7, 2024
+ ******************************************************************************
+ */
+
+#include "myDupes.hpp"
+#include "myColors.hpp"
+#include "myEntry.hpp"
+#include "myFilter.hpp"
+#include "myOutput.hpp"
+#include "mySort.hpp"
+#include "myStats.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <iostream>
+#include <memory>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/**
+ * @brief Streaming XXH64: a non-cryptographic hash that keeps four independent
+ *        64-bit lanes, so compilers pipeline or vectorize its inner loop.
+ */
+class ContentHash
+{
+public:
+    /**
+     * @brief Appends bytes to the hashed contents.
+     * @param data The bytes.
+     * @param length The number of bytes.
+     */
+    void update(const char *data, std::size_t length)
+    {
+        total += length;
+        if (buffered + length < sizeof(buffer))
+        {
+            std::memcpy(buffer + buffered, data, length);
+            buffered += length;
+            return;
+        }
+        if (buffered > 0)
+        {
+            std::size_t fill = sizeof(buffer) - buffered;
+            std::memcpy(buffer + buffered, data, fill);
+            stripe(buffer);
+            data += fill;
+            length -= fill;
+            buffered = 0;
+        }
+        for (; length >= sizeof(buffer); data += sizeof(buffer), length -= sizeof(buffer))
+        {
+            stripe(data);
+        }
+        std::memcpy(buffer, data, length);
+        buffered = length;
+    }
+
+    /**
+     * @brief Gets the hash of the bytes appended so far.
+     * @return The hash.
+     */
+    uint64_t digest() const
+    {
+        uint64_t hash;
+        if (total >= sizeof(buffer))
+        {
+            hash = rotl(lanes[0], 1) + rotl(lanes[1], 7) + rotl(lanes[2], 12) + rotl(lanes[3], 18);
+            for (uint64_t lane : lanes)
+            {
+                hash = (hash ^ round(0, lane)) * PRIME1 + PRIME4;
+            }
+        }
+        else
+        {
+            hash = PRIME5;
+        }
+        hash += total;
+
+        const char *tail = buffer;
+        std::size_t left = buffered;
+        for (; left >= 8; tail += 8, left -= 8)
+        {
+            hash = rotl(hash ^ round(0, read64(tail)), 27) * PRIME1 + PRIME4;
+        }
+        if (left >= 4)
+        {
+            uint32_t word;
+            std::memcpy(&word, tail, 4);
+            hash = rotl(hash ^ (word * PRIME1), 23) * PRIME2 + PRIME3;
+            tail += 4;
+            left -= 4;
+        }
+        for (; left > 0; ++tail, --left)
+        {
+            hash = rotl(hash ^ (static_cast<unsigned char>(*tail) * PRIME5), 11) * PRIME1;
+        }
+
+        hash ^= hash >> 33;
+        hash *= PRIME2;
+        hash ^= hash >> 29;
+        hash *= PRIME3;
+        hash ^= hash >> 32;
+        return hash;
+    }
+
+private:
+    static constexpr uint64_t PRIME1 = 11400714785074694791ULL;
+    static constexpr uint64_t PRIME2 = 14029467366897019727ULL;
+    static constexpr uint64_t PRIME3 = 1609587929392839161ULL;
+    static constexpr uint64_t PRIME4 = 9650029242287828579ULL;
+    static constexpr uint64_t PRIME5 = 2870177450012600261ULL;
+
+    uint64_t lanes[4] = {PRIME1 + PRIME2, PRIME2, 0, 0 - PRIME1}; /**< The four accumulators, seed 0. */
+    char buffer[32]; /**< Bytes not yet folded into the lanes. */
+    std::size_t buffered = 0; /**< Number of bytes in buffer. */
+    uint64_t total = 0; /**< Number of bytes appended. */
+
+    static uint64_t rotl(uint64_t value, int bits) { return (value << bits) | (value >> (64 - bits)); }
+    static uint64_t round(uint64_t lane, uint64_t input) { return rotl(lane + input * PRIME2, 31) * PRIME1; }
+    static uint64_t read64(const char *data)
+    {
+        uint64_t value;
+        std::memcpy(&value, data, 8);
+        return value;
+    }
+
+    void stripe(const char *data)
+    {
+        for (int lane = 0; lane < 4; ++lane)
+        {
+            lanes[lane] = round(lanes[lane], read64(data + 8 * lane));
+        }
+    }
+};
+
+/**
+ * @brief A regular file that may have duplicates.
+ */
+struct DupeFile
+{
+    std::string path; /**< The path relative to the walked directory. */
+    uint64_t size; /**< The apparent size. */
+    uint64_t dev; /**< The device number. */
+    uint64_t ino; /**< The inode number. */
+    uint64_t hash = 0; /**< The hash of the last stage. */
+    bool failed = false; /**< Whether the file could not be read. */
+};
+
+/**
+ * @brief A directory to walk.
+ */
+struct DupeTask
+{
+    std::string path; /**< The path relative to the walked directory, empty for the root. */
+    std::shared_ptr<const FilterScope> scope; /**< The filter scope of the parent directory. */
+};
+
+/**
+ * @brief Hashes a file, its two ends or its whole contents.
+ * @param root The walked directory.
+ * @param file The file; its hash is set, or failed if it cannot be read or changed size.
+ * @param full Whether to hash the whole contents, read sequentially.
+ */
+static void hash_file(const std::string &root, DupeFile &file, bool full)
+{
+    PhaseTimer timer(PHASE_HASH);
+    std::string path = root + "/" + file.path;
+    count_call(CALL_OPEN);
+    int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+    {
+        std::cerr << "Error: cannot read file '" << path << "': " << std::strerror(errno) << std::endl;
+        file.failed = true;
+        return;
+    }
+
+    ContentHash hash;
+    uint64_t read_bytes = 0;
+    int error = 0;
+    if (full)
+    {
+        // One buffer per thread, reused by every file the thread hashes
+        thread_local std::unique_ptr<char[]> buffer(new char[DUPES_READ_SIZE]);
+        posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+        ssize_t count;
+        while ((count = read(fd, buffer.get(), DUPES_READ_SIZE)) > 0)
+        {
+            count_call(CALL_READ);
+            hash.update(buffer.get(), static_cast<std::size_t>(count));
+            read_bytes += static_cast<uint64_t>(count);
+        }
+        count_call(CALL_READ); // The read that ended the loop
+        error = count < 0 ? errno : 0;
+        file.failed = count < 0 || read_bytes != file.size;
+    }
+    else
+    {
+        // The head and the tail; together they cover files up to twice DUPES_EDGE_SIZE
+        char buffer[2 * DUPES_EDGE_SIZE];
+        std::size_t head = static_cast<std::size_t>(std::min<uint64_t>(file.size, DUPES_EDGE_SIZE));
+        std::size_t tail = file.size > DUPES_EDGE_SIZE ? DUPES_EDGE_SIZE : 0;
+        ssize_t head_count = pread(fd, buffer, head, 0);
+        ssize_t tail_count = tail > 0 ? pread(fd, buffer + head, tail, static_cast<off_t>(file.size - tail)) : 0;
+        count_call(CALL_READ, tail > 0 ? 2 : 1);
+        if (head_count < 0 || tail_count < 0)
+        {
+            error = errno;
+        }
+        else
+        {
+            hash.update(buffer, static_cast<std::size_t>(head_count) + static_cast<std::size_t>(tail_count));
+            read_bytes = static_cast<uint64_t>(head_count + tail_count);
+        }
+        file.failed = head_count != static_cast<ssize_t>(head) || tail_count != static_cast<ssize_t>(tail);
+    }
+    close(fd);
+
+    if (file.failed)
+    {
+        std::cerr << "Error: cannot read file '" << path << "': " << (error ? std::strerror(error) : "file changed while being read") << std::endl;
+        return;
+    }
+    file.hash = hash.digest();
+    scan_stats.bytes_hashed += read_bytes;
+}
+
+/**
+ * @brief Reads up to @p length bytes, retrying short reads.
+ * @param fd The open file.
+ * @param buffer The buffer.
+ * @param length The number of bytes wanted.
+ * @return The number of bytes read, less than @p length only at the end of the file, -1 on error.
+ */
+static ssize_t read_fully(int fd, char *buffer, std::size_t length)
+{
+    std::size_t done = 0;
+    while (done < length)
+    {
+        count_call(CALL_READ);
+        ssize_t count = read(fd, buffer + done, length - done);
+        if (count < 0 && errno == EINTR)
+            continue;
+        if (count < 0)
+            return -1;
+        if (count == 0)
+            break;
+        done += static_cast<std::size_t>(count);
+    }
+    return static_cast<ssize_t>(done);
+}
+
+/**
+ * @brief Compares the contents of two files byte by byte.
+ * @param root The walked directory.
+ * @param a The first file.
+ * @param b The second file, of the same size.
+ * @return true if both files could be read in full and are identical.
+ */
+static bool same_contents(const std::string &root, const DupeFile &a, const DupeFile &b)
+{
+    PhaseTimer timer(PHASE_HASH);
+    std::string paths[2] = {root + "/" + a.path, root + "/" + b.path};
+    int fds[2];
+    for (int side = 0; side < 2; ++side)
+    {
+        count_call(CALL_OPEN);
+        fds[side] = open(paths[side].c_str(), O_RDONLY | O_CLOEXEC);
+        if (fds[side] < 0)
+        {
+            std::cerr << "Error: cannot read file '" << paths[side] << "': " << std::strerror(errno) << std::endl;
+            if (side == 1)
+                close(fds[0]);
+            return false;
+        }
+        posix_fadvise(fds[side], 0, 0, POSIX_FADV_SEQUENTIAL);
+    }
+
+    // Two buffers per thread, reused by every pair the thread compares
+    thread_local std::unique_ptr<char[]> buffers(new char[2 * DUPES_READ_SIZE]);
+    char *first = buffers.get();
+    char *second = first + DUPES_READ_SIZE;
+    uint64_t compared = 0;
+    bool same = true;
+    while (same)
+    {
+        ssize_t count = read_fully(fds[0], first, DUPES_READ_SIZE);
+        ssize_t other = count < 0 ? -1 : read_fully(fds[1], second, DUPES_READ_SIZE);
+        if (count < 0 || other < 0)
+        {
+            std::cerr << "Error: cannot read file '" << paths[count < 0 ? 0 : 1] << "': " << std::strerror(errno) << std::endl;
+            same = false;
+            break;
+        }
+        same = count == other && std::memcmp(first, second, static_cast<std::size_t>(count)) == 0;
+        compared += static_cast<uint64_t>(count + other);
+        if (count == 0)
+            break;
+    }
+    close(fds[0]);
+    close(fds[1]);
+
+    scan_stats.bytes_compared += compared;
+    return same && compared == 2 * a.size;
+}
+
+/**
+ * @brief Keeps the files that share their size and hash with another file.
+ * @param files All the files.
+ * @param indices The indices of the files to look at.
+ * @return The indices of the files kept, equal ones next to each other.
+ */
+static std::vector<std::size_t> colliding(const std::vector<DupeFile> &files, std::vector<std::size_t> indices)
+{
+    indices.erase(std::remove_if(indices.begin(), indices.end(), [&files](std::size_t index)
+                                 { return files[index].failed; }),
+                  indices.end());
+    std::sort(indices.begin(), indices.end(), [&files](std::size_t a, std::size_t b)
+              { return files[a].size != files[b].size ? files[a].size < files[b].size
+                       : files[a].hash != files[b].hash ? files[a].hash < files[b].hash
+                                                        : files[a].path < files[b].path; });
+
+    std::vector<std::size_t> kept;
+    for (std::size_t start = 0, end; start < indices.size(); start = end)
+    {
+        const DupeFile &first = files[indices[start]];
+        for (end = start + 1; end < indices.size() && files[indices[end]].size == first.size && files[indices[end]].hash == first.hash; ++end)
+        {
+        }
+        if (end - start > 1)
+            kept.insert(kept.end(), indices.begin() + start, indices.begin() + end);
+    }
+    return kept;
+}
+
+/**
+ * @brief Finds the files with identical contents below a directory.
+ * @param path The path to the directory.
+ * @param options The scan options (jobs, show_hidden, one_file_system, filter).
+ * @param groups Set to the groups, the most space wasted first.
+ * @return true on success, false with a message on the error stream if @p path is not a directory.
+ */
+bool find_duplicates(const std::string &path, const ScanOptions &options, std::vector<DupeGroup> &groups)
+{
+    groups.clear();
+    struct stat root_stat;
+    if (stat(path.c_str(), &root_stat) != 0 || !S_ISDIR(root_stat.st_mode))
+    {
+        std::cerr << "Error opening directory: " << path << std::endl;
+        return false;
+    }
+
+    // Stage 1: list every regular file with its size
+    Walker<DupeTask> walker(options.jobs);
+    std::vector<std::vector<DupeFile>> found(walker.jobs());
+    DupeTask root{"", options.filter ? options.filter->root(path) : nullptr};
+    walker.run(std::move(root), [&](unsigned worker, DupeTask &task, std::vector<DupeTask> &subdirs)
+               {
+        std::string directory = task.path.empty() ? path : path + "/" + task.path;
+        DirectoryReader reader(directory);
+        if (!reader.is_open())
+        {
+            std::cerr << "Error: " << directory_error(directory, reader.error()) << std::endl;
+            return;
+        }
+
+        std::shared_ptr<const FilterScope> scope = options.filter ? options.filter->apply(task.scope, directory, reader) : nullptr;
+        auto wanted = [&options](const EntryInfo &entry)
+        {
+            return options.show_hidden || entry.name[0] != '.';
+        };
+        reader.stat_all(false, wanted);
+        for (EntryInfo &entry : reader.entries)
+        {
+            if (!wanted(entry) || !reader.stat(entry, false))
+                continue;
+
+            std::string relative = task.path.empty() ? entry.name : task.path + "/" + entry.name;
+            if (entry.type == ENTRY_DIRECTORY)
+            {
+                if (!options.one_file_system || entry.dev == root_stat.st_dev)
+                    subdirs.push_back({std::move(relative), scope});
+            }
+            else if (S_ISREG(entry.mode) && entry.size > 0)
+            {
+                found[worker].push_back({std::move(relative), entry.size, entry.dev, entry.ino});
+            }
+        } });
+
+    std::vector<DupeFile> files;
+    for (std::vector<DupeFile> &worker_files : found)
+    {
+        std::move(worker_files.begin(), worker_files.end(), std::back_inserter(files));
+    }
+
+    // Hard links are one file, named by their first path
+    std::sort(files.begin(), files.end(), [](const DupeFile &a, const DupeFile &b)
+              { return a.dev != b.dev ? a.dev < b.dev : a.ino != b.ino ? a.ino < b.ino
+                                                                         : a.path < b.path; });
+    files.erase(std::unique(files.begin(), files.end(), [](const DupeFile &a, const DupeFile &b)
+                            { return a.dev == b.dev && a.ino == b.ino; }),
+                files.end());
+
+    std::vector<std::size_t> candidates(files.size());
+    for (std::size_t index = 0; index < files.size(); ++index)
+    {
+        candidates[index] = index;
+    }
+    candidates = colliding(files, std::move(candidates));
+
+    // Stage 2: the first and last blocks of the files of a shared size
+    Walker<std::size_t> hasher(options.jobs);
+    hasher.run(candidates, [&](unsigned, std::size_t &index, std::vector<std::size_t> &)
+               { hash_file(path, files[index], false); });
+    candidates = colliding(files, std::move(candidates));
+
+    // Stage 3: the whole contents of the files larger than their two ends
+    std::vector<std::size_t> partial;
+    for (std::size_t index : candidates)
+    {
+        if (files[index].size > 2 * DUPES_EDGE_SIZE)
+            partial.push_back(index);
+    }
+    hasher.run(partial, [&](unsigned, std::size_t &index, std::vector<std::size_t> &)
+               { hash_file(path, files[index], true); });
+    candidates = colliding(files, std::move(candidates));
+
+    // Stage 4: a hash match is not proof, every file is compared byte by byte with the first of its group
+    std::vector<std::vector<std::size_t>> runs;
+    for (std::size_t position = 0; position < candidates.size(); ++position)
+    {
+        const DupeFile &file = files[candidates[position]];
+        const DupeFile *previous = position > 0 ? &files[candidates[position - 1]] : nullptr;
+        if (!previous || file.size != previous->size || file.hash != previous->hash)
+            runs.emplace_back();
+        runs.back().push_back(candidates[position]);
+    }
+
+    // A run whose files differ although their hashes collide splits into several groups
+    std::vector<std::vector<std::vector<std::size_t>>> verified(runs.size());
+    std::vector<std::size_t> run_indices(runs.size());
+    for (std::size_t index = 0; index < runs.size(); ++index)
+    {
+        run_indices[index] = index;
+    }
+    hasher.run(run_indices, [&](unsigned, std::size_t &run, std::vector<std::size_t> &)
+               {
+        std::vector<std::vector<std::size_t>> &split = verified[run];
+        for (std::size_t index : runs[run])
+        {
+            auto group = std::find_if(split.begin(), split.end(), [&](const std::vector<std::size_t> &members)
+                                      { return same_contents(path, files[members.front()], files[index]); });
+            if (group != split.end())
+                group->push_back(index);
+            else
+                split.push_back({index});
+        } });
+
+    for (const std::vector<std::vector<std::size_t>> &split : verified)
+    {
+        for (const std::vector<std::size_t> &members : split)
+        {
+            if (members.size() < 2)
+                continue;
+            groups.push_back({files[members.front()].size, {}});
+            for (std::size_t index : members)
+            {
+                groups.back().paths.push_back(files[index].path);
+            }
+        }
+    }
+
+    std::sort(groups.begin(), groups.end(), [](const DupeGroup &a, const DupeGroup &b)
+              {
+        uint64_t wasted_a = a.size * (a.paths.size() - 1);
+        uint64_t wasted_b = b.size * (b.paths.size() - 1);
+        return wasted_a != wasted_b ? wasted_a > wasted_b : a.paths.front() < b.paths.front(); });
+    return true;
+}
+
+/**
+ * @brief Prints the groups of duplicate files below a directory.
+ * @param path The path to the directory.
+ * @param options The scan options.
+ * @return true on success, false with a message on the error stream if @p path is not a directory.
+ */
+bool print_dupes(const std::string &path, const ScanOptions &options)
+{
+    std::vector<DupeGroup> groups;
+    if (!find_duplicates(path, options, groups))
+        return false;
+    Output &sink = out();
+
+    uint64_t wasted = 0;
+    for (const DupeGroup &group : groups)
+    {
+        uint64_t group_wasted = group.size * (group.paths.size() - 1);
+        wasted += group_wasted;
+
+        print_colored_text(std::to_string(group.paths.size()) + " x " + format_size(static_cast<double>(group.size)), COLOR_TEXT);
+        sink << " (" << format_size(static_cast<double>(group_wasted)) << " reclaimable)\n";
+        for (const std::string &file : group.paths)
+        {
+            sink << "  ";
+            print_colored_text(file, COLOR_FILE);
+            sink << '\n';
+        }
+        sink << '\n';
+    }
+    sink << groups.size() << " groups of duplicates, " << format_size(static_cast<double>(wasted)) << " reclaimable\n";
+    sink.flush();
+    return true;
+}
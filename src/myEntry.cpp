@@ -0,0 +1,363 @@
+/**
+ ******************************************************************************
+ * @file    myEntry.cpp
+ * @brief   Implementation of the shared directory entry metadata layer.
+ * @author  Arun, Sagar, Saurav
+ * @date    March 7, 2024
+ ******************************************************************************
+ */
+
+#include "myEntry.hpp"
+#include "myBatch.hpp"
+#include "myStats.hpp"
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/sysmacros.h>
+
+/**
+ * @brief Maps a dirent::d_type value to an entry type.
+ * @param d_type The d_type value reported by readdir().
+ * @return The entry type, ENTRY_UNKNOWN if the filesystem did not report it.
+ */
+static EntryTypeDef type_from_dirent(unsigned char d_type)
+{
+    switch (d_type)
+    {
+    case DT_REG:
+        return ENTRY_FILE;
+    case DT_DIR:
+        return ENTRY_DIRECTORY;
+    case DT_LNK:
+        return ENTRY_SYMLINK;
+    case DT_UNKNOWN:
+        return ENTRY_UNKNOWN;
+    default:
+        return ENTRY_OTHER;
+    }
+}
+
+/**
+ * @brief Maps st_mode bits to an entry type.
+ * @param mode The st_mode value.
+ * @return The entry type.
+ */
+static EntryTypeDef type_from_mode(uint32_t mode)
+{
+    if (S_ISREG(mode))
+        return ENTRY_FILE;
+    if (S_ISDIR(mode))
+        return ENTRY_DIRECTORY;
+    if (S_ISLNK(mode))
+        return ENTRY_SYMLINK;
+    return ENTRY_OTHER;
+}
+
+/**
+ * @brief Copies a stat result into an entry.
+ * @param entry The entry.
+ * @param st The stat result.
+ */
+static void fill_metadata(EntryInfo &entry, const struct stat &st)
+{
+    entry.has_stat = true;
+    entry.type = type_from_mode(st.st_mode);
+    entry.is_symlink = entry.is_symlink || S_ISLNK(st.st_mode);
+    entry.mode = st.st_mode;
+    entry.nlink = st.st_nlink;
+    entry.size = st.st_size;
+    entry.blocks = st.st_blocks;
+    entry.mtime_ns = static_cast<int64_t>(st.st_mtim.tv_sec) * 1000000000 + st.st_mtim.tv_nsec;
+    entry.ino = st.st_ino;
+    entry.dev = st.st_dev;
+}
+
+/**
+ * @brief Copies a batched statx result into an entry.
+ * @param entry The entry.
+ * @param stx The statx result.
+ */
+static void fill_metadata(EntryInfo &entry, const struct statx &stx)
+{
+    entry.has_stat = true;
+    entry.type = type_from_mode(stx.stx_mode);
+    entry.is_symlink = entry.is_symlink || S_ISLNK(stx.stx_mode);
+    entry.mode = stx.stx_mode;
+    entry.nlink = stx.stx_nlink;
+    entry.size = stx.stx_size;
+    entry.blocks = stx.stx_blocks;
+    entry.mtime_ns = stx.stx_mtime.tv_sec * 1000000000 + stx.stx_mtime.tv_nsec;
+    entry.ino = stx.stx_ino;
+    entry.dev = makedev(stx.stx_dev_major, stx.stx_dev_minor);
+}
+
+/**
+ * @brief Records a failed stat in an entry.
+ * @param entry The entry.
+ */
+static void mark_failed(EntryInfo &entry)
+{
+    entry.stat_failed = true;
+    if (entry.is_symlink)
+        entry.type = ENTRY_OTHER; // Dangling link
+}
+
+/**
+ * @brief Constructor. Opens and reads the directory.
+ * @param directory The path to the directory.
+ */
+DirectoryReader::DirectoryReader(const std::string &directory) : open_error(0), stat_calls(0)
+{
+    PhaseTimer timer(PHASE_READDIR);
+    count_call(CALL_OPENDIR);
+    dir = opendir(directory.c_str());
+    if (!dir)
+    {
+        open_error = errno;
+        return;
+    }
+
+    struct dirent *entry;
+    while ((entry = readdir(dir)) != nullptr)
+    {
+        const char *name = entry->d_name;
+        if (name[0] == '.' && (name[1] == '\0' || (name[1] == '.' && name[2] == '\0')))
+            continue; // Skip current and parent directory entries
+
+        EntryInfo info;
+        info.name = name;
+        info.type = type_from_dirent(entry->d_type);
+        info.is_symlink = info.type == ENTRY_SYMLINK;
+        entries.push_back(std::move(info));
+    }
+
+    // Counted as read, before callers filter the entries or move them out
+    scan_stats.directories++;
+    scan_stats.entries += entries.size();
+}
+
+/**
+ * @brief Destructor. Closes the directory and publishes the stat counter.
+ */
+DirectoryReader::~DirectoryReader()
+{
+    if (dir)
+        closedir(dir);
+    scan_stats.stat_calls += stat_calls;
+}
+
+/**
+ * @brief Checks whether the directory could be opened.
+ * @return true if the directory was read, false otherwise.
+ */
+bool DirectoryReader::is_open() const
+{
+    return dir != nullptr;
+}
+
+/**
+ * @brief Gets the errno of a failed open.
+ * @return The error number, 0 if the directory was opened.
+ */
+int DirectoryReader::error() const
+{
+    return open_error;
+}
+
+/**
+ * @brief Checks whether an entry still has to be stat-ed.
+ * @param entry The entry.
+ * @param follow_links Whether the targets of symbolic links are wanted.
+ * @return true if the entry has no metadata yet, or only that of a link whose target is wanted.
+ */
+static bool needs_stat(const EntryInfo &entry, bool follow_links)
+{
+    if (entry.stat_failed)
+        return false;
+    // A link keeps the type ENTRY_SYMLINK until its target is stat-ed
+    return !entry.has_stat || (follow_links && entry.type == ENTRY_SYMLINK);
+}
+
+/**
+ * @brief Stats an entry unless it was already stat-ed.
+ *
+ * Without d_type a followed stat could not tell a link from its target, and
+ * a link such as X11 -> . would look like a directory to descend into. Such
+ * an entry is lstat-ed first, and only a link is stat-ed again for its target.
+ *
+ * @param entry The entry, which must belong to this reader.
+ * @param follow_links Whether to stat the target of a symbolic link.
+ * @return true if the metadata fields are valid, false otherwise.
+ */
+bool DirectoryReader::stat(EntryInfo &entry, bool follow_links)
+{
+    if (!needs_stat(entry, follow_links))
+        return entry.has_stat;
+    if (!dir)
+        return false;
+
+    PhaseTimer timer(PHASE_STAT);
+    struct stat st;
+    if (entry.type == ENTRY_UNKNOWN && follow_links)
+    {
+        stat_calls++;
+        count_call(CALL_STAT);
+        if (fstatat(dirfd(dir), entry.name.c_str(), &st, AT_SYMLINK_NOFOLLOW) != 0)
+        {
+            mark_failed(entry);
+            return false;
+        }
+        fill_metadata(entry, st);
+        if (!entry.is_symlink)
+            return true;
+    }
+
+    stat_calls++;
+    count_call(CALL_STAT);
+    if (fstatat(dirfd(dir), entry.name.c_str(), &st, follow_links ? 0 : AT_SYMLINK_NOFOLLOW) != 0)
+    {
+        entry.has_stat = false;
+        mark_failed(entry);
+        return false;
+    }
+
+    fill_metadata(entry, st);
+    return true;
+}
+
+/**
+ * @brief Stats every entry not stat-ed yet, as one batch when the directory is large enough.
+ *
+ * When links are followed, the entries without d_type are lstat-ed in a
+ * first batch, and only the links among them join the batch of targets.
+ *
+ * @param follow_links Whether to stat the targets of symbolic links.
+ * @param wanted Optional filter selecting the entries to stat.
+ */
+void DirectoryReader::stat_all(bool follow_links, const std::function<bool(const EntryInfo &)> &wanted)
+{
+    if (!dir)
+        return;
+
+    std::vector<EntryInfo *> unknown;
+    std::vector<EntryInfo *> pending;
+    for (EntryInfo &entry : entries)
+    {
+        if (!needs_stat(entry, follow_links) || (wanted && !wanted(entry)))
+            continue;
+        if (follow_links && entry.type == ENTRY_UNKNOWN)
+            unknown.push_back(&entry);
+        else
+            pending.push_back(&entry);
+    }
+
+    stat_batch(unknown, false);
+    for (EntryInfo *entry : unknown)
+    {
+        if (entry->has_stat && entry->is_symlink)
+            pending.push_back(entry);
+    }
+    stat_batch(pending, follow_links);
+}
+
+/**
+ * @brief Stats entries, as one batch when there are enough of them.
+ * @param pending The entries, none of them of unknown type when links are followed.
+ * @param follow_links Whether to stat the targets of symbolic links.
+ */
+void DirectoryReader::stat_batch(const std::vector<EntryInfo *> &pending, bool follow_links)
+{
+    if (!batch_stat_wanted(dirfd(dir), pending.size()))
+    {
+        for (EntryInfo *entry : pending)
+        {
+            stat(*entry, follow_links);
+        }
+        return;
+    }
+
+    std::vector<StatRequest> requests(pending.size());
+    for (std::size_t index = 0; index < pending.size(); ++index)
+    {
+        requests[index].name = pending[index]->name.c_str();
+    }
+    {
+        PhaseTimer timer(PHASE_STAT);
+        batch_stat(dirfd(dir), requests.data(), requests.size(), follow_links);
+    }
+    stat_calls += requests.size();
+
+    for (std::size_t index = 0; index < pending.size(); ++index)
+    {
+        if (requests[index].error != 0)
+        {
+            pending[index]->has_stat = false;
+            mark_failed(*pending[index]);
+        }
+        else
+            fill_metadata(*pending[index], requests[index].result);
+    }
+}
+
+/**
+ * @brief Resolves the type of an entry, stat-ing it only when d_type was not enough.
+ * @param entry The entry, which must belong to this reader.
+ * @return The type of the entry, symbolic links followed.
+ */
+EntryTypeDef DirectoryReader::resolve_type(EntryInfo &entry)
+{
+    if (entry.type == ENTRY_UNKNOWN || entry.type == ENTRY_SYMLINK)
+    {
+        if (!stat(entry) && entry.type == ENTRY_UNKNOWN)
+            entry.type = ENTRY_OTHER;
+    }
+    return entry.type;
+}
+
+/**
+ * @brief Calls stat or lstat on a path, counted and timed for --stats.
+ * @param path The path.
+ * @param st Receives the metadata.
+ * @param follow_links Whether to stat the target of a symbolic link.
+ * @return 0 on success, -1 with errno set otherwise.
+ */
+int timed_stat(const std::string &path, struct stat &st, bool follow_links)
+{
+    PhaseTimer timer(PHASE_STAT);
+    scan_stats.stat_calls++;
+    count_call(CALL_STAT);
+    return follow_links ? ::stat(path.c_str(), &st) : lstat(path.c_str(), &st);
+}
+
+/**
+ * @brief Stats a single path, for entries that are not read through a DirectoryReader.
+ * @param path The full path of the entry.
+ * @param entry The entry receiving the metadata; its name is left untouched.
+ * @param follow_links Whether to stat the target of a symbolic link.
+ * @return true if the metadata fields are valid, false otherwise.
+ */
+bool stat_path(const std::string &path, EntryInfo &entry, bool follow_links)
+{
+    struct stat st;
+    if (timed_stat(path, st, follow_links) != 0)
+    {
+        entry.has_stat = false;
+        entry.stat_failed = true;
+        return false;
+    }
+    entry.stat_failed = false;
+    fill_metadata(entry, st);
+    return true;
+}
+
+/**
+ * @brief Gets the error message of a failed directory open.
+ * @param directory The path to the directory.
+ * @param error The errno value.
+ * @return The error message.
+ */
+std::string directory_error(const std::string &directory, int error)
+{
+    return "cannot open directory '" + directory + "': " + std::strerror(error);
+}
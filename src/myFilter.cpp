@@ -0,0 +1,518 @@
+/**
+ ******************************************************************************
+ * @file    myFilter.cpp
+ * @brief   Implementation of the traversal-time path filter.
+ * @author  Arun, Sagar, Saurav
+ * @date    March 7, 2024
+ ******************************************************************************
+ */
+
+#include "myFilter.hpp"
+#include "myStats.hpp"
+#include <algorithm>
+#include <fstream>
+#include <sys/stat.h>
+
+/**
+ * @brief Per-thread buffers of GlobSet::last_match(), reused across calls.
+ */
+struct GlobRun
+{
+    std::vector<uint32_t> current; /**< The active states. */
+    std::vector<uint32_t> next; /**< The states active after the next character. */
+    std::vector<uint32_t> marks; /**< Generation in which every state was last activated. */
+    uint32_t generation = 0; /**< The current generation; bumping it empties the active set. */
+};
+
+/**
+ * @brief Parses a character class.
+ * @param pattern The pattern.
+ * @param open The index of the '['.
+ * @param set Output set of matching characters.
+ * @return The index of the closing ']', std::string_view::npos if the class is not closed.
+ */
+static std::size_t parse_class(std::string_view pattern, std::size_t open, std::bitset<256> &set)
+{
+    std::size_t index = open + 1;
+    bool negate = index < pattern.size() && (pattern[index] == '!' || pattern[index] == '^');
+    if (negate)
+        ++index;
+
+    set.reset();
+    std::size_t first = index;
+    while (index < pattern.size() && (pattern[index] != ']' || index == first))
+    {
+        unsigned char low = static_cast<unsigned char>(pattern[index]);
+        if (low == '\\' && index + 1 < pattern.size())
+            low = static_cast<unsigned char>(pattern[++index]);
+
+        unsigned char high = low;
+        if (index + 2 < pattern.size() && pattern[index + 1] == '-' && pattern[index + 2] != ']')
+        {
+            high = static_cast<unsigned char>(pattern[index + 2]);
+            index += 2;
+        }
+        for (unsigned c = low; c <= high; ++c)
+        {
+            set.set(c);
+        }
+        ++index;
+    }
+    if (index >= pattern.size())
+        return std::string_view::npos;
+
+    if (negate)
+        set.flip();
+    set.reset('/');
+    return index;
+}
+
+/**
+ * @brief Compiles a pattern into the set.
+ * @param pattern The glob pattern, matched against the whole text.
+ * @param directory_only Whether the pattern only matches directories.
+ * @return The index of the pattern, in order of addition.
+ */
+std::size_t GlobSet::add(std::string_view pattern, bool directory_only)
+{
+    uint32_t id = static_cast<uint32_t>(starts.size());
+    starts.push_back(static_cast<uint32_t>(states.size()));
+    this->directory_only.push_back(directory_only);
+
+    for (std::size_t index = 0; index < pattern.size(); ++index)
+    {
+        char c = pattern[index];
+        if (c == '\\' && index + 1 < pattern.size())
+        {
+            states.push_back({GLOB_LITERAL, static_cast<unsigned char>(pattern[++index]), 0});
+        }
+        else if (c == '?')
+        {
+            states.push_back({GLOB_ANY, 0, 0});
+        }
+        else if (c == '*')
+        {
+            std::size_t end = pattern.find_first_not_of('*', index);
+            if (end == std::string_view::npos)
+                end = pattern.size();
+
+            // "**" only crosses directories as a whole path component
+            bool whole = end - index >= 2 && (index == 0 || pattern[index - 1] == '/');
+            if (whole && end < pattern.size() && pattern[end] == '/')
+            {
+                states.push_back({GLOB_DIRS, 0, 0});
+                index = end; // The '/' belongs to the state
+            }
+            else
+            {
+                states.push_back({whole && end == pattern.size() ? GLOB_GLOBSTAR : GLOB_STAR, 0, 0});
+                index = end - 1;
+            }
+        }
+        else
+        {
+            std::bitset<256> set;
+            std::size_t close = c == '[' ? parse_class(pattern, index, set) : std::string_view::npos;
+            if (close != std::string_view::npos)
+            {
+                states.push_back({GLOB_CLASS, 0, static_cast<uint32_t>(classes.size())});
+                classes.push_back(set);
+                index = close;
+            }
+            else
+            {
+                states.push_back({GLOB_LITERAL, static_cast<unsigned char>(c), 0});
+            }
+        }
+    }
+
+    states.push_back({GLOB_ACCEPT, 0, id});
+    return id;
+}
+
+/**
+ * @brief Adds a state, and the states reachable from it without input, to an active set.
+ * @param state The state.
+ * @param active The active set.
+ * @param marks The generation marks, marks[s] == generation for states already in @p active.
+ * @param generation The current generation.
+ */
+void GlobSet::activate(uint32_t state, std::vector<uint32_t> &active, std::vector<uint32_t> &marks, uint32_t generation) const
+{
+    while (marks[state] != generation)
+    {
+        marks[state] = generation;
+        active.push_back(state);
+
+        // Stars match the empty string, so the next state is active too; GLOB_DIRS
+        // only when entered, at the start of a path component, not on its self-loop
+        GlobStateDef kind = states[state].kind;
+        if (kind != GLOB_STAR && kind != GLOB_GLOBSTAR && kind != GLOB_DIRS)
+            break;
+        ++state;
+    }
+}
+
+/**
+ * @brief Finds the last added pattern matching a text.
+ * @param text The text, a name or a relative path.
+ * @param is_directory Whether the text names a directory, for directory-only patterns.
+ * @return The index of the pattern, -1 if none matches.
+ */
+long GlobSet::last_match(std::string_view text, bool is_directory) const
+{
+    if (starts.empty())
+        return -1;
+
+    thread_local GlobRun run;
+    if (run.marks.size() < states.size())
+        run.marks.resize(states.size(), 0);
+    if (run.generation > UINT32_MAX - text.size() - 2)
+    {
+        std::fill(run.marks.begin(), run.marks.end(), 0);
+        run.generation = 0;
+    }
+
+    run.current.clear();
+    ++run.generation;
+    for (uint32_t start : starts)
+    {
+        activate(start, run.current, run.marks, run.generation);
+    }
+
+    for (std::size_t index = 0; index < text.size() && !run.current.empty(); ++index)
+    {
+        unsigned char c = static_cast<unsigned char>(text[index]);
+        run.next.clear();
+        ++run.generation;
+        for (uint32_t state : run.current)
+        {
+            const GlobState &glob = states[state];
+            switch (glob.kind)
+            {
+            case GLOB_LITERAL:
+                if (c == glob.literal)
+                    activate(state + 1, run.next, run.marks, run.generation);
+                break;
+            case GLOB_ANY:
+                if (c != '/')
+                    activate(state + 1, run.next, run.marks, run.generation);
+                break;
+            case GLOB_CLASS:
+                if (classes[glob.data][c])
+                    activate(state + 1, run.next, run.marks, run.generation);
+                break;
+            case GLOB_STAR:
+                if (c != '/')
+                    activate(state, run.next, run.marks, run.generation);
+                break;
+            case GLOB_GLOBSTAR:
+                activate(state, run.next, run.marks, run.generation);
+                break;
+            case GLOB_DIRS:
+                // Staying inside the skipped directories; only a consumed '/' starts the rest of the pattern
+                if (run.marks[state] != run.generation)
+                {
+                    run.marks[state] = run.generation;
+                    run.next.push_back(state);
+                }
+                if (c == '/')
+                    activate(state + 1, run.next, run.marks, run.generation);
+                break;
+            case GLOB_ACCEPT:
+                break;
+            }
+        }
+        run.current.swap(run.next);
+    }
+
+    long last = -1;
+    for (uint32_t state : run.current)
+    {
+        const GlobState &glob = states[state];
+        if (glob.kind == GLOB_ACCEPT && (is_directory || !directory_only[glob.data]))
+            last = std::max(last, static_cast<long>(glob.data));
+    }
+    return last;
+}
+
+/**
+ * @brief Reads and compiles a .gitignore file.
+ * @param file The path to the file.
+ * @return true if the file had at least one rule.
+ */
+bool IgnoreRules::load(const std::string &file)
+{
+    std::ifstream input(file);
+    std::string line;
+    while (std::getline(input, line))
+    {
+        if (!line.empty() && line.back() == '\r')
+            line.pop_back();
+        while (!line.empty() && line.back() == ' ' && !(line.size() >= 2 && line[line.size() - 2] == '\\'))
+            line.pop_back(); // Trailing spaces are ignored unless escaped
+        if (line.empty() || line[0] == '#')
+            continue;
+
+        std::string_view pattern = line;
+        bool negate = pattern[0] == '!';
+        if (negate)
+            pattern.remove_prefix(1);
+        else if (pattern.size() > 1 && pattern[0] == '\\' && (pattern[1] == '#' || pattern[1] == '!'))
+            pattern.remove_prefix(1);
+
+        bool directory_only = !pattern.empty() && pattern.back() == '/';
+        if (directory_only)
+            pattern.remove_suffix(1);
+        if (pattern.empty())
+            continue;
+
+        // A '/' anywhere but at the end anchors the pattern to the directory of the file
+        uint32_t rule = static_cast<uint32_t>(negated.size());
+        if (pattern.find('/') != std::string_view::npos)
+        {
+            if (pattern[0] == '/')
+                pattern.remove_prefix(1);
+            paths.add(pattern, directory_only);
+            path_rules.push_back(rule);
+        }
+        else
+        {
+            names.add(pattern, directory_only);
+            name_rules.push_back(rule);
+        }
+        negated.push_back(negate);
+    }
+    return !negated.empty();
+}
+
+/**
+ * @brief Matches a path against the rules, the last matching rule winning.
+ * @param relative The path relative to the directory of the file.
+ * @param name The last component of the path.
+ * @param is_directory Whether the path is a directory.
+ * @return The outcome.
+ */
+IgnoreMatchDef IgnoreRules::match(std::string_view relative, std::string_view name, bool is_directory) const
+{
+    long rule = -1;
+    long name_match = names.last_match(name, is_directory);
+    if (name_match >= 0)
+        rule = name_rules[name_match];
+    long path_match = paths.last_match(relative, is_directory);
+    if (path_match >= 0)
+        rule = std::max(rule, static_cast<long>(path_rules[path_match]));
+
+    if (rule < 0)
+        return IGNORE_NONE;
+    return negated[rule] ? IGNORE_KEPT : IGNORE_EXCLUDED;
+}
+
+/**
+ * @brief Builds the path of an entry relative to a directory above it.
+ * @param directory The path of the directory holding the entry.
+ * @param base_length The length of the path of the directory to be relative to.
+ * @param name The name of the entry.
+ * @return The relative path, without leading or doubled slashes.
+ */
+static std::string relative_path(const std::string &directory, std::size_t base_length, std::string_view name)
+{
+    std::string relative;
+    for (std::size_t index = base_length; index < directory.size(); ++index)
+    {
+        if (directory[index] != '/' || (!relative.empty() && relative.back() != '/'))
+            relative += directory[index];
+    }
+    if (!relative.empty() && relative.back() != '/')
+        relative += '/';
+    relative += name;
+    return relative;
+}
+
+/**
+ * @brief Adds a glob to the name or the path set, depending on whether it holds a '/'.
+ * @param glob The glob; a trailing '/' restricts it to directories.
+ * @param names The set of globs matched against names.
+ * @param paths The set of globs matched against relative paths.
+ */
+static void add_glob(std::string_view glob, GlobSet &names, GlobSet &paths)
+{
+    bool directory_only = glob.size() > 1 && glob.back() == '/';
+    if (directory_only)
+        glob.remove_suffix(1);
+    if (glob.find('/') == std::string_view::npos)
+    {
+        names.add(glob, directory_only);
+        return;
+    }
+    if (glob[0] == '/')
+        glob.remove_prefix(1);
+    paths.add(glob, directory_only);
+}
+
+/**
+ * @brief Adds an --exclude glob. Matching files and directories are skipped.
+ * @param glob The glob.
+ */
+void PathFilter::exclude(const std::string &glob)
+{
+    add_glob(glob, excluded_names, excluded_paths);
+}
+
+/**
+ * @brief Adds an --include glob. Files matching no include glob are skipped, directories are kept.
+ * @param glob The glob.
+ */
+void PathFilter::include(const std::string &glob)
+{
+    add_glob(glob, included_names, included_paths);
+}
+
+/**
+ * @brief Enables --gitignore: skips what .gitignore files ignore, and .git itself.
+ */
+void PathFilter::use_gitignore()
+{
+    gitignore = true;
+}
+
+/**
+ * @brief Checks whether the filter does anything.
+ * @return true if a glob was added or --gitignore enabled.
+ */
+bool PathFilter::active() const
+{
+    return gitignore || !excluded_names.empty() || !excluded_paths.empty() || !included_names.empty() || !included_paths.empty();
+}
+
+/**
+ * @brief Gets the scope to walk a directory with.
+ * @param path The walked directory.
+ * @return The scope to pass to apply() for @p path.
+ */
+std::shared_ptr<const FilterScope> PathFilter::root(const std::string &path) const
+{
+    auto top = std::make_shared<FilterScope>();
+    top->base_length = path.size();
+    top->root_length = path.size();
+    if (!gitignore)
+        return top;
+
+    // The directories from path up to the closest one holding .git, cut textually so they stay prefixes of path
+    std::vector<std::string> ancestors;
+    std::string directory = path;
+    struct stat st;
+    while (true)
+    {
+        while (directory.size() > 1 && directory.back() == '/')
+            directory.pop_back();
+        ancestors.push_back(directory);
+        if (lstat((directory + "/.git").c_str(), &st) == 0)
+            break;
+
+        std::size_t slash = directory.find_last_of('/');
+        if (slash == std::string::npos || directory == "/")
+            return top; // Not in a git work tree, only the .gitignore files below path count
+        directory.resize(slash == 0 ? 1 : slash);
+    }
+
+    std::shared_ptr<const FilterScope> chain;
+    const std::string &work_tree = ancestors.back();
+    std::vector<std::string> files = {work_tree + "/.git/info/exclude"};
+    for (std::size_t index = ancestors.size(); index-- > 1;)
+    {
+        files.push_back(ancestors[index] + "/.gitignore");
+    }
+
+    // info/exclude first, so that every .gitignore takes precedence over it
+    for (std::size_t index = 0; index < files.size(); ++index)
+    {
+        auto scope = std::make_shared<FilterScope>();
+        scope->base_length = index == 0 ? work_tree.size() : ancestors[ancestors.size() - index].size();
+        scope->root_length = path.size();
+        if (scope->rules.load(files[index]))
+        {
+            scope->parent = chain;
+            chain = scope;
+        }
+    }
+    if (!chain)
+        return top;
+
+    top->parent = chain;
+    return top;
+}
+
+/**
+ * @brief Removes the excluded entries of a directory listing.
+ * @param scope The scope of the parent directory (root() for the walked directory).
+ * @param directory The path of the listed directory.
+ * @param reader The listing; entries of unknown type are stat-ed without following links.
+ * @return The scope of the subdirectories of @p directory.
+ */
+std::shared_ptr<const FilterScope> PathFilter::apply(const std::shared_ptr<const FilterScope> &scope, const std::string &directory, DirectoryReader &reader) const
+{
+    PhaseTimer timer(PHASE_FILTER);
+    std::shared_ptr<const FilterScope> current = scope;
+    std::vector<EntryInfo> &entries = reader.entries;
+
+    // The listing tells whether there is a .gitignore, no extra open for directories without one
+    if (gitignore && std::any_of(entries.begin(), entries.end(), [](const EntryInfo &entry)
+                                 { return entry.name == ".gitignore" && entry.type != ENTRY_DIRECTORY; }))
+    {
+        auto child = std::make_shared<FilterScope>();
+        child->parent = scope;
+        child->base_length = directory.size();
+        child->root_length = scope->root_length;
+        if (child->rules.load(directory + "/.gitignore"))
+            current = child;
+    }
+
+    entries.erase(std::remove_if(entries.begin(), entries.end(), [&](EntryInfo &entry)
+                                 {
+                                     if (entry.type == ENTRY_UNKNOWN)
+                                         reader.stat(entry, false);
+                                     bool is_directory = entry.type == ENTRY_DIRECTORY && !entry.is_symlink;
+                                     return is_excluded(*current, directory, entry.name, is_directory); }),
+                  entries.end());
+    return current;
+}
+
+/**
+ * @brief Checks whether an entry is filtered out.
+ * @param scope The scope of the directory holding the entry.
+ * @param directory The path of the directory holding the entry.
+ * @param name The name of the entry.
+ * @param is_directory Whether the entry is a directory (links not followed).
+ * @return true if the entry is skipped.
+ */
+bool PathFilter::is_excluded(const FilterScope &scope, const std::string &directory, std::string_view name, bool is_directory) const
+{
+    if (gitignore && is_directory && name == ".git")
+        return true;
+    if (excluded_names.matches(name, is_directory))
+        return true;
+    if (!excluded_paths.empty() && excluded_paths.matches(relative_path(directory, scope.root_length, name), is_directory))
+        return true;
+
+    // The innermost .gitignore with a matching rule decides
+    if (gitignore)
+    {
+        for (const FilterScope *rules = &scope; rules; rules = rules->parent.get())
+        {
+            if (rules->rules.empty())
+                continue;
+            std::string relative = rules->rules.needs_path() ? relative_path(directory, rules->base_length, name) : std::string();
+            IgnoreMatchDef match = rules->rules.match(relative, name, is_directory);
+            if (match == IGNORE_EXCLUDED)
+                return true;
+            if (match == IGNORE_KEPT)
+                break;
+        }
+    }
+
+    if (is_directory || (included_names.empty() && included_paths.empty()))
+        return false;
+    return !included_names.matches(name, false) &&
+           (included_paths.empty() || !included_paths.matches(relative_path(directory, scope.root_length, name), false));
+}
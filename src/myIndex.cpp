@@ -0,0 +1,763 @@
+/**
+ ******************************************************************************
+ * @file    myIndex.cpp
+ * @brief   Implementation of the persistent scan index.
+ * @author  Arun, Sagar, Saurav
+ * @date    March 7, 2024
+ ******************************************************************************
+ */
+
+#include "myIndex.hpp"
+#include "myFilter.hpp"
+#include "myStats.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <mutex>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/**
+ * @brief Version of the index file layout, bumped on every incompatible change.
+ */
+constexpr uint32_t INDEX_VERSION = 1;
+
+/**
+ * @brief Magic bytes at the start of every index file.
+ */
+constexpr char INDEX_MAGIC[8] = {'D', 'I', 'F', 'O', 'I', 'D', 'X', '\0'};
+
+/**
+ * @brief Bits of IndexHeader::flags.
+ */
+enum IndexFileFlagDef : uint32_t
+{
+    INDEX_ONE_FILE_SYSTEM = 1 << 0 /**< The scan stayed on the root's file system. */
+};
+
+/**
+ * @brief Header of an index file.
+ *
+ * The header is followed by node_count IndexNode records, name_bytes of names
+ * and root_length bytes of the root path.
+ */
+struct IndexHeader
+{
+    char magic[8]; /**< INDEX_MAGIC. */
+    uint32_t version; /**< INDEX_VERSION. */
+    uint32_t node_size; /**< sizeof(IndexNode), guards against foreign layouts. */
+    uint32_t flags; /**< Combination of IndexFileFlagDef bits. */
+    uint32_t reserved; /**< Padding, always zero. */
+    uint64_t node_count; /**< Number of nodes. */
+    uint64_t name_bytes; /**< Size of the name pool. */
+    uint64_t root_length; /**< Length of the root path. */
+};
+
+/**
+ * @brief A directory whose modification time is compared with the index.
+ */
+struct IndexCheckTask
+{
+    std::string path; /**< The full path of the directory. */
+    NodeId node; /**< The node of the directory. */
+};
+
+/**
+ * @brief A directory whose children are copied from the index or read again.
+ */
+struct IndexTask
+{
+    std::string path; /**< The full path of the directory. */
+    NodeId old_node; /**< The node in the loaded index, or NO_NODE for a new directory. */
+    NodeId node; /**< The node in the rebuilt index. */
+    std::shared_ptr<const FilterScope> scope; /**< The filter scope of the parent directory, for filtered scans. */
+};
+
+/**
+ * @brief Normalises a directory path: links resolved, no "." or ".." components and no trailing slash.
+ * @param path The absolute path.
+ * @return The normalised path.
+ */
+static std::string normal_path(const std::string &path)
+{
+    std::error_code error;
+    std::filesystem::path canonical = std::filesystem::weakly_canonical(path, error);
+    std::string normal = (error ? std::filesystem::path(path) : canonical).lexically_normal().string();
+    while (normal.size() > 1 && normal.back() == '/')
+    {
+        normal.pop_back();
+    }
+    return normal;
+}
+
+/**
+ * @brief Appends a name to a directory path.
+ * @param directory The directory path.
+ * @param name The name.
+ * @return The joined path.
+ */
+static std::string join_path(const std::string &directory, std::string_view name)
+{
+    std::string path = directory;
+    if (path.empty() || path.back() != '/')
+        path += '/';
+    path += name;
+    return path;
+}
+
+/**
+ * @brief Fills the metadata fields of a node from an lstat() result.
+ * @param node The node.
+ * @param st The lstat() result.
+ */
+static void set_metadata(IndexNode &node, const struct stat &st)
+{
+    node.mode = st.st_mode;
+    node.nlink = st.st_nlink;
+    node.size = st.st_size;
+    node.blocks = st.st_blocks;
+    node.mtime_ns = static_cast<int64_t>(st.st_mtim.tv_sec) * 1000000000 + st.st_mtim.tv_nsec;
+    node.ino = st.st_ino;
+    node.dev = st.st_dev;
+}
+
+/**
+ * @brief Constructor. Creates an empty index.
+ */
+ScanIndex::ScanIndex()
+    : one_file_system(false), map(nullptr), map_size(0), nodes(nullptr), names(nullptr), node_count(0)
+{
+}
+
+/**
+ * @brief Destructor. Unmaps the index file.
+ */
+ScanIndex::~ScanIndex()
+{
+    unmap();
+}
+
+/**
+ * @brief Loads an index file and brings it up to date with the file system.
+ *
+ * Directories whose modification time, inode or device changed are read
+ * again, all others are taken from the file. The file is rewritten only when
+ * something changed. A missing file, or one made for another root or other
+ * scan options, is replaced by a full scan.
+ *
+ * @param file The path to the index file.
+ * @param path The directory to serve, which must be the indexed root or below it.
+ * @param options The scan options.
+ * @return true if the index is usable, false if @p file is not an index (an error is printed).
+ */
+bool ScanIndex::load(const std::string &file, const std::string &path, const ScanOptions &options)
+{
+    std::string wanted = normal_path(path);
+    bool is_index = true;
+    bool mapped = map_file(file, is_index);
+    if (!is_index)
+    {
+        std::cerr << "difo: '" << file << "' is not a difo index" << std::endl;
+        return false;
+    }
+
+    bool below_root = wanted == root_path || (wanted.compare(0, root_path.size(), root_path) == 0 &&
+                                              (root_path == "/" || wanted[root_path.size()] == '/'));
+    bool changed = true;
+    std::vector<uint8_t> changed_nodes;
+    if (mapped && below_root && one_file_system == options.one_file_system)
+    {
+        changed_nodes = check(options.jobs, changed);
+    }
+    else
+    {
+        unmap();
+        root_path = wanted;
+        one_file_system = options.one_file_system;
+    }
+
+    if (changed && !rebuild(root_path, changed_nodes, options.jobs))
+    {
+        std::cerr << "difo: index of '" << root_path << "' is full" << std::endl;
+        return false;
+    }
+
+    // A directory that is not indexed below the root (e.g. skipped by --one-file-system) gets its own index
+    if (find(wanted) == NO_NODE)
+    {
+        if (!rebuild(wanted, {}, options.jobs))
+        {
+            std::cerr << "difo: index of '" << wanted << "' is full" << std::endl;
+            return false;
+        }
+        changed = true;
+    }
+
+    if (changed && !save(file))
+    {
+        std::cerr << "difo: cannot write index '" << file << "': " << std::strerror(errno) << std::endl;
+    }
+    return true;
+}
+
+/**
+ * @brief Scans a directory into memory, without an index file.
+ * @param path The directory.
+ * @param options The scan options, the filter included.
+ * @return true if the index is usable, false if the tree does not fit (an error is printed).
+ */
+bool ScanIndex::scan(const std::string &path, const ScanOptions &options)
+{
+    unmap();
+    root_path = normal_path(path);
+    one_file_system = options.one_file_system;
+    if (!rebuild(root_path, {}, options.jobs, options.filter))
+    {
+        std::cerr << "difo: index of '" << root_path << "' is full" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Gets the name of a node.
+ * @param id The node id.
+ * @return The name; the root path for the root node.
+ */
+std::string_view ScanIndex::name(NodeId id) const
+{
+    if (nodes[id].parent == NO_NODE)
+        return root_path;
+    return std::string_view(names + nodes[id].name, nodes[id].name_length);
+}
+
+/**
+ * @brief Rebuilds the full path of a node from its ancestors.
+ * @param id The node id.
+ * @return The full path.
+ */
+std::string ScanIndex::path(NodeId id) const
+{
+    std::vector<std::string_view> parts;
+    for (NodeId current = id; current != NO_NODE; current = nodes[current].parent)
+    {
+        parts.push_back(name(current));
+    }
+
+    std::string full_path(parts.back());
+    for (auto it = parts.rbegin() + 1; it != parts.rend(); ++it)
+    {
+        full_path = join_path(full_path, *it);
+    }
+    return full_path;
+}
+
+/**
+ * @brief Finds the node of a directory.
+ * @param path The path, the indexed root or below it.
+ * @return The node, or NO_NODE if the path is not an indexed directory.
+ */
+NodeId ScanIndex::find(const std::string &path) const
+{
+    std::string wanted = normal_path(path);
+    if (node_count == 0 || wanted.compare(0, root_path.size(), root_path) != 0)
+        return NO_NODE;
+
+    NodeId current = 0;
+    std::size_t start = root_path.size();
+    while (start < wanted.size())
+    {
+        if (wanted[start] == '/')
+        {
+            start++;
+            continue;
+        }
+        if (start == root_path.size() && root_path != "/")
+            return NO_NODE; // A sibling sharing the root's prefix, e.g. /data2 for /data
+
+        std::size_t end = wanted.find('/', start);
+        if (end == std::string::npos)
+            end = wanted.size();
+        current = find_child(current, std::string_view(wanted).substr(start, end - start));
+        if (current == NO_NODE || !nodes[current].is_directory())
+            return NO_NODE;
+        start = end;
+    }
+    return current;
+}
+
+/**
+ * @brief Converts the children of a directory to entries, as a DirectoryReader would fill them.
+ * @param directory The directory node.
+ * @param follow_links Whether the entries look stat-ed with links followed (tree, sort)
+ *        or not (size). Symbolic links are stat-ed again to follow them.
+ * @return The entries, in the byte order of their names.
+ */
+std::vector<EntryInfo> ScanIndex::entries(NodeId directory, bool follow_links) const
+{
+    const IndexNode &parent = nodes[directory];
+    std::string directory_path;
+    std::vector<EntryInfo> result(parent.child_count);
+
+    for (uint32_t index = 0; index < parent.child_count; ++index)
+    {
+        NodeId id = parent.first_child + index;
+        const IndexNode &child = nodes[id];
+        EntryInfo &entry = result[index];
+        bool is_symlink = child.flags & INDEX_SYMLINK;
+
+        entry.name = name(id);
+        entry.is_symlink = is_symlink;
+        entry.has_stat = !(child.flags & INDEX_STAT_FAILED);
+        entry.stat_failed = !entry.has_stat;
+        entry.type = is_symlink && !follow_links ? ENTRY_SYMLINK : static_cast<EntryTypeDef>(child.type);
+        entry.mode = is_symlink && !follow_links ? S_IFLNK | 0777 : child.mode;
+        entry.nlink = child.nlink;
+        entry.size = child.size;
+        entry.blocks = child.blocks;
+        entry.mtime_ns = child.mtime_ns;
+        entry.ino = child.ino;
+        entry.dev = child.dev;
+
+        // The index keeps the link itself, its target is looked up again
+        if (is_symlink && follow_links && entry.has_stat)
+        {
+            if (directory_path.empty())
+                directory_path = path(directory);
+
+            struct stat st;
+            if (timed_stat(join_path(directory_path, entry.name), st) == 0)
+            {
+                entry.size = st.st_size;
+                entry.mtime_ns = static_cast<int64_t>(st.st_mtim.tv_sec) * 1000000000 + st.st_mtim.tv_nsec;
+            }
+            else
+            {
+                EntryInfo dangling;
+                dangling.name = std::move(entry.name);
+                dangling.type = entry.type;
+                dangling.is_symlink = true;
+                dangling.stat_failed = true;
+                entry = std::move(dangling);
+            }
+        }
+    }
+    return result;
+}
+
+/**
+ * @brief Maps an index file and checks its structure.
+ * @param file The path to the index file.
+ * @param is_index Set to false if the file exists but is not an index.
+ * @return true if the file is mapped, false if it is missing, empty, outdated or damaged.
+ */
+bool ScanIndex::map_file(const std::string &file, bool &is_index)
+{
+    int fd = open(file.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        return false;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size == 0)
+    {
+        close(fd);
+        return false;
+    }
+
+    IndexHeader header;
+    if (static_cast<std::size_t>(st.st_size) < sizeof(header) || pread(fd, &header, sizeof(header), 0) != sizeof(header) ||
+        std::memcmp(header.magic, INDEX_MAGIC, sizeof(INDEX_MAGIC)) != 0)
+    {
+        close(fd);
+        is_index = false;
+        return false;
+    }
+
+    uint64_t expected = sizeof(header) + header.node_count * sizeof(IndexNode) + header.name_bytes + header.root_length;
+    if (header.version != INDEX_VERSION || header.node_size != sizeof(IndexNode) || header.node_count == 0 ||
+        header.node_count >= NO_NODE || header.name_bytes > UINT32_MAX || expected != static_cast<uint64_t>(st.st_size))
+    {
+        close(fd);
+        return false; // Written by another version, or truncated: rescan
+    }
+
+    map_size = st.st_size;
+    map = mmap(nullptr, map_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED)
+    {
+        map = nullptr;
+        return false;
+    }
+
+    const char *base = static_cast<const char *>(map);
+    nodes = reinterpret_cast<const IndexNode *>(base + sizeof(header));
+    names = base + sizeof(header) + header.node_count * sizeof(IndexNode);
+    node_count = header.node_count;
+    root_path.assign(names + header.name_bytes, header.root_length);
+    one_file_system = header.flags & INDEX_ONE_FILE_SYSTEM;
+
+    // Every later access trusts these links, so a damaged file is rejected here
+    for (std::size_t id = 0; id < node_count; ++id)
+    {
+        const IndexNode &node = nodes[id];
+        bool valid = (id == 0 ? node.parent == NO_NODE : node.parent < node_count) &&
+                     (node.child_count == 0 || (node.first_child > id && node.first_child + uint64_t(node.child_count) <= node_count)) &&
+                     node.name + uint64_t(node.name_length) <= header.name_bytes;
+        if (!valid)
+        {
+            unmap();
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Unmaps the index file and forgets the mapped nodes.
+ */
+void ScanIndex::unmap()
+{
+    if (map)
+    {
+        munmap(map, map_size);
+        map = nullptr;
+        map_size = 0;
+        nodes = nullptr;
+        names = nullptr;
+        node_count = 0;
+    }
+}
+
+/**
+ * @brief Compares the modification time of every indexed directory with the file system.
+ *
+ * Costs one lstat() per directory and none per file. A directory whose entries
+ * were added, removed or renamed has a new modification time; a file changed in
+ * place does not change its directory and keeps its indexed size until then.
+ *
+ * @param jobs Number of worker threads (0 picks the number of hardware threads).
+ * @param changed Set to true if any directory changed.
+ * @return One flag per node, set for the directories that must be read again.
+ */
+std::vector<uint8_t> ScanIndex::check(unsigned jobs, bool &changed) const
+{
+    std::vector<uint8_t> changed_nodes(node_count, 0);
+    std::atomic<bool> any_changed{false};
+    uint64_t root_dev = nodes[0].dev;
+
+    Walker<IndexCheckTask> walker(jobs);
+    walker.run({root_path, 0}, [&](unsigned, IndexCheckTask &task, std::vector<IndexCheckTask> &subdirs)
+               {
+        const IndexNode &directory = nodes[task.node];
+        struct stat st;
+        if (timed_stat(task.path, st, false) != 0)
+        {
+            changed_nodes[task.node] = 1;
+            any_changed = true;
+            return;
+        }
+
+        int64_t mtime_ns = static_cast<int64_t>(st.st_mtim.tv_sec) * 1000000000 + st.st_mtim.tv_nsec;
+        if (mtime_ns != directory.mtime_ns || st.st_ino != directory.ino || st.st_dev != directory.dev || !S_ISDIR(st.st_mode))
+        {
+            changed_nodes[task.node] = 1;
+            any_changed = true;
+        }
+
+        // Children are checked even below a changed directory, most of them can still be reused
+        for (uint32_t index = 0; index < directory.child_count; ++index)
+        {
+            NodeId id = directory.first_child + index;
+            if (nodes[id].is_directory() && (!one_file_system || nodes[id].dev == root_dev))
+            {
+                subdirs.push_back({join_path(task.path, name(id)), id});
+            }
+        } });
+
+    changed = any_changed;
+    return changed_nodes;
+}
+
+/**
+ * @brief Builds the index in node_buffer and name_buffer, reusing unchanged directories.
+ *
+ * Directories not flagged in @p changed have their children copied from the
+ * current index; the others, and new directories, are read from the file system.
+ *
+ * @param path The root directory.
+ * @param changed One flag per current node, empty to read everything.
+ * @param jobs Number of worker threads (0 picks the number of hardware threads).
+ * @param filter Optional filter leaving entries out of the index, only for indexes that are not saved.
+ * @return true if the index was rebuilt, false if it is full (more nodes or name bytes than
+ *         the format holds); the current index is then kept.
+ */
+bool ScanIndex::rebuild(const std::string &path, const std::vector<uint8_t> &changed, unsigned jobs, const PathFilter *filter)
+{
+    std::vector<IndexNode> new_nodes;
+    std::string new_names;
+    std::mutex mutex;
+    std::atomic<bool> full{false};
+    bool reuse = node_count > 0 && !changed.empty();
+
+    IndexNode root;
+    root.type = ENTRY_DIRECTORY;
+    struct stat st;
+    if (timed_stat(path, st, false) == 0)
+        set_metadata(root, st);
+    else
+        root.flags = INDEX_STAT_FAILED;
+    new_nodes.push_back(root);
+    uint64_t root_dev = root.dev;
+
+    // Appends the children of a directory, all at once so that they stay contiguous; NO_NODE once full
+    auto append = [&](NodeId parent, std::vector<IndexNode> &children, const std::vector<std::string_view> &child_names)
+    {
+        std::lock_guard<std::mutex> guard(mutex);
+        std::size_t name_bytes = 0;
+        for (std::string_view child_name : child_names)
+        {
+            name_bytes += std::min<std::size_t>(child_name.size(), 255);
+        }
+        if (new_nodes.size() + children.size() >= NO_NODE || new_names.size() + name_bytes > UINT32_MAX)
+        {
+            full = true; // The walker must not see an exception, the visitors stop instead
+            return NO_NODE;
+        }
+
+        NodeId first = static_cast<NodeId>(new_nodes.size());
+        for (std::size_t index = 0; index < children.size(); ++index)
+        {
+            children[index].parent = parent;
+            children[index].name = static_cast<uint32_t>(new_names.size());
+            children[index].name_length = static_cast<uint8_t>(std::min<std::size_t>(child_names[index].size(), 255));
+            new_names.append(child_names[index].substr(0, children[index].name_length));
+            new_nodes.push_back(children[index]);
+        }
+        new_nodes[parent].first_child = children.empty() ? NO_NODE : first;
+        new_nodes[parent].child_count = static_cast<uint32_t>(children.size());
+        return first;
+    };
+
+    Walker<IndexTask> walker(jobs);
+    walker.run({path, reuse ? 0 : NO_NODE, 0, filter ? filter->root(path) : nullptr}, [&](unsigned, IndexTask &task, std::vector<IndexTask> &subdirs)
+               {
+        if (full.load(std::memory_order_relaxed))
+            return;
+        if (task.old_node != NO_NODE && !changed[task.old_node])
+        {
+            const IndexNode &directory = nodes[task.old_node];
+            std::vector<IndexNode> children;
+            std::vector<std::string_view> child_names;
+            if (directory.child_count > 0)
+                children.assign(nodes + directory.first_child, nodes + directory.first_child + directory.child_count);
+            for (uint32_t index = 0; index < directory.child_count; ++index)
+            {
+                children[index].first_child = NO_NODE;
+                children[index].child_count = 0;
+                child_names.push_back(name(directory.first_child + index));
+            }
+
+            NodeId first = append(task.node, children, child_names);
+            if (first == NO_NODE)
+                return;
+            for (uint32_t index = 0; index < children.size(); ++index)
+            {
+                if (children[index].is_directory() && (!one_file_system || children[index].dev == root_dev))
+                {
+                    subdirs.push_back({join_path(task.path, child_names[index]), directory.first_child + index, first + index, nullptr});
+                }
+            }
+            return;
+        }
+
+        // A changed directory below an unchanged one still carries its old metadata
+        if (task.old_node != NO_NODE && task.node != 0)
+        {
+            struct stat st;
+            if (timed_stat(task.path, st, false) == 0)
+            {
+                std::lock_guard<std::mutex> guard(mutex);
+                set_metadata(new_nodes[task.node], st);
+            }
+        }
+
+        DirectoryReader reader(task.path);
+        if (!reader.is_open())
+        {
+            std::cerr << "Error: " << directory_error(task.path, reader.error()) << std::endl;
+            return;
+        }
+        std::shared_ptr<const FilterScope> scope = filter ? filter->apply(task.scope, task.path, reader) : nullptr;
+
+        std::vector<EntryInfo> &items = reader.entries;
+        {
+            PhaseTimer timer(PHASE_SORT);
+            std::sort(items.begin(), items.end(), [](const EntryInfo &a, const EntryInfo &b)
+                      { return a.name < b.name; });
+        }
+
+        reader.stat_all(false);
+        std::vector<IndexNode> children(items.size());
+        std::vector<std::string_view> child_names;
+        for (std::size_t index = 0; index < items.size(); ++index)
+        {
+            EntryInfo &item = items[index];
+            IndexNode &child = children[index];
+            child_names.push_back(item.name);
+
+            bool has_stat = reader.stat(item, false);
+            child.flags = static_cast<uint8_t>((has_stat ? 0 : INDEX_STAT_FAILED) | (item.is_symlink ? INDEX_SYMLINK : 0));
+            child.type = item.type == ENTRY_UNKNOWN ? ENTRY_OTHER : item.type;
+            child.mode = item.mode;
+            child.nlink = item.nlink;
+            child.size = item.size;
+            child.blocks = item.blocks;
+            child.mtime_ns = item.mtime_ns;
+            child.ino = item.ino;
+            child.dev = item.dev;
+
+            // Links are kept as links, but colored and listed by what they point to
+            if (item.is_symlink)
+            {
+                EntryInfo target;
+                target.name = item.name;
+                target.type = ENTRY_SYMLINK;
+                target.is_symlink = true;
+                child.type = reader.resolve_type(target);
+                child.mode = target.mode;
+            }
+        }
+
+        NodeId first = append(task.node, children, child_names);
+        if (first == NO_NODE)
+            return;
+        for (std::size_t index = 0; index < children.size(); ++index)
+        {
+            if (!children[index].is_directory() || (one_file_system && children[index].dev != root_dev))
+                continue;
+
+            NodeId old_child = task.old_node != NO_NODE ? find_child(task.old_node, child_names[index]) : NO_NODE;
+            if (old_child != NO_NODE && !nodes[old_child].is_directory())
+                old_child = NO_NODE;
+            subdirs.push_back({join_path(task.path, child_names[index]), old_child, static_cast<NodeId>(first + index), scope});
+        } });
+
+    if (full)
+        return false;
+    root_path = path;
+    unmap();
+    node_buffer = std::move(new_nodes);
+    name_buffer = std::move(new_names);
+    nodes = node_buffer.data();
+    names = name_buffer.data();
+    node_count = node_buffer.size();
+    return true;
+}
+
+/**
+ * @brief Writes the rebuilt index to a temporary file and renames it over @p file.
+ *
+ * The temporary file has a unique name next to @p file, so concurrent refreshes
+ * of one index never write into each other's file; the last rename wins, and
+ * the file is synced first so that a crash never leaves a partial index behind.
+ *
+ * @param file The path to the index file.
+ * @return true on success, false with errno set otherwise.
+ */
+bool ScanIndex::save(const std::string &file) const
+{
+    std::string temporary = file + ".XXXXXX";
+    int fd = mkostemp(&temporary[0], O_CLOEXEC);
+    if (fd < 0)
+        return false;
+
+    // mkostemp creates the file 0600, the index is as readable as a file created with 0644
+    mode_t mask = umask(0);
+    umask(mask);
+    fchmod(fd, 0644 & ~mask);
+
+    std::size_t name_bytes = name_buffer.size();
+    IndexHeader header = {};
+    std::memcpy(header.magic, INDEX_MAGIC, sizeof(INDEX_MAGIC));
+    header.version = INDEX_VERSION;
+    header.node_size = sizeof(IndexNode);
+    header.flags = one_file_system ? static_cast<uint32_t>(INDEX_ONE_FILE_SYSTEM) : 0;
+    header.node_count = node_count;
+    header.name_bytes = name_bytes;
+    header.root_length = root_path.size();
+
+    const std::pair<const void *, std::size_t> parts[] = {
+        {&header, sizeof(header)},
+        {nodes, node_count * sizeof(IndexNode)},
+        {names, name_bytes},
+        {root_path.data(), root_path.size()},
+    };
+    for (const auto &part : parts)
+    {
+        const char *data = static_cast<const char *>(part.first);
+        std::size_t offset = 0;
+        while (offset < part.second)
+        {
+            ssize_t result = ::write(fd, data + offset, part.second - offset);
+            if (result < 0 && errno == EINTR)
+                continue;
+            if (result < 0)
+            {
+                int error = errno;
+                close(fd);
+                unlink(temporary.c_str());
+                errno = error;
+                return false;
+            }
+            offset += result;
+        }
+    }
+
+    if (fsync(fd) != 0)
+    {
+        int error = errno;
+        close(fd);
+        unlink(temporary.c_str());
+        errno = error;
+        return false;
+    }
+    if (close(fd) != 0 || rename(temporary.c_str(), file.c_str()) != 0)
+    {
+        int error = errno;
+        unlink(temporary.c_str());
+        errno = error;
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Finds a child of a directory by name with a binary search.
+ * @param directory The directory node.
+ * @param name The name of the child.
+ * @return The child, or NO_NODE if there is none.
+ */
+NodeId ScanIndex::find_child(NodeId directory, std::string_view name) const
+{
+    uint32_t low = 0;
+    uint32_t high = nodes[directory].child_count;
+    while (low < high)
+    {
+        uint32_t middle = low + (high - low) / 2;
+        NodeId id = nodes[directory].first_child + middle;
+        int result = this->name(id).compare(name);
+        if (result == 0)
+            return id;
+        if (result < 0)
+            low = middle + 1;
+        else
+            high = middle;
+    }
+    return NO_NODE;
+}
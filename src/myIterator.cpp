@@ -0,0 +1,156 @@
+/**
+ ******************************************************************************
+ * @file    myIterator.cpp
+ * @brief   Implementation of the lazy, pull-based directory entry iterator.
+ * @author  Arun, Sagar, Saurav
+ * @date    March 7, 2024
+ ******************************************************************************
+ */
+
+#include "myIterator.hpp"
+#include "myCollate.hpp"
+#include "myOutput.hpp"
+#include "myStats.hpp"
+#include <algorithm>
+#include <iostream>
+
+/**
+ * @brief Constructor. Lists the root directory.
+ * @param root The path to the directory walked.
+ * @param options The scan options; jobs is ignored, the walk is sequential.
+ * @param iteration How to walk.
+ */
+EntryIterator::EntryIterator(const std::string &root, const ScanOptions &options, const IteratorOptions &iteration)
+    : options(options), iteration(iteration), directory_path(root)
+{
+    struct stat st;
+    if (options.one_file_system && timed_stat(root, st) == 0)
+        root_dev = st.st_dev;
+
+    stack.emplace_back();
+    stack.back().path_length = directory_path.size();
+    root_error = list(stack.back(), options.filter ? options.filter->root(root) : nullptr);
+}
+
+/**
+ * @brief Lists one directory into a frame: filtered, hidden entries left out, stat-ed and sorted.
+ *
+ * The directory is closed before returning, so the walk holds no descriptors.
+ * Errors below the root are reported on the error stream; the root's are left to the caller.
+ *
+ * @param frame The frame receiving the entries and the filter scope of their subdirectories.
+ * @param scope The filter scope of the parent directory.
+ * @return The errno of a failed open, 0 on success.
+ */
+int EntryIterator::list(Frame &frame, const std::shared_ptr<const FilterScope> &scope)
+{
+    DirectoryReader reader(directory_path);
+    if (!reader.is_open())
+    {
+        if (stack.size() > 1)
+        {
+            out().flush(); // Keep the error next to the lines printed before it
+            std::cerr << "Error: " << directory_error(directory_path, reader.error()) << std::endl;
+        }
+        return reader.error();
+    }
+    if (options.filter)
+        frame.scope = options.filter->apply(scope, directory_path, reader);
+
+    std::vector<EntryInfo> &items = reader.entries;
+    if (!options.show_hidden)
+    {
+        items.erase(std::remove_if(items.begin(), items.end(), [](const EntryInfo &item)
+                                   { return item.name[0] == '.'; }),
+                    items.end());
+    }
+    if (iteration.sorted)
+    {
+        PhaseTimer timer(PHASE_SORT);
+        sort_by_name(items, [](const EntryInfo &item) -> const std::string &
+                     { return item.name; });
+    }
+
+    // Directories need their device to stay on the file system of the root
+    IterStatDef mode = iteration.stat;
+    bool need_dev = options.one_file_system;
+    reader.stat_all(iteration.follow_links, [mode, need_dev](const EntryInfo &item)
+                    {
+        if (mode == ITER_STAT_ALL || item.type == ENTRY_UNKNOWN || item.type == ENTRY_SYMLINK)
+            return true;
+        return item.type == ENTRY_DIRECTORY ? need_dev : mode == ITER_STAT_FILES; });
+    for (EntryInfo &item : items)
+    {
+        if (iteration.follow_links)
+            reader.resolve_type(item);
+        else if (item.type == ENTRY_UNKNOWN && !item.has_stat)
+            item.type = ENTRY_OTHER;
+    }
+
+    frame.entries = std::move(items);
+    return 0;
+}
+
+/**
+ * @brief Moves to the next entry, entering the current one first if it is a directory not skipped.
+ * @return true if there is an entry, false at the end of the walk.
+ */
+bool EntryIterator::next()
+{
+    if (stopped)
+        return false;
+
+    if (descend)
+    {
+        descend = false;
+        std::shared_ptr<const FilterScope> scope = stack.back().scope;
+        std::size_t path_length = directory_path.size();
+        directory_path += '/';
+        directory_path += current->name;
+        stack.emplace_back(); // Invalidates current, the entry itself does not move
+        stack.back().path_length = path_length;
+        list(stack.back(), scope);
+    }
+
+    while (!stack.empty())
+    {
+        Frame &frame = stack.back();
+        if (frame.next == frame.entries.size())
+        {
+            directory_path.resize(frame.path_length);
+            stack.pop_back();
+            if (!iteration.post_order || stack.empty())
+                continue;
+
+            // The directory entered last, yielded again now that its entries are done
+            Frame &parent = stack.back();
+            current = &parent.entries[parent.next - 1];
+            current_depth = static_cast<unsigned>(stack.size());
+            current_last = parent.next == parent.entries.size();
+            current_leaving = true;
+            return true;
+        }
+
+        if (options.max_entries != 0 && yielded == options.max_entries)
+        {
+            limit_reached = true;
+            break;
+        }
+
+        current = &frame.entries[frame.next++];
+        current_depth = static_cast<unsigned>(stack.size());
+        current_last = frame.next == frame.entries.size();
+        current_leaving = false;
+        yielded++;
+
+        // Directories at the depth limit are yielded but not opened
+        descend = current->type == ENTRY_DIRECTORY && !current->is_symlink &&
+                  (options.max_depth == 0 || current_depth < options.max_depth) &&
+                  (!options.one_file_system || (current->has_stat && current->dev == root_dev));
+        return true;
+    }
+
+    stopped = true;
+    current = nullptr;
+    return false;
+}
@@ -0,0 +1,220 @@
+/**
+ ******************************************************************************
+ * @file    myLibrary.cpp
+ * @brief   Implementation of the C interface of libdifo, declared in difo.h,
+ *          on top of the iterator, disk usage and sorting used by the views.
+ * @author  Arun, Sagar, Saurav
+ * @date    March 7, 2024
+ ******************************************************************************
+ */
+
+#include "difo.h"
+#include "myFilter.hpp"
+#include "myIterator.hpp"
+#include "mySize.hpp"
+#include "mySort.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <string>
+#include <vector>
+
+static_assert(static_cast<int>(DIFO_TYPE_FILE) == ENTRY_FILE && static_cast<int>(DIFO_TYPE_DIRECTORY) == ENTRY_DIRECTORY &&
+                  static_cast<int>(DIFO_TYPE_SYMLINK) == ENTRY_SYMLINK && static_cast<int>(DIFO_TYPE_OTHER) == ENTRY_OTHER,
+              "difo_type mirrors EntryTypeDef");
+
+/**
+ * @brief The scan options and the filter of a call, built from its difo_options.
+ */
+struct LibraryScan
+{
+    ScanOptions options; /**< The scan options. */
+    PathFilter filter; /**< The --exclude/--include/--gitignore equivalent. */
+    unsigned flags = 0; /**< The difo_flag bits. */
+
+    /**
+     * @brief Constructor.
+     * @param from The options of the call, NULL for the defaults.
+     */
+    explicit LibraryScan(const difo_options *from)
+    {
+        // A caller built against an older header passes a shorter structure, the defaults fill the rest
+        difo_options given;
+        difo_options_init(&given);
+        if (from)
+            std::memcpy(&given, from, std::min(from->size, sizeof(given)));
+
+        flags = given.flags;
+        options.jobs = given.jobs;
+        options.show_hidden = flags & DIFO_HIDDEN;
+        options.one_file_system = flags & DIFO_ONE_FILE_SYSTEM;
+        options.max_depth = given.max_depth;
+        options.max_entries = given.max_entries;
+        for (std::size_t index = 0; index < given.exclude_count; ++index)
+        {
+            filter.exclude(given.exclude[index]);
+        }
+        for (std::size_t index = 0; index < given.include_count; ++index)
+        {
+            filter.include(given.include[index]);
+        }
+        if (flags & DIFO_GITIGNORE)
+            filter.use_gitignore();
+        if (filter.active())
+            options.filter = &filter;
+    }
+};
+
+/**
+ * @brief Copies an entry into the structure handed to visitors.
+ * @param entry The entry.
+ * @param path The path of the entry relative to the root.
+ * @param depth The level of the entry.
+ * @return The structure, pointing into @p entry and @p path.
+ */
+static difo_entry to_entry(const EntryInfo &entry, const std::string &path, unsigned depth)
+{
+    difo_entry result;
+    std::memset(&result, 0, sizeof(result));
+    result.path = path.c_str();
+    result.name = entry.name.c_str();
+    result.type = entry.has_stat ? static_cast<int>(entry.type) : DIFO_TYPE_UNKNOWN;
+    result.is_symlink = entry.is_symlink;
+    result.depth = depth;
+    result.mode = entry.mode;
+    result.nlink = entry.nlink;
+    result.size = entry.size;
+    result.allocated = entry.blocks * 512;
+    result.mtime_ns = entry.mtime_ns;
+    result.ino = entry.ino;
+    result.dev = entry.dev;
+    return result;
+}
+
+/**
+ * @brief Gets the version of the library.
+ * @return DIFO_API_VERSION of the library, which may be newer than the header.
+ */
+int difo_version(void)
+{
+    return DIFO_API_VERSION;
+}
+
+/**
+ * @brief Sets options to the defaults: no flags, no limits, all hardware threads.
+ * @param options The options.
+ */
+void difo_options_init(difo_options *options)
+{
+    std::memset(options, 0, sizeof(*options));
+    options->size = sizeof(*options);
+}
+
+/**
+ * @brief Walks the entries below a directory depth first, one directory listed at a time.
+ * @param root The directory.
+ * @param options The options, NULL for the defaults.
+ * @param visit Called for every entry, from the calling thread.
+ * @param user_data Passed to @p visit.
+ * @return 0, or the errno of opening @p root, EINVAL for a NULL argument.
+ */
+int difo_walk(const char *root, const difo_options *options, difo_visitor visit, void *user_data)
+{
+    if (!root || !visit)
+        return EINVAL;
+
+    LibraryScan scan(options);
+    IteratorOptions iteration;
+    iteration.sorted = !(scan.flags & DIFO_UNSORTED);
+    iteration.post_order = scan.flags & DIFO_POST_ORDER;
+    iteration.stat = ITER_STAT_ALL;
+    iteration.follow_links = false;
+
+    std::string path = root;
+    EntryIterator it(path, scan.options, iteration);
+    if (it.error() != 0)
+        return it.error();
+
+    std::string relative;
+    while (it.next())
+    {
+        const EntryInfo &entry = it.entry();
+        const std::string &directory = it.directory();
+        relative.assign(directory, std::min(directory.size(), path.size() + 1));
+        if (!relative.empty())
+            relative += '/';
+        relative += entry.name;
+
+        difo_entry visited = to_entry(entry, relative, it.depth());
+        visited.leaving = it.leaving();
+        int action = visit(&visited, user_data);
+        if (action == DIFO_STOP)
+            break;
+        if (action == DIFO_SKIP)
+            it.skip();
+    }
+    return 0;
+}
+
+/**
+ * @brief Computes the recursive disk usage of every entry of a directory.
+ * @param root The directory.
+ * @param options The options, NULL for the defaults; max_depth and max_entries are ignored.
+ * @param visit Called for every entry of @p root, from the calling thread.
+ * @param user_data Passed to @p visit.
+ * @return 0, or the errno of opening @p root, EINVAL for a NULL argument.
+ */
+int difo_disk_usage(const char *root, const difo_options *options, difo_visitor visit, void *user_data)
+{
+    if (!root || !visit)
+        return EINVAL;
+
+    LibraryScan scan(options);
+    std::vector<EntryInfo> entries;
+    std::vector<DiskUsage> usage;
+    int error = directory_usage(root, scan.options, entries, usage);
+    if (error != 0)
+        return error;
+
+    for (std::size_t index = 0; index < entries.size(); ++index)
+    {
+        difo_entry visited = to_entry(entries[index], entries[index].name, 1);
+        visited.size = usage[index].apparent;
+        visited.allocated = usage[index].allocated;
+        if (visit(&visited, user_data) == DIFO_STOP)
+            break;
+    }
+    return 0;
+}
+
+/**
+ * @brief Lists the entries of a directory sorted, as the --sort view does.
+ * @param root The directory.
+ * @param sort A difo_sort; ties are broken by name.
+ * @param options The options, NULL for the defaults; max_depth and max_entries are ignored.
+ * @param visit Called for every entry, in order, from the calling thread.
+ * @param user_data Passed to @p visit.
+ * @return 0, or the errno of opening @p root, EINVAL for a NULL argument or an unknown sort.
+ */
+int difo_list(const char *root, int sort, const difo_options *options, difo_visitor visit, void *user_data)
+{
+    if (!root || !visit || sort < DIFO_SORT_NAME || sort > DIFO_SORT_TIME)
+        return EINVAL;
+
+    LibraryScan scan(options);
+    int error = 0;
+    SortOrderDef order = scan.flags & DIFO_DESCENDING ? DESC : ASC;
+    std::vector<EntryInfo> entries = sort_files(root, static_cast<SortTypeDef>(sort), order, scan.options.filter, &error);
+    if (error != 0)
+        return error;
+
+    for (const EntryInfo &entry : entries)
+    {
+        if (!scan.options.show_hidden && entry.name[0] == '.')
+            continue;
+        difo_entry visited = to_entry(entry, entry.name, 1);
+        if (visit(&visited, user_data) == DIFO_STOP)
+            break;
+    }
+    return 0;
+}
@@ -0,0 +1,321 @@
+/**
+ ******************************************************************************
+ * @file    myNodeStore.cpp
+ * @brief   Implementation of the compact, arena-backed storage of directory tree nodes.
+ * @author  Arun, Sagar, Saurav
+ * @date    March 7, 2024
+ ******************************************************************************
+ */
+
+#include "myNodeStore.hpp"
+#include "myCollate.hpp"
+#include <algorithm>
+#include <cstring>
+
+/**
+ * @brief Hashes a name for the intern table (FNV-1a).
+ * @param name The name.
+ * @return The hash value.
+ */
+static uint64_t hash_name(std::string_view name)
+{
+    uint64_t hash = 14695981039346656037ull;
+    for (unsigned char c : name)
+    {
+        hash = (hash ^ c) * 1099511628211ull;
+    }
+    return hash;
+}
+
+/**
+ * @brief Constructor. Creates an empty store.
+ */
+NodeStore::NodeStore() : is_full(false), node_count(0), name_end(0), intern_table(1024, 0), intern_count(0)
+{
+    node_chunks.reserve(std::size_t(1) << (32 - NODE_CHUNK_BITS));
+    name_chunks.reserve(std::size_t(1) << (32 - NAME_CHUNK_BITS));
+}
+
+/**
+ * @brief Adds the root node.
+ * @param path The path of the root, used as its name.
+ * @return The id of the root node.
+ */
+NodeId NodeStore::add_root(const std::string &path)
+{
+    std::lock_guard<std::mutex> guard(mutex);
+    root_name = path;
+    node_chunks.push_back(std::make_unique<TreeNode[]>(std::size_t(1) << NODE_CHUNK_BITS));
+    node_count = 1;
+    node(0) = TreeNode();
+    node(0).flags = NODE_DIRECTORY;
+    return 0;
+}
+
+/**
+ * @brief Locks the store for a batch of add_child() calls.
+ * @return The lock, released when it goes out of scope.
+ */
+std::unique_lock<std::mutex> NodeStore::lock()
+{
+    return std::unique_lock<std::mutex>(mutex);
+}
+
+/**
+ * @brief Appends a node as the next child of @p parent. The store must be locked.
+ * @param parent The parent node.
+ * @param previous The previously added child of @p parent, or NO_NODE for the first one.
+ * @param name The name of the new node.
+ * @param flags The NodeFlagDef bits of the new node.
+ * @return The id of the new node, NO_NODE if the store is full.
+ */
+NodeId NodeStore::add_child(NodeId parent, NodeId previous, std::string_view name, uint8_t flags)
+{
+    NodeId id = allocate(parent, name, flags);
+    if (id == NO_NODE)
+        return NO_NODE;
+    if (previous == NO_NODE)
+        node(parent).first_child = id;
+    else
+        node(previous).next_sibling = id;
+    return id;
+}
+
+/**
+ * @brief Inserts a node among the children of @p parent, keeping them in name order. The store must be locked.
+ *
+ * NODE_LAST is set on the new node, and cleared on its predecessor, when it becomes the last child.
+ *
+ * @param parent The parent node.
+ * @param name The name of the new node.
+ * @param flags The NodeFlagDef bits of the new node, NODE_LAST ignored.
+ * @return The id of the new node, NO_NODE if the store is full.
+ */
+NodeId NodeStore::insert_child(NodeId parent, std::string_view name, uint8_t flags)
+{
+    // The key of the new name is built once, the siblings' keys reuse one buffer
+    std::string key;
+    std::string sibling_key;
+    append_name_key(key, name);
+    NodeId previous = NO_NODE;
+    NodeId next = node(parent).first_child;
+    while (next != NO_NODE)
+    {
+        sibling_key.clear();
+        append_name_key(sibling_key, this->name(next));
+        if (!(sibling_key < key))
+            break;
+        previous = next;
+        next = node(next).next_sibling;
+    }
+
+    NodeId id = allocate(parent, name, flags & ~NODE_LAST);
+    if (id == NO_NODE)
+        return NO_NODE;
+    node(id).next_sibling = next;
+    if (previous == NO_NODE)
+        node(parent).first_child = id;
+    else
+        node(previous).next_sibling = id;
+
+    if (next == NO_NODE)
+    {
+        node(id).flags |= NODE_LAST;
+        if (previous != NO_NODE)
+            node(previous).flags &= ~NODE_LAST;
+    }
+    return id;
+}
+
+/**
+ * @brief Unlinks a node, with its subtree, from its parent. The store must be locked.
+ *
+ * The nodes stay in the arena, unreachable. NODE_LAST moves to the new last child.
+ *
+ * @param id The node to unlink.
+ */
+void NodeStore::remove_child(NodeId id)
+{
+    NodeId parent = node(id).parent;
+    NodeId previous = NO_NODE;
+    for (NodeId current = node(parent).first_child; current != id; current = node(current).next_sibling)
+    {
+        previous = current;
+    }
+
+    NodeId next = node(id).next_sibling;
+    if (previous == NO_NODE)
+        node(parent).first_child = next;
+    else
+        node(previous).next_sibling = next;
+
+    if (next == NO_NODE && previous != NO_NODE)
+        node(previous).flags |= NODE_LAST;
+    node(id).next_sibling = NO_NODE;
+}
+
+/**
+ * @brief Finds a child by name, walking the sibling links.
+ * @param parent The parent node.
+ * @param name The name of the child.
+ * @return The child, or NO_NODE if there is none.
+ */
+NodeId NodeStore::find_child(NodeId parent, std::string_view name) const
+{
+    for (NodeId current = node(parent).first_child; current != NO_NODE; current = node(current).next_sibling)
+    {
+        if (this->name(current) == name)
+            return current;
+    }
+    return NO_NODE;
+}
+
+/**
+ * @brief Creates an unlinked node.
+ * @param parent The parent node.
+ * @param name The name of the new node.
+ * @param flags The NodeFlagDef bits of the new node.
+ * @return The id of the new node, NO_NODE with full() set if the arena or the name pool is exhausted.
+ */
+NodeId NodeStore::allocate(NodeId parent, std::string_view name, uint8_t flags)
+{
+    // Called from walker visitors, which must not throw, so a full store is a flag
+    uint32_t name_offset = node_count == NO_NODE ? NO_NAME : intern(name);
+    if (name_offset == NO_NAME)
+    {
+        is_full = true;
+        return NO_NODE;
+    }
+
+    NodeId id = static_cast<NodeId>(node_count);
+    if ((id & NODE_CHUNK_MASK) == 0)
+    {
+        node_chunks.push_back(std::make_unique<TreeNode[]>(std::size_t(1) << NODE_CHUNK_BITS));
+    }
+    node_count++;
+
+    TreeNode &child = node(id);
+    child.parent = parent;
+    child.name = name_offset;
+    child.flags = flags;
+    return id;
+}
+
+/**
+ * @brief Gets the name of a node.
+ * @param id The node id.
+ * @return The interned name.
+ */
+std::string_view NodeStore::name(NodeId id) const
+{
+    if (node(id).parent == NO_NODE)
+        return root_name;
+
+    uint32_t offset = node(id).name;
+    const char *entry = &name_chunks[offset >> NAME_CHUNK_BITS][offset & NAME_CHUNK_MASK];
+    return std::string_view(entry + 1, static_cast<unsigned char>(entry[0]));
+}
+
+/**
+ * @brief Rebuilds the full path of a node from its ancestors.
+ * @param id The node id.
+ * @return The full path.
+ */
+std::string NodeStore::path(NodeId id) const
+{
+    std::vector<std::string_view> parts;
+    for (NodeId current = id; current != NO_NODE; current = node(current).parent)
+    {
+        parts.push_back(name(current));
+    }
+
+    std::string full_path;
+    for (auto it = parts.rbegin(); it != parts.rend(); ++it)
+    {
+        if (it != parts.rbegin())
+            full_path += '/';
+        full_path += *it;
+    }
+    return full_path;
+}
+
+/**
+ * @brief Interns a name, storing it only the first time it is seen.
+ * @param name The name, at most 255 bytes.
+ * @return The offset of the name in the pool, NO_NAME if the pool is full.
+ */
+uint32_t NodeStore::intern(std::string_view name)
+{
+    std::size_t mask = intern_table.size() - 1;
+    for (std::size_t slot = hash_name(name) & mask;; slot = (slot + 1) & mask)
+    {
+        uint32_t stored = intern_table[slot];
+        if (stored == 0)
+        {
+            uint32_t offset = store_name(name);
+            if (offset == NO_NAME)
+                return NO_NAME;
+            intern_table[slot] = offset + 1;
+            if (++intern_count * 2 > intern_table.size())
+                grow_intern_table();
+            return offset;
+        }
+
+        uint32_t offset = stored - 1;
+        const char *entry = &name_chunks[offset >> NAME_CHUNK_BITS][offset & NAME_CHUNK_MASK];
+        if (static_cast<unsigned char>(entry[0]) == name.size() && std::memcmp(entry + 1, name.data(), name.size()) == 0)
+            return offset;
+    }
+}
+
+/**
+ * @brief Copies a name into the pool as a length byte followed by the bytes.
+ * @param name The name, at most 255 bytes.
+ * @return The offset of the stored name, NO_NAME if the pool is full.
+ */
+uint32_t NodeStore::store_name(std::string_view name)
+{
+    std::size_t length = std::min<std::size_t>(name.size(), 255);
+    std::size_t chunk_size = std::size_t(1) << NAME_CHUNK_BITS;
+
+    // Names never straddle chunks, skip to the next one when the current is too full
+    std::size_t used = name_end & NAME_CHUNK_MASK;
+    if (name_chunks.empty() || used + length + 1 > chunk_size)
+    {
+        if (name_chunks.size() == name_chunks.capacity())
+            return NO_NAME;
+        name_end = name_chunks.size() * chunk_size;
+        name_chunks.push_back(std::make_unique<char[]>(chunk_size));
+    }
+
+    uint32_t offset = static_cast<uint32_t>(name_end);
+    char *entry = &name_chunks[offset >> NAME_CHUNK_BITS][offset & NAME_CHUNK_MASK];
+    entry[0] = static_cast<char>(length);
+    std::memcpy(entry + 1, name.data(), length);
+    name_end += length + 1;
+    return offset;
+}
+
+/**
+ * @brief Doubles the intern table and rehashes the stored names.
+ */
+void NodeStore::grow_intern_table()
+{
+    std::vector<uint32_t> old_table(intern_table.size() * 2, 0);
+    old_table.swap(intern_table);
+    std::size_t mask = intern_table.size() - 1;
+
+    for (uint32_t stored : old_table)
+    {
+        if (stored == 0)
+            continue;
+        uint32_t offset = stored - 1;
+        const char *entry = &name_chunks[offset >> NAME_CHUNK_BITS][offset & NAME_CHUNK_MASK];
+        std::size_t slot = hash_name(std::string_view(entry + 1, static_cast<unsigned char>(entry[0]))) & mask;
+        while (intern_table[slot] != 0)
+        {
+            slot = (slot + 1) & mask;
+        }
+        intern_table[slot] = stored;
+    }
+}
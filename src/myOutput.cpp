@@ -0,0 +1,172 @@
+/**
+ ******************************************************************************
+ * @file    myOutput.cpp
+ * @brief   Implementation of the buffered output sink shared by all views.
+ * @author  Arun, Sagar, Saurav
+ * @date    March 7, 2024
+ ******************************************************************************
+ */
+
+#include "myOutput.hpp"
+#include "myStats.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <sys/ioctl.h>
+
+/**
+ * @brief Constructor.
+ * @param fd The file descriptor to write to.
+ * @param capacity The size of the user-space buffer in bytes.
+ */
+Output::Output(int fd, std::size_t capacity)
+    : fd(fd), terminal(isatty(fd) == 1), buffer(capacity), used(0), written(0)
+{
+    const char *no_color = std::getenv("NO_COLOR");
+    use_colors = terminal && (no_color == nullptr || no_color[0] == '\0');
+}
+
+/**
+ * @brief Destructor. Flushes the buffer.
+ */
+Output::~Output()
+{
+    flush();
+}
+
+/**
+ * @brief Appends raw bytes.
+ * @param data The bytes to append.
+ * @param size The number of bytes.
+ */
+void Output::write(const char *data, std::size_t size)
+{
+    if (used + size > buffer.size())
+    {
+        flush();
+        if (size > buffer.size())
+        {
+            write_all(data, size); // Too big to buffer, hand it to the kernel directly
+            return;
+        }
+    }
+    std::memcpy(buffer.data() + used, data, size);
+    used += size;
+}
+
+/**
+ * @brief Appends a color escape, or nothing when colors are disabled.
+ * @param code The escape sequence.
+ */
+void Output::color(std::string_view code)
+{
+    if (use_colors)
+        write(code.data(), code.size());
+}
+
+/**
+ * @brief Appends @p count copies of a character.
+ * @param count The number of characters.
+ * @param c The character.
+ */
+void Output::pad(std::size_t count, char c)
+{
+    while (count > 0)
+    {
+        if (used == buffer.size())
+            flush();
+        std::size_t chunk = std::min(count, buffer.size() - used);
+        std::memset(buffer.data() + used, c, chunk);
+        used += chunk;
+        count -= chunk;
+    }
+}
+
+/**
+ * @brief Writes the buffered bytes to the file descriptor.
+ */
+void Output::flush()
+{
+    write_all(buffer.data(), used);
+    used = 0;
+}
+
+/**
+ * @brief Writes bytes to the file descriptor, retrying short writes.
+ * @param data The bytes to write.
+ * @param size The number of bytes.
+ */
+void Output::write_all(const char *data, std::size_t size)
+{
+    PhaseTimer timer(PHASE_OUTPUT);
+    std::size_t offset = 0;
+    while (offset < size)
+    {
+        count_call(CALL_WRITE);
+        ssize_t result = ::write(fd, data + offset, size - offset);
+        if (result < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            break; // Reader went away or disk full, nothing sensible left to do
+        }
+        offset += result;
+    }
+    written += offset;
+}
+
+/**
+ * @brief Gets the width of the terminal.
+ *
+ * The columns of the terminal when TIOCGWINSZ reports them. Otherwise
+ * $COLUMNS when it holds a positive number, for pipes and files as well as
+ * for a terminal whose size cannot be read, and 80 without it.
+ *
+ * @return The number of columns.
+ */
+int Output::width() const
+{
+    struct winsize w;
+    if (terminal && ioctl(fd, TIOCGWINSZ, &w) == 0 && w.ws_col > 0)
+        return w.ws_col;
+
+    const char *columns = std::getenv("COLUMNS");
+    if (columns && std::atoi(columns) > 0)
+        return std::atoi(columns);
+    return 80;
+}
+
+/**
+ * @brief Gets the height of the terminal.
+ *
+ * The rows of the terminal when TIOCGWINSZ reports them. Otherwise
+ * $LINES when it holds a positive number, for pipes and files as well as
+ * for a terminal whose size cannot be read, and 24 without it.
+ *
+ * @return The number of rows.
+ */
+int Output::height() const
+{
+    struct winsize w;
+    if (terminal && ioctl(fd, TIOCGWINSZ, &w) == 0 && w.ws_row > 0)
+        return w.ws_row;
+
+    const char *lines = std::getenv("LINES");
+    if (lines && std::atoi(lines) > 0)
+        return std::atoi(lines);
+    return 24;
+}
+
+/**
+ * @brief Gets the standard output sink used by all views.
+ *
+ * Colors are enabled when standard output is a terminal and NO_COLOR is unset or empty.
+ *
+ * @return The sink.
+ */
+Output &out()
+{
+    static Output sink(STDOUT_FILENO);
+    return sink;
+}
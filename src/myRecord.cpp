@@ -0,0 +1,296 @@
+/**
+ ******************************************************************************
+ * @file    myRecord.cpp
+ * @brief   Implementation of the machine-readable output formats.
+ * @author  Arun, Sagar, Saurav
+ * @date    March 7, 2024
+ ******************************************************************************
+ */
+
+#include "myRecord.hpp"
+#include "myFilter.hpp"
+#include "myOutput.hpp"
+#include <atomic>
+#include <charconv>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <sys/stat.h>
+
+static constexpr std::size_t RECORD_FLUSH_SIZE = 64 * 1024; /**< Bytes a walker thread collects before taking the output lock. */
+
+/**
+ * @brief Appends an integer in decimal.
+ * @param buffer The buffer.
+ * @param value The integer.
+ */
+template <typename T>
+static void append_number(std::string &buffer, T value)
+{
+    char digits[24];
+    auto result = std::to_chars(digits, digits + sizeof(digits), value);
+    buffer.append(digits, result.ptr - digits);
+}
+
+/**
+ * @brief Appends an integer in little-endian order.
+ * @param buffer The buffer.
+ * @param value The integer.
+ */
+template <typename T>
+static void append_le(std::string &buffer, T value)
+{
+    auto bits = static_cast<std::make_unsigned_t<T>>(value);
+    for (std::size_t byte = 0; byte < sizeof(T); ++byte)
+    {
+        buffer += static_cast<char>(bits >> (8 * byte));
+    }
+}
+
+/**
+ * @brief Gets the length of the UTF-8 sequence at the start of a text.
+ * @param text The text.
+ * @return The length of the sequence, 0 if it is not valid UTF-8.
+ */
+static std::size_t utf8_length(std::string_view text)
+{
+    auto byte = [&text](std::size_t i)
+    { return static_cast<unsigned char>(text[i]); };
+    auto continuation = [&](std::size_t i)
+    { return i < text.size() && (byte(i) & 0xC0) == 0x80; };
+
+    unsigned char lead = byte(0);
+    if (lead >= 0xC2 && lead <= 0xDF)
+        return continuation(1) ? 2 : 0;
+    if (lead >= 0xE0 && lead <= 0xEF)
+    {
+        // No overlong forms, no surrogates
+        if (!continuation(1) || !continuation(2) || (lead == 0xE0 && byte(1) < 0xA0) || (lead == 0xED && byte(1) > 0x9F))
+            return 0;
+        return 3;
+    }
+    if (lead >= 0xF0 && lead <= 0xF4)
+    {
+        if (!continuation(1) || !continuation(2) || !continuation(3) || (lead == 0xF0 && byte(1) < 0x90) || (lead == 0xF4 && byte(1) > 0x8F))
+            return 0;
+        return 4;
+    }
+    return 0;
+}
+
+/**
+ * @brief Appends a JSON string.
+ * @param buffer The buffer.
+ * @param text The text; bytes that are not valid UTF-8 become U+FFFD.
+ */
+static void append_json_string(std::string &buffer, std::string_view text)
+{
+    static constexpr char hex[] = "0123456789abcdef";
+
+    buffer += '"';
+    std::size_t i = 0;
+    while (i < text.size())
+    {
+        unsigned char c = static_cast<unsigned char>(text[i]);
+        if (c >= 0x80)
+        {
+            std::size_t length = utf8_length(text.substr(i));
+            if (length == 0)
+            {
+                buffer += "\\ufffd";
+                i++;
+            }
+            else
+            {
+                buffer.append(text.data() + i, length);
+                i += length;
+            }
+            continue;
+        }
+
+        if (c == '"' || c == '\\')
+        {
+            buffer += '\\';
+            buffer += static_cast<char>(c);
+        }
+        else if (c < 0x20)
+        {
+            buffer += "\\u00";
+            buffer += hex[c >> 4];
+            buffer += hex[c & 0xF];
+        }
+        else
+        {
+            buffer += static_cast<char>(c);
+        }
+        i++;
+    }
+    buffer += '"';
+}
+
+/**
+ * @brief Appends the record of one entry to a buffer.
+ * @param buffer The buffer.
+ * @param format FORMAT_NDJSON or FORMAT_BIN.
+ * @param path The path of the entry.
+ * @param entry The entry.
+ */
+void encode_record(std::string &buffer, OutputFormatDef format, std::string_view path, const EntryInfo &entry)
+{
+    if (format == FORMAT_BIN)
+    {
+        uint8_t flags = (entry.is_symlink ? RECORD_SYMLINK : 0) | (entry.has_stat ? 0 : RECORD_STAT_FAILED);
+        append_le(buffer, static_cast<uint32_t>(path.size()));
+        append_le(buffer, static_cast<uint8_t>(entry.type));
+        append_le(buffer, flags);
+        append_le(buffer, static_cast<uint16_t>(0));
+        append_le(buffer, entry.size);
+        append_le(buffer, entry.blocks);
+        append_le(buffer, entry.mtime_ns);
+        append_le(buffer, entry.ino);
+        buffer.append(path);
+        return;
+    }
+
+    static constexpr const char *type_names[] = {"unknown", "file", "directory", "symlink", "other"};
+    buffer += "{\"path\":";
+    append_json_string(buffer, path);
+    buffer += ",\"type\":\"";
+    buffer += type_names[entry.type];
+    buffer += "\",\"size\":";
+    append_number(buffer, entry.size);
+    buffer += ",\"blocks\":";
+    append_number(buffer, entry.blocks);
+    buffer += ",\"mtime_ns\":";
+    append_number(buffer, entry.mtime_ns);
+    buffer += ",\"inode\":";
+    append_number(buffer, entry.ino);
+    buffer += "}\n";
+}
+
+/**
+ * @brief Writes the start of a stream: the magic of a binary stream, nothing for NDJSON.
+ * @param format FORMAT_NDJSON or FORMAT_BIN.
+ */
+static void begin_records(OutputFormatDef format)
+{
+    if (format == FORMAT_BIN)
+        out() << RECORD_MAGIC;
+}
+
+/**
+ * @brief Writes the records of a list of entries, in order.
+ * @param entries The entries.
+ * @param show_hidden Whether to include hidden entries.
+ * @param format FORMAT_NDJSON or FORMAT_BIN.
+ */
+void print_records(const std::vector<EntryInfo> &entries, bool show_hidden, OutputFormatDef format)
+{
+    Output &sink = out();
+    begin_records(format);
+
+    std::string buffer;
+    for (const EntryInfo &entry : entries)
+    {
+        if (!show_hidden && entry.name[0] == '.')
+            continue;
+        buffer.clear();
+        encode_record(buffer, format, entry.name, entry);
+        sink << buffer;
+    }
+    sink.flush();
+}
+
+/**
+ * @brief A directory whose entries are still to be written.
+ */
+struct RecordTask
+{
+    std::string path; /**< The path relative to the walked directory, empty for the root. */
+    unsigned depth; /**< The level of its entries, the root's children being level 1. */
+    std::shared_ptr<const FilterScope> scope; /**< The filter scope of the parent directory. */
+};
+
+/**
+ * @brief Writes the records of every entry below a directory, as the walk finds them.
+ * @param path The path to the directory; record paths are relative to it.
+ * @param options The scan options, depth and entry limits included.
+ * @param format FORMAT_NDJSON or FORMAT_BIN.
+ * @return true on success, false with a message on the error stream if @p path is not a directory.
+ */
+bool print_tree_records(const std::string &path, const ScanOptions &options, OutputFormatDef format)
+{
+    struct stat root_stat;
+    if (stat(path.c_str(), &root_stat) != 0 || !S_ISDIR(root_stat.st_mode))
+    {
+        std::cerr << "Error opening directory: " << path << std::endl;
+        return false;
+    }
+
+    Output &sink = out();
+    std::mutex sink_mutex;
+    std::atomic<uint64_t> written{0};
+    std::atomic<bool> stopped{false};
+    begin_records(format);
+
+    // Whole records only: a worker hands over its buffer under the lock
+    auto emit = [&](std::string &buffer)
+    {
+        std::lock_guard<std::mutex> lock(sink_mutex);
+        sink << buffer;
+        buffer.clear();
+    };
+
+    Walker<RecordTask> walker(options.jobs);
+    RecordTask root{"", 1, options.filter ? options.filter->root(path) : nullptr};
+    walker.run(std::move(root), [&](unsigned, RecordTask &task, std::vector<RecordTask> &subdirs)
+               {
+        if (stopped)
+            return;
+
+        std::string directory = task.path.empty() ? path : path + "/" + task.path;
+        DirectoryReader reader(directory);
+        if (!reader.is_open())
+        {
+            std::cerr << "Error: " << directory_error(directory, reader.error()) << std::endl;
+            return;
+        }
+
+        std::shared_ptr<const FilterScope> scope = options.filter ? options.filter->apply(task.scope, directory, reader) : nullptr;
+        auto wanted = [&options](const EntryInfo &entry)
+        {
+            return options.show_hidden || entry.name[0] != '.';
+        };
+        reader.stat_all(false, wanted);
+
+        thread_local std::string buffer;
+        std::string relative;
+        for (EntryInfo &entry : reader.entries)
+        {
+            if (!wanted(entry))
+                continue;
+            if (options.max_entries != 0 && written++ >= options.max_entries)
+            {
+                stopped = true;
+                break;
+            }
+
+            reader.stat(entry, false);
+            relative = task.path.empty() ? entry.name : task.path + "/" + entry.name;
+            encode_record(buffer, format, relative, entry);
+            if (buffer.size() >= RECORD_FLUSH_SIZE)
+                emit(buffer);
+
+            // Directories at the depth limit are written but not opened
+            if (entry.type == ENTRY_DIRECTORY && (options.max_depth == 0 || task.depth < options.max_depth) &&
+                (!options.one_file_system || entry.dev == root_stat.st_dev))
+            {
+                subdirs.push_back({std::move(relative), task.depth + 1, scope});
+            }
+        }
+        if (!buffer.empty())
+            emit(buffer); });
+
+    sink.flush();
+    return true;
+}
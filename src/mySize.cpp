@@ -1,121 +1,434 @@
 /**
  ******************************************************************************
  * @file    mySize.cpp
- * @brief   Implementation of functions for printing directory sizes and drawing size bars.
+ * @brief   Implementation of functions for computing recursive disk usage and drawing size bars.
  * @author  Arun, Sagar, Saurav
  * @date    March 7, 2024
  ******************************************************************************
  */
 
 #include "mySize.hpp"
+#include "myCollate.hpp"
 #include "myColors.hpp"
+#include "myFilter.hpp"
+#include "myIterator.hpp"
+#include "mySort.hpp"
 #include "myTypeDef.h"
+#include "myOutput.hpp"
+#include "myRecord.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <atomic>
 #include <iostream>
-#include <iomanip>
-#include <unistd.h>
-#include <dirent.h>
-#include <sys/ioctl.h>
+#include <memory>
+#include <numeric>
 #include <sys/stat.h>
 
 /**
- * @brief Print the size of a directory.
+ * @brief A subdirectory waiting to be summed up.
+ */
+struct SizeTask
+{
+    std::string path; /**< The full path of the directory. */
+    std::size_t index; /**< The top-level entry the directory belongs to. */
+    std::shared_ptr<const FilterScope> scope; /**< The filter scope of the parent directory. */
+};
+
+/**
+ * @brief A file with several hard links, met under one top-level entry.
+ */
+struct LinkedFile
+{
+    uint64_t dev; /**< The device of the file. */
+    uint64_t ino; /**< The inode of the file. */
+    uint32_t rank; /**< The rank of the top-level entry by name, lowest owns the file. */
+    uint32_t index; /**< The top-level entry the link was met under. */
+    uint64_t apparent; /**< The size of the file. */
+    uint64_t allocated; /**< The allocated size of the file. */
+};
+
+/**
+ * @brief Counts every file with several hard links once, under the first top-level entry by name.
+ *
+ * The owner does not depend on which thread met a link first, nor on the
+ * listing order, so live scans and the index agree from run to run.
+ *
+ * @param files The links met, reordered.
+ * @param usage The disk usage of the top-level entries, added to.
+ */
+static void count_linked_files(std::vector<LinkedFile> &files, std::vector<DiskUsage> &usage)
+{
+    std::sort(files.begin(), files.end(), [](const LinkedFile &a, const LinkedFile &b)
+              { return a.dev != b.dev ? a.dev < b.dev : a.ino != b.ino ? a.ino < b.ino : a.rank < b.rank; });
+    for (std::size_t index = 0; index < files.size(); ++index)
+    {
+        const LinkedFile &file = files[index];
+        if (index > 0 && files[index - 1].dev == file.dev && files[index - 1].ino == file.ino)
+            continue;
+        usage[file.index].apparent += file.apparent;
+        usage[file.index].allocated += file.allocated;
+    }
+}
+
+/**
+ * @brief Compute the recursive disk usage of the entries of a directory.
  *
- * This function prints the size of the specified directory along with a visual representation
- * of the sizes of directories and files within it.
+ * Subdirectories are walked in parallel. Symbolic links are not followed and
+ * files with several hard links are counted only once, like du does, under
+ * the first top-level entry by name. With options.one_file_system, mount
+ * points are neither counted nor entered, like du -x.
  *
  * @param directory The path to the directory.
- * @param max_size The maximum size to consider.
- * @param show_hidden Whether to include hidden files and directories in the size calculation.
+ * @param entries The entries of the directory, already stat-ed without following links.
+ * @param root_dev The device of @p directory, used by options.one_file_system.
+ * @param options The scan options; hidden entries of @p directory are skipped unless
+ *        options.show_hidden, hidden entries below them are always counted.
+ * @param scope The filter scope of the subdirectories of @p directory, when options.filter is set.
+ * @return The disk usage of every entry, in the same order as @p entries.
  */
-void print_size(const std::string &directory, long long max_size, bool show_hidden)
+std::vector<DiskUsage> disk_usage(const std::string &directory, const std::vector<EntryInfo> &entries, uint64_t root_dev, const ScanOptions &options,
+                                  const std::shared_ptr<const FilterScope> &scope)
 {
-    std::cout << COLOR_TEXT << "Size of directories and files in current directory:" << std::endl;
-    
-    struct winsize w;
-    ioctl(STDOUT_FILENO, TIOCGWINSZ, &w);
-    int terminal_width = w.ws_col;
-    int max_name_length = 0;
+    std::unique_ptr<std::atomic<uint64_t>[]> apparent(new std::atomic<uint64_t>[entries.size()]());
+    std::unique_ptr<std::atomic<uint64_t>[]> allocated(new std::atomic<uint64_t>[entries.size()]());
+    std::vector<SizeTask> roots;
+    Walker<SizeTask> walker(options.jobs);
+    std::vector<std::vector<LinkedFile>> linked(walker.jobs() + 1); // One list per worker, the last for the top level
+
+    // The rank of every entry by name, which decides who owns a shared inode
+    std::vector<uint32_t> order(entries.size());
+    std::vector<uint32_t> ranks(entries.size());
+    for (std::size_t index = 0; index < entries.size(); ++index)
+    {
+        order[index] = static_cast<uint32_t>(index);
+    }
+    std::sort(order.begin(), order.end(), [&entries](uint32_t a, uint32_t b)
+              { return entries[a].name < entries[b].name; });
+    for (std::size_t rank = 0; rank < order.size(); ++rank)
+    {
+        ranks[order[rank]] = static_cast<uint32_t>(rank);
+    }
 
-    DIR *dir;
-    struct dirent *entry;
-    if ((dir = opendir(directory.c_str())) != nullptr)
+    // Files with several hard links are set aside, and counted once after the walk
+    auto counts = [&linked, &ranks](unsigned list, std::size_t index, const EntryInfo &entry)
     {
-        while ((entry = readdir(dir)) != nullptr)
+        if (entry.type == ENTRY_DIRECTORY || entry.nlink <= 1)
+            return true;
+        linked[list].push_back({entry.dev, entry.ino, ranks[index], static_cast<uint32_t>(index), entry.size, entry.blocks * 512});
+        return false;
+    };
+
+    for (std::size_t index = 0; index < entries.size(); ++index)
+    {
+        const EntryInfo &entry = entries[index];
+        if (!entry.has_stat || (!options.show_hidden && entry.name[0] == '.'))
+            continue;
+        if (entry.type == ENTRY_DIRECTORY && options.one_file_system && entry.dev != root_dev)
+            continue; // A mount point, neither counted nor entered, like du -x
+        if (!counts(walker.jobs(), index, entry))
+            continue;
+
+        apparent[index] = entry.size;
+        allocated[index] = entry.blocks * 512;
+        if (entry.type == ENTRY_DIRECTORY)
         {
-            std::string item = entry->d_name;
-            if (show_hidden || item[0] != '.')
-            {
-                max_name_length = std::max(max_name_length, static_cast<int>(item.size()));
-            }
+            roots.push_back({directory + "/" + entry.name, index, scope});
         }
-        closedir(dir);
+    }
 
-        if ((dir = opendir(directory.c_str())) != nullptr)
+    walker.run(std::move(roots), [&](unsigned worker, SizeTask &task, std::vector<SizeTask> &subdirs)
+               {
+        DirectoryReader reader(task.path);
+        if (!reader.is_open())
         {
-            while ((entry = readdir(dir)) != nullptr)
+            std::cerr << "Error: " << directory_error(task.path, reader.error()) << std::endl;
+            return;
+        }
+
+        std::shared_ptr<const FilterScope> scope = options.filter ? options.filter->apply(task.scope, task.path, reader) : nullptr;
+        uint64_t dir_apparent = 0;
+        uint64_t dir_allocated = 0;
+        reader.stat_all(false);
+        for (EntryInfo &entry : reader.entries)
+        {
+            if (!reader.stat(entry, false))
+                continue;
+            if (entry.type == ENTRY_DIRECTORY)
             {
-                std::string item = entry->d_name;
-                if (show_hidden || item[0] != '.')
-                {
-                    std::string full_path = directory + "/" + item;
-                    struct stat st;
-                    if (stat(full_path.c_str(), &st) == 0)
-                    {
-                        long long size = st.st_size;
-                        int max_bar_length = terminal_width - max_name_length - 16; // Adjusted for spacing and units
-                        int bar_length = static_cast<int>(size / static_cast<double>(max_size) * max_bar_length);
-                        std::string size_str = size < 1024 ? std::to_string(size) + " bytes" : std::to_string(size / 1024.0) + " KB";
-                        std::string color = get_file_color(full_path, item[0] == '.');
-                        std::string color_bar = COLOR_BAR;
-                        std::cout << color << std::setw(max_name_length) << std::left << item << " ";
-                        std::cout << color_bar << std::string(bar_length, '=') << COLOR_TEXT << " " << size_str << std::endl;
-                    }
-                }
+                if (options.one_file_system && entry.dev != root_dev)
+                    continue; // A mount point, neither counted nor entered
+                subdirs.push_back({task.path + "/" + entry.name, task.index, scope});
             }
-            closedir(dir);
+            else if (!counts(worker, task.index, entry))
+            {
+                continue;
+            }
+            dir_apparent += entry.size;
+            dir_allocated += entry.blocks * 512;
         }
+
+        // One atomic update per directory, not per entry
+        apparent[task.index] += dir_apparent;
+        allocated[task.index] += dir_allocated; });
+
+    std::vector<DiskUsage> usage(entries.size());
+    for (std::size_t index = 0; index < entries.size(); ++index)
+    {
+        usage[index].apparent = apparent[index];
+        usage[index].allocated = allocated[index];
     }
-    else
+    std::vector<LinkedFile> files;
+    for (std::vector<LinkedFile> &list : linked)
     {
-        std::cerr << "Error opening directory: " << directory << std::endl;
-        exit(OPEN_FAILURE);
+        files.insert(files.end(), list.begin(), list.end());
     }
+    count_linked_files(files, usage);
+    return usage;
 }
 
 /**
- * @brief Draw a size bar for a directory.
+ * @brief Compute the recursive disk usage of the children of an indexed directory.
  *
- * This function draws a visual representation of the size of the specified directory.
+ * Same rules as disk_usage(), summed from the index without touching the file system.
  *
- * @param show_hidden Whether to include hidden files and directories in the size calculation.
- * @param path The path to the directory.
+ * @param index The loaded index.
+ * @param directory The node of the directory.
+ * @param options The scan options.
+ * @return The disk usage of every child, in the same order as ScanIndex::entries().
  */
-void draw_size_bar(bool show_hidden, const std::string &path)
+std::vector<DiskUsage> disk_usage(const ScanIndex &index, NodeId directory, const ScanOptions &options)
 {
-    long long max_size = 0;
-    DIR *dir;
-    struct dirent *entry;
-    if ((dir = opendir(path.c_str())) != nullptr)
+    const IndexNode &parent = index.node(directory);
+    uint64_t root_dev = parent.dev;
+    std::vector<DiskUsage> usage(parent.child_count);
+    std::vector<LinkedFile> linked;
+    std::vector<NodeId> stack;
+
+    // Children are stored by name, so the position is also the rank that decides who owns a shared inode
+    auto counts = [&linked](uint32_t position, const IndexNode &node)
+    {
+        if (node.is_directory() || node.nlink <= 1)
+            return true;
+        linked.push_back({node.dev, node.ino, position, position, node.size, node.blocks * 512});
+        return false;
+    };
+
+    for (uint32_t position = 0; position < parent.child_count; ++position)
     {
-        while ((entry = readdir(dir)) != nullptr)
+        NodeId id = parent.first_child + position;
+        const IndexNode &entry = index.node(id);
+        if ((entry.flags & INDEX_STAT_FAILED) || (!options.show_hidden && index.name(id)[0] == '.'))
+            continue;
+        if (entry.is_directory() && options.one_file_system && entry.dev != root_dev)
+            continue; // A mount point, neither counted nor entered, like du -x
+        if (!counts(position, entry))
+            continue;
+
+        usage[position].apparent = entry.size;
+        usage[position].allocated = entry.blocks * 512;
+        if (!entry.is_directory())
+            continue;
+
+        stack.push_back(id);
+        while (!stack.empty())
         {
-            std::string item = entry->d_name;
-            if (show_hidden || item[0] != '.')
+            const IndexNode &node = index.node(stack.back());
+            stack.pop_back();
+            for (uint32_t child_index = 0; child_index < node.child_count; ++child_index)
             {
-                std::string full_path = path + "/" + item;
-                struct stat st;
-                if (stat(full_path.c_str(), &st) == 0)
+                const IndexNode &child = index.node(node.first_child + child_index);
+                if (child.flags & INDEX_STAT_FAILED)
+                    continue;
+                if (child.is_directory())
+                {
+                    if (options.one_file_system && child.dev != root_dev)
+                        continue; // A mount point, neither counted nor entered
+                    stack.push_back(node.first_child + child_index);
+                }
+                else if (!counts(position, child))
                 {
-                    max_size = std::max(max_size, static_cast<long long>(st.st_size));
+                    continue;
                 }
+                usage[position].apparent += child.size;
+                usage[position].allocated += child.blocks * 512;
             }
         }
-        closedir(dir);
-        print_size(path, max_size, show_hidden);
     }
-    else
+    count_linked_files(linked, usage);
+    return usage;
+}
+
+/**
+ * @brief Print the size of a directory.
+ *
+ * This function prints one bar per entry, scaled to the biggest entry.
+ *
+ * @param entries The entries of the directory.
+ * @param usage The recursive disk usage of every entry.
+ * @param show_hidden Whether to include hidden files and directories.
+ * @param apparent_size Whether the bars show the apparent size instead of the allocated size.
+ */
+void print_size(const std::vector<EntryInfo> &entries, const std::vector<DiskUsage> &usage, bool show_hidden, bool apparent_size)
+{
+    Output &sink = out();
+    sink.color(COLOR_TEXT);
+    sink << "Size of directories and files in current directory:\n";
+
+    int terminal_width = sink.width();
+    int max_name_length = 0;
+    uint64_t max_size = 0;
+
+    for (std::size_t index = 0; index < entries.size(); ++index)
+    {
+        if ((show_hidden || entries[index].name[0] != '.') && entries[index].has_stat)
+        {
+            max_name_length = std::max(max_name_length, static_cast<int>(entries[index].name.size()));
+            max_size = std::max(max_size, apparent_size ? usage[index].apparent : usage[index].allocated);
+        }
+    }
+
+    int max_bar_length = std::max(terminal_width - max_name_length - 36, 0); // Adjusted for spacing and both sizes
+    for (std::size_t index = 0; index < entries.size(); ++index)
+    {
+        const EntryInfo &entry = entries[index];
+        const std::string &item = entry.name;
+        if ((show_hidden || item[0] != '.') && entry.has_stat)
+        {
+            uint64_t size = apparent_size ? usage[index].apparent : usage[index].allocated;
+            uint64_t other = apparent_size ? usage[index].allocated : usage[index].apparent;
+            int bar_length = max_size > 0 ? static_cast<int>(size / static_cast<double>(max_size) * max_bar_length) : 0;
+
+            sink.color(get_file_color(entry, item[0] == '.'));
+            sink << item;
+            sink.pad(max_name_length - item.size() + 1);
+            sink.color(COLOR_BAR);
+            sink.pad(bar_length, '=');
+            sink.color(COLOR_TEXT);
+            sink << ' ' << format_size(size) << " (" << format_size(other) << (apparent_size ? " allocated)\n" : " apparent)\n");
+        }
+    }
+    sink.color(COLOR_RESET);
+    sink.flush();
+}
+
+/**
+ * @brief Prints the recursive sizes of the entries of a directory as bars or as records.
+ *
+ * The entries are listed in the order of the views, so a live scan and an
+ * index print the same lines.
+ *
+ * @param entries The entries of the directory, reordered.
+ * @param usage The recursive disk usage of every entry, reordered with @p entries.
+ * @param show_hidden Whether to include hidden files and directories.
+ * @param apparent_size Whether the bars show the apparent size instead of the allocated size.
+ * @param format The output format.
+ */
+static void print_usage(std::vector<EntryInfo> &entries, std::vector<DiskUsage> &usage, bool show_hidden, bool apparent_size, OutputFormatDef format)
+{
+    std::vector<std::size_t> order(entries.size());
+    std::iota(order.begin(), order.end(), 0);
+    sort_by_name(order, [&entries](std::size_t index) -> const std::string &
+                 { return entries[index].name; });
+    std::vector<EntryInfo> sorted_entries;
+    std::vector<DiskUsage> sorted_usage;
+    sorted_entries.reserve(order.size());
+    sorted_usage.reserve(order.size());
+    for (std::size_t index : order)
+    {
+        sorted_entries.push_back(std::move(entries[index]));
+        sorted_usage.push_back(usage[index]);
+    }
+    entries = std::move(sorted_entries);
+    usage = std::move(sorted_usage);
+
+    if (format == FORMAT_TEXT)
+    {
+        print_size(entries, usage, show_hidden, apparent_size);
+        return;
+    }
+
+    for (std::size_t index = 0; index < entries.size(); ++index)
+    {
+        entries[index].size = usage[index].apparent;
+        entries[index].blocks = usage[index].allocated / 512;
+    }
+    print_records(entries, show_hidden, format);
+}
+
+/**
+ * @brief Draw a size bar for a directory.
+ *
+ * This function draws a visual representation of the recursive size of every entry
+ * of the specified directory.
+ *
+ * @param path The path to the directory.
+ * @param options The scan options.
+ * @param apparent_size Whether the bars show the apparent size instead of the allocated size.
+ * @param format The output format; records carry the recursive sizes.
+ * @return true on success, false with a message on the error stream if @p path is not a directory.
+ */
+bool draw_size_bar(const std::string &path, const ScanOptions &options, bool apparent_size, OutputFormatDef format)
+{
+    std::vector<EntryInfo> entries;
+    std::vector<DiskUsage> usage;
+    if (directory_usage(path, options, entries, usage) != 0)
     {
         std::cerr << "Error opening directory: " << path << std::endl;
-        exit(OPEN_FAILURE);
+        return false;
     }
+    print_usage(entries, usage, options.show_hidden, apparent_size, format);
+    return true;
+}
+
+/**
+ * @brief Lists a directory and computes the recursive disk usage of its entries.
+ * @param path The path to the directory.
+ * @param options The scan options; the depth and entry limits are ignored.
+ * @param entries Set to the entries of the directory, hidden ones left out unless options.show_hidden.
+ * @param usage Set to the disk usage of every entry, in the same order as @p entries.
+ * @return 0 on success, the errno of opening @p path otherwise.
+ */
+int directory_usage(const std::string &path, const ScanOptions &options, std::vector<EntryInfo> &entries, std::vector<DiskUsage> &usage)
+{
+    // The top level comes from the iterator, the subtrees are summed by the parallel walker
+    ScanOptions listing = options;
+    listing.one_file_system = false; // Mount points are listed, disk_usage() does not enter them
+    listing.max_depth = 1;
+    listing.max_entries = 0;
+    IteratorOptions iteration;
+    iteration.sorted = false;
+    iteration.stat = ITER_STAT_ALL;
+    iteration.follow_links = false;
+
+    struct stat root;
+    EntryIterator it(path, listing, iteration);
+    if (it.error() != 0)
+        return it.error();
+    if (stat(path.c_str(), &root) != 0)
+        return errno;
+
+    entries.clear();
+    std::shared_ptr<const FilterScope> scope;
+    while (it.next())
+    {
+        scope = it.scope();
+        entries.push_back(std::move(it.entry()));
+    }
+    usage = disk_usage(path, entries, root.st_dev, options, scope);
+    return 0;
+}
+
+/**
+ * @brief Draw a size bar for an indexed directory.
+ * @param index The loaded index.
+ * @param directory The node of the directory.
+ * @param options The scan options.
+ * @param apparent_size Whether the bars show the apparent size instead of the allocated size.
+ * @param format The output format; records carry the recursive sizes.
+ */
+void draw_size_bar(const ScanIndex &index, NodeId directory, const ScanOptions &options, bool apparent_size, OutputFormatDef format)
+{
+    std::vector<EntryInfo> entries = index.entries(directory, false);
+    std::vector<DiskUsage> usage = disk_usage(index, directory, options);
+    print_usage(entries, usage, options.show_hidden, apparent_size, format);
 }
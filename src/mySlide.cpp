@@ -12,51 +12,412 @@
 #include "mySlide.hpp"
 #include "myQueue.hpp"
 #include "myTypeDef.h"
+#include "myOutput.hpp"
+#include "myStats.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <fcntl.h>
 #include <iostream>
-#include <fstream>
+#include <memory>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include <thread>
+#include <unistd.h>
+#include <vector>
+
+static constexpr double SLIDE_RATE = 50.0; /**< Characters per second at speed 1.0, one per 20ms. */
+static constexpr std::chrono::microseconds SLIDE_FRAME(16667); /**< Shortest time between two writes, 60 per second. */
+static constexpr std::size_t SLIDE_BUFFER = 64 * 1024; /**< Bytes of a stream read ahead of the display. */
+static constexpr std::size_t SLIDE_READ = 64 * 1024; /**< Bytes read from a stream at once. */
+static constexpr std::size_t SLIDE_AHEAD = 1024 * 1024; /**< Bytes of a mapped file paged in ahead of the display. */
+static constexpr std::size_t SLIDE_MAX_CHARS = 1024 * 1024; /**< Characters written in one frame at most. */
+static constexpr std::chrono::milliseconds SLIDE_POLL(1); /**< How long the renderer waits for a reader that fell behind. */
+
+/**
+ * @brief Bytes read ahead of the display, handed from the reader thread to the renderer.
+ */
+struct SlideBuffer
+{
+    Queue<char, SLIDE_BUFFER> queue; /**< The bytes read and not shown yet. */
+    std::atomic<bool> closed{false}; /**< Whether the reader reached the end of the input. */
+    std::atomic<bool> cancelled{false}; /**< Whether the renderer stopped, so the reader must too. */
+
+    /**
+     * @brief Appends bytes, waiting while the buffer is full. Reader side.
+     * @param data The bytes.
+     * @param size The number of bytes.
+     */
+    void put(const char *data, std::size_t size)
+    {
+        // Backs off up to a frame, the longest the renderer leaves the buffer alone
+        std::chrono::microseconds pause = SLIDE_POLL;
+        while (size > 0 && !cancelled.load(std::memory_order_relaxed))
+        {
+            std::size_t pushed = queue.push_n(data, size);
+            data += pushed;
+            size -= pushed;
+            if (pushed > 0)
+                pause = SLIDE_POLL;
+            else
+            {
+                std::this_thread::sleep_for(pause);
+                pause = std::min<std::chrono::microseconds>(pause * 2, SLIDE_FRAME);
+            }
+        }
+    }
+
+    /**
+     * @brief Waits until bytes are there or the input ended. Renderer side.
+     * @return true if bytes are there, false at the end of the input.
+     */
+    bool wait()
+    {
+        while (queue.is_empty())
+        {
+            // Checked before the queue again, so the last bytes are never missed
+            if (closed.load(std::memory_order_acquire))
+                return !queue.is_empty();
+            std::this_thread::sleep_for(SLIDE_POLL);
+        }
+        return true;
+    }
+};
+
+/**
+ * @brief The input of the slide view: a regular file mapped in memory, or any
+ *        other stream read by a thread into a SlideBuffer.
+ *
+ * The renderer peeks at the bytes not shown yet and consumes what it wrote.
+ * Mapped bytes are written straight from the mapping, without copies.
+ */
+class SlideInput
+{
+public:
+    SlideInput() = default;
+    SlideInput(const SlideInput &) = delete;
+    SlideInput &operator=(const SlideInput &) = delete;
+
+    /**
+     * @brief Destructor. Stops the reader and releases the input.
+     */
+    ~SlideInput()
+    {
+        if (buffer)
+            buffer->cancelled.store(true, std::memory_order_relaxed);
+        finish();
+        if (map)
+            munmap(map, map_size);
+        if (fd > STDIN_FILENO)
+            close(fd);
+    }
+
+    /**
+     * @brief Opens the input and starts reading it.
+     * @param file_path The path to the file, "-" for the standard input.
+     * @param offset The number of bytes skipped at the start.
+     * @return The errno of a failed open, 0 on success.
+     */
+    int open(const std::string &file_path, uint64_t offset)
+    {
+        path = file_path;
+        if (path == "-")
+            fd = STDIN_FILENO;
+        else
+        {
+            count_call(CALL_OPEN);
+            fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+            if (fd < 0)
+                return errno;
+        }
+
+        // A regular file is mapped, starting at the page holding the offset
+        struct stat st;
+        if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0)
+        {
+            uint64_t file_size = static_cast<uint64_t>(st.st_size);
+            uint64_t page = static_cast<uint64_t>(sysconf(_SC_PAGESIZE));
+            uint64_t base = std::min(offset, file_size) / page * page;
+            if (base < file_size)
+            {
+                void *mapped = mmap(nullptr, file_size - base, PROT_READ, MAP_PRIVATE, fd, static_cast<off_t>(base));
+                if (mapped != MAP_FAILED)
+                {
+                    map = static_cast<char *>(mapped);
+                    map_size = file_size - base;
+                    madvise(map, map_size, MADV_SEQUENTIAL);
+                    position = offset - base;
+                    skip_continuation = offset > 0;
+                    return 0;
+                }
+            }
+            else
+                return 0; // Nothing left past the offset
+        }
+
+        // Pipes and terminals cannot seek, their prefix is read and dropped
+        uint64_t skip = offset;
+        if (offset > 0 && lseek(fd, static_cast<off_t>(offset), SEEK_SET) >= 0)
+            skip = 0;
+        skip_continuation = offset > 0;
+        buffer = std::make_unique<SlideBuffer>(); // Too large for the stack
+        frame.resize(SLIDE_BUFFER);
+        reader = std::thread(&SlideInput::read_stream, this, skip);
+        return 0;
+    }
+
+    /**
+     * @brief Waits until bytes are there or the input ended.
+     * @return true if bytes are there, false at the end of the input.
+     */
+    bool more()
+    {
+        if (!buffer)
+            return position < map_size;
+        return held > 0 || buffer->wait();
+    }
+
+    /**
+     * @brief Gets the bytes not shown yet.
+     * @param limit The number of bytes wanted at most.
+     * @param available Set to the number of bytes returned.
+     * @param at_end Set to whether no bytes follow the ones returned.
+     * @return The bytes, valid until consume() or the next call.
+     */
+    const char *peek(std::size_t limit, std::size_t &available, bool &at_end)
+    {
+        if (!buffer)
+        {
+            // Page in ahead of the display, so the renderer does not wait for the disk
+            if (position + SLIDE_AHEAD / 2 > advised && advised < map_size)
+            {
+                std::size_t start = std::max(position, advised) & ~(static_cast<std::size_t>(sysconf(_SC_PAGESIZE)) - 1);
+                madvise(map + start, std::min(SLIDE_AHEAD, map_size - start), MADV_WILLNEED);
+                advised = start + SLIDE_AHEAD;
+            }
+            skip_partial_character(map + position, map_size - position);
+            available = std::min(limit, map_size - position);
+            at_end = position + available == map_size;
+            return map + position;
+        }
+
+        bool closed = buffer->closed.load(std::memory_order_acquire);
+        std::size_t room = std::min(limit, frame.size());
+        if (held < room)
+            held += buffer->queue.pop_n(frame.data() + held, room - held);
+        skip_partial_character(frame.data(), held);
+        available = std::min(limit, held);
+        at_end = closed && buffer->queue.is_empty() && available == held;
+        return frame.data();
+    }
+
+    /**
+     * @brief Drops the bytes shown from the front of the input.
+     * @param bytes The number of bytes.
+     */
+    void consume(std::size_t bytes)
+    {
+        if (!buffer)
+        {
+            position += bytes;
+            return;
+        }
+        std::memmove(frame.data(), frame.data() + bytes, held - bytes);
+        held -= bytes;
+    }
+
+    /**
+     * @brief Waits for the reader to stop.
+     * @return The errno of a failed read, 0 if the input was read to the end.
+     */
+    int finish()
+    {
+        if (reader.joinable())
+            reader.join();
+        return read_error;
+    }
+
+private:
+    std::string path; /**< The path of the input, "-" for the standard input. */
+    int fd = -1; /**< The input. */
+    char *map = nullptr; /**< The mapping of a regular file, from a page boundary. */
+    std::size_t map_size = 0; /**< The size of the mapping. */
+    std::size_t position = 0; /**< Offset in the mapping of the first byte not shown. */
+    std::size_t advised = 0; /**< Offset in the mapping up to which paging in was asked for. */
+    bool skip_continuation = false; /**< Whether the input starts mid-file, maybe inside a character. */
+    std::unique_ptr<SlideBuffer> buffer; /**< The bytes of a stream read ahead, nullptr for a mapped file. */
+    std::vector<char> frame; /**< The bytes of a stream taken from the buffer and not shown yet. */
+    std::size_t held = 0; /**< Number of bytes in frame. */
+    std::thread reader; /**< The thread reading a stream. */
+    int read_error = 0; /**< The errno of a failed read, written by the reader before it stops. */
+
+    /**
+     * @brief Drops the continuation bytes of a character cut by the start offset.
+     * @param data The first bytes not shown.
+     * @param size The number of bytes.
+     */
+    void skip_partial_character(const char *data, std::size_t size)
+    {
+        std::size_t skipped = 0;
+        while (skip_continuation && skipped < size && skipped < 3 && (data[skipped] & 0xC0) == 0x80)
+        {
+            skipped++;
+        }
+        if (skipped < size)
+            skip_continuation = false;
+        consume(skipped);
+    }
+
+    /**
+     * @brief Reads a stream into the buffer until its end, an error or the renderer stops.
+     * @param skip The number of bytes dropped at the start.
+     */
+    void read_stream(uint64_t skip)
+    {
+        std::vector<char> chunk(SLIDE_READ);
+        while (!buffer->cancelled.load(std::memory_order_relaxed))
+        {
+            ssize_t got = read(fd, chunk.data(), chunk.size());
+            count_call(CALL_READ);
+            if (got < 0 && errno == EINTR)
+                continue;
+            if (got <= 0)
+            {
+                if (got < 0)
+                    read_error = errno;
+                break;
+            }
+
+            std::size_t dropped = static_cast<std::size_t>(std::min<uint64_t>(skip, static_cast<uint64_t>(got)));
+            skip -= dropped;
+            buffer->put(chunk.data() + dropped, static_cast<std::size_t>(got) - dropped);
+        }
+        buffer->closed.store(true, std::memory_order_release);
+    }
+};
+
+/**
+ * @brief Measures the first whole UTF-8 characters of some bytes.
+ *
+ * A character is a lead byte and the continuation bytes it announces; any
+ * other byte counts as a character of its own, so invalid text is still shown.
+ *
+ * @param data The bytes.
+ * @param size The number of bytes.
+ * @param wanted The largest number of characters.
+ * @param at_end Whether no bytes follow, so a character cut by the end is taken as it is.
+ * @param chars Set to the number of characters.
+ * @return The number of bytes of the characters.
+ */
+static std::size_t utf8_prefix(const char *data, std::size_t size, std::size_t wanted, bool at_end, std::size_t &chars)
+{
+    std::size_t bytes = 0;
+    chars = 0;
+    while (chars < wanted && bytes < size)
+    {
+        unsigned char lead = static_cast<unsigned char>(data[bytes]);
+        std::size_t length = lead < 0xC0 ? 1 : lead < 0xE0 ? 2 : lead < 0xF0 ? 3 : lead < 0xF8 ? 4 : 1;
+        std::size_t end = bytes + 1;
+        while (end < bytes + length && end < size && (data[end] & 0xC0) == 0x80)
+        {
+            end++;
+        }
+        if (end < bytes + length && end == size && !at_end)
+            break; // The rest of the character is not there yet
+        bytes = end;
+        chars++;
+    }
+    return bytes;
+}
 
 /**
  * @brief Print content from a file with sliding animation.
  *
- * This function reads the content from the specified file and prints it line by line
- * with a sliding effect controlled by the slide speed parameter.
+ * Regular files are mapped and written from the mapping, paged in ahead of
+ * the display; pipes, terminals and the standard input are read in large
+ * chunks by a thread into a buffer ahead of the display, so a slow input does
+ * not stall it. The display is paced by deadlines on a monotonic clock: every
+ * frame writes all the characters due by then in one write and sleeps until
+ * the next one is due, at most 60 frames a second. Characters are UTF-8, a
+ * multibyte one is written whole. The average rate stays exact at any speed,
+ * and the time lost to writes and wake-ups is not added up character after
+ * character. When the input falls behind, pacing restarts from the characters
+ * shown instead of catching up in a burst.
  *
- * @param file_path The path to the file containing the content to be printed.
- * @param slide_speed The speed of the sliding animation, in seconds per line.
+ * @param file_path The path to the file containing the content to be printed, "-" for the standard input.
+ * @param slide_speed The speed of the sliding animation, 1.0 being one character per 20ms.
+ * @param from_offset The number of bytes skipped at the start, without reading them when the input can seek.
+ * @return true on success, false with a message on the error stream if the file cannot be opened or read.
  */
-void print_content_with_slide(const std::string &file_path, float slide_speed)
+bool print_content_with_slide(const std::string &file_path, float slide_speed, uint64_t from_offset)
 {
-    std::ifstream file(file_path);
-    if (!file.is_open())
+    SlideInput input;
+    if (input.open(file_path, from_offset) != 0)
     {
         std::cerr << "Error opening file: " << file_path << std::endl;
-        exit(OPEN_FAILURE);
+        return false;
     }
 
-    char character;
-    Queue<char> queue;
+    using Clock = std::chrono::steady_clock;
+    const double rate = SLIDE_RATE * slide_speed;
+    Output &sink = out();
+    uint64_t shown = 0;
+    Clock::time_point start = Clock::now();
+
+    // Character n is due n / rate seconds after start
+    auto due_at = [&start, rate](uint64_t n)
+    {
+        return start + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(n / rate));
+    };
 
-    while (file.get(character))
+    while (input.more())
     {
-        if (queue.is_full())
+        Clock::time_point now = Clock::now();
+        uint64_t due = static_cast<uint64_t>(std::chrono::duration<double>(now - start).count() * rate) + 1;
+        std::size_t wanted = static_cast<std::size_t>(std::min<uint64_t>(due - std::min(due, shown), SLIDE_MAX_CHARS));
+
+        // Everything due that the input has, flushed as one frame; a UTF-8 character is 4 bytes at most
+        std::size_t request = std::max<std::size_t>(wanted, 1);
+        std::size_t frame_chars = 0;
+        while (frame_chars < request)
         {
-            while (!queue.is_empty())
-            {
-                std::cout << queue.dequeue();
-                std::cout.flush();
-                std::this_thread::sleep_for(std::chrono::milliseconds(static_cast<int>(20 / slide_speed)));
-            }
+            std::size_t available;
+            bool at_end;
+            const char *data = input.peek((request - frame_chars) * 4, available, at_end);
+            std::size_t chars;
+            std::size_t bytes = utf8_prefix(data, available, request - frame_chars, at_end, chars);
+            if (bytes == 0)
+                break;
+            sink.write(data, bytes);
+            input.consume(bytes);
+            frame_chars += chars;
         }
-        queue.enqueue(character);
+        sink.flush();
+        shown += frame_chars;
+
+        // The input fell behind: continue from here rather than burst once it catches up,
+        // and take what comes next as soon as it is there
+        if (frame_chars < wanted)
+        {
+            start = now - (due_at(shown) - start);
+            if (frame_chars == 0)
+                std::this_thread::sleep_for(SLIDE_POLL); // Only part of a character came
+            continue;
+        }
+
+        Clock::time_point next = std::max(due_at(shown), now + SLIDE_FRAME);
+        std::this_thread::sleep_until(next);
     }
 
-    // Flush remaining characters in the queue
-    while (!queue.is_empty())
+    if (int error = input.finish())
     {
-        std::cout << queue.dequeue();
-        std::cout.flush();
-        std::this_thread::sleep_for(std::chrono::milliseconds(static_cast<int>(20 / slide_speed)));
+        std::cerr << "Error: cannot read file '" << file_path << "': " << std::strerror(error) << std::endl;
+        return false;
     }
-    std::cout << std::endl;
+    sink << '\n';
+    sink.flush();
+    return true;
 }
@@ -2,7 +2,7 @@
  ******************************************************************************
  * @file    mySort.cpp
  * @brief   Implementation of functions for sorting files and directories based on specified criteria.
- *          Includes functions for case-insensitive string comparison and sorting files in a directory.
+ *          Includes functions for sorting files in a directory.
  *          Sorting can be done based on various criteria such as file name, size, or modification time.
  * @author  Arun, Sagar, Saurav
  * @date    March 7, 2024
@@ -10,31 +10,16 @@
  */
 
 #include "mySort.hpp"
+#include "myCollate.hpp"
 #include "myColors.hpp"
+#include "myIterator.hpp"
+#include "myOutput.hpp"
+#include "myStats.hpp"
 #include "myTypeDef.h"
 #include <string>
 #include <algorithm>
-#include <dirent.h>
-#include <sys/stat.h>
-#include <iostream>
-#include <iomanip>
-#include <unistd.h>
-#include <sys/ioctl.h>
-
-/**
- * @brief Case-insensitive comparison of two strings.
- *
- * This function performs a case-insensitive comparison of two strings.
- *
- * @param a The first string.
- * @param b The second string.
- * @return true if strings are equal (case-insensitive), false otherwise.
- */
-bool caseInsensitiveCompare(const std::string &a, const std::string &b)
-{
-    return std::lexicographical_compare(a.begin(), a.end(), b.begin(), b.end(), [](char c1, char c2)
-                                        { return std::tolower(c1) < std::tolower(c2); });
-}
+#include <cstdio>
+#include <ctime>
 
 /**
  * @brief Format size in human-readable format.
@@ -53,87 +38,169 @@ std::string format_size(double size)
         size /= 1024;
         suffix_index++;
     }
-    std::stringstream ss;
-    ss << std::fixed << std::setprecision(2) << size << " " << suffixes[suffix_index];
-    return ss.str();
+    char text[32];
+    std::snprintf(text, sizeof(text), "%.2f %s", size, suffixes[suffix_index]);
+    return text;
 }
 
 /**
- * @brief Merge two sorted subarrays into one sorted array.
- *
- * This function merges two sorted subarrays into one sorted array.
- *
- * @param arr The array to be merged.
- * @param l The left index of the subarray.
- * @param m The middle index of the subarray.
- * @param r The right index of the subarray.
- * @param comparator The function used for comparison.
+ * @brief Sort key indices with the comparator specialised for one criterion.
+ * @tparam Type The sort criterion.
+ * @param order The indices to sort.
+ * @param n The number of indices.
+ * @param scratch A buffer of at least @p n indices.
+ * @param keys The key records.
+ * @param names The name sort keys.
+ * @param sort_order The sort order.
  */
-void merge(std::vector<std::string> &arr, int l, int m, int r, std::function<bool(const std::string &, const std::string &)> comparator)
+template <SortTypeDef Type>
+static void sort_keys(uint32_t *order, std::size_t n, uint32_t *scratch, const SortKey *keys, const char *names, SortOrderDef sort_order)
 {
-    int n1 = m - l + 1;
-    int n2 = r - m;
+    if (sort_order == ASC)
+        mergeSort(order, n, scratch, SortKeyLess<Type, ASC>{keys, names});
+    else
+        mergeSort(order, n, scratch, SortKeyLess<Type, DESC>{keys, names});
+}
 
-    std::vector<std::string> L(n1), R(n2);
+/**
+ * @brief Comparison-sort key indices by any criterion.
+ * @param order The indices to sort.
+ * @param n The number of indices.
+ * @param scratch A buffer of at least @p n indices.
+ * @param keys The key records.
+ * @param names The name sort keys.
+ * @param sort_type The sort criterion.
+ * @param sort_order The sort order.
+ */
+static void sort_indices(uint32_t *order, std::size_t n, uint32_t *scratch, const SortKey *keys, const char *names, SortTypeDef sort_type, SortOrderDef sort_order)
+{
+    switch (sort_type)
+    {
+    case SORT_SIZE:
+        sort_keys<SORT_SIZE>(order, n, scratch, keys, names, sort_order);
+        break;
+    case SORT_TIME:
+        sort_keys<SORT_TIME>(order, n, scratch, keys, names, sort_order);
+        break;
+    default:
+        sort_keys<SORT_NAME>(order, n, scratch, keys, names, sort_order);
+        break;
+    }
+}
 
-    for (int i = 0; i < n1; i++)
-        L[i] = arr[l + i];
-    for (int j = 0; j < n2; j++)
-        R[j] = arr[m + 1 + j];
+/**
+ * @brief Packs the first 8 bytes of a name into an integer that orders like memcmp.
+ * @param name The name sort key.
+ * @param length The length of the key.
+ * @return The big-endian name prefix, zero padded.
+ */
+static uint64_t name_prefix(const char *name, uint32_t length)
+{
+    uint64_t prefix = 0;
+    for (uint32_t i = 0; i < 8; ++i)
+    {
+        prefix = (prefix << 8) | (i < length ? static_cast<uint8_t>(name[i]) : 0);
+    }
+    return prefix;
+}
 
-    int i = 0;
-    int j = 0;
-    int k = l;
+/**
+ * @brief Radix-sort key indices by size or time, with the name as tiebreak.
+ *
+ * The key and the name prefix are packed into one wide key, inverted for DESC.
+ * Runs whose wide keys are still equal (names sharing the first 8 bytes) are
+ * finished by the comparison sort, so the result matches sort_indices() exactly.
+ *
+ * @param order The indices to sort.
+ * @param scratch A buffer as long as @p order.
+ * @param keys The key records.
+ * @param names The name sort keys.
+ * @param sort_type SORT_SIZE or SORT_TIME.
+ * @param sort_order The sort order.
+ */
+static void radix_sort_indices(std::vector<uint32_t> &order, std::vector<uint32_t> &scratch, const std::vector<SortKey> &keys, const char *names, SortTypeDef sort_type, SortOrderDef sort_order)
+{
+    std::size_t count = keys.size();
+    std::vector<RadixRecord<WideKey>> records(count);
+    std::vector<RadixRecord<WideKey>> buffer(count);
 
-    while (i < n1 && j < n2)
+    for (std::size_t index = 0; index < count; ++index)
     {
-        if (comparator(L[i], R[j]))
-        {
-            arr[k] = L[i];
-            i++;
-        }
-        else
-        {
-            arr[k] = R[j];
-            j++;
-        }
-        k++;
+        const SortKey &key = keys[index];
+        // Flipping the sign bit makes signed times order correctly as unsigned
+        uint64_t primary = sort_type == SORT_SIZE ? key.size : static_cast<uint64_t>(key.mtime_ns) ^ (1ull << 63);
+        WideKey wide = pack_key(primary, name_prefix(names + key.name_offset, key.name_length));
+        records[index] = {sort_order == DESC ? ~wide : wide, static_cast<uint32_t>(index)};
     }
 
-    while (i < n1)
+    radixSort(records.data(), buffer.data(), count);
+
+    for (std::size_t index = 0; index < count; ++index)
     {
-        arr[k] = L[i];
-        i++;
-        k++;
+        order[index] = records[index].index;
     }
 
-    while (j < n2)
+    for (std::size_t start = 0, end; start < count; start = end)
     {
-        arr[k] = R[j];
-        j++;
-        k++;
+        end = start + 1;
+        while (end < count && records[end].key == records[start].key)
+        {
+            ++end;
+        }
+        if (end - start > 1)
+            sort_indices(order.data() + start, end - start, scratch.data(), keys.data(), names, sort_type, sort_order);
     }
 }
 
 /**
- * @brief Implementation of merge sort algorithm.
+ * @brief Sort stat-ed directory entries based on specified criteria.
  *
- * This function recursively sorts the array using the merge sort algorithm.
+ * Every entry is packed into a key record (decorate), the record indices are
+ * sorted (sort), and the entries are moved into that order (undecorate). Sizes
+ * and times of large directories are radix-sorted on a (key, name prefix) composite.
  *
- * @param arr The array to be sorted.
- * @param l The left index of the array.
- * @param r The right index of the array.
- * @param comparator The function used for comparison.
+ * @param entries The entries, already stat-ed with links followed.
+ * @param sort_type The type of sorting criteria (e.g., name, size, modification time).
+ * @param sort_order The order in which files should be sorted (ascending or descending).
+ * @return The sorted entries.
  */
-void mergeSort(std::vector<std::string> &arr, int l, int r, std::function<bool(const std::string &, const std::string &)> comparator)
+std::vector<EntryInfo> sort_entries(std::vector<EntryInfo> entries, const SortTypeDef &sort_type, const SortOrderDef &sort_order)
 {
-    if (l < r)
+    PhaseTimer timer(PHASE_SORT);
+    std::size_t count = entries.size();
+
+    // Decorate: name sort keys packed into a single buffer
+    std::vector<SortKey> keys(count);
+    std::string names;
+    for (std::size_t index = 0; index < count; ++index)
+    {
+        const EntryInfo &entry = entries[index];
+        std::size_t offset = names.size();
+        append_name_key(names, entry.name);
+        keys[index] = {entry.size, entry.mtime_ns, static_cast<uint32_t>(offset), static_cast<uint32_t>(names.size() - offset)};
+    }
+
+    std::vector<uint32_t> order(count);
+    std::vector<uint32_t> scratch(count);
+    for (std::size_t index = 0; index < count; ++index)
+    {
+        order[index] = static_cast<uint32_t>(index);
+    }
+
+    // Fixed-width keys of big directories go through the radix sort, names always compare
+    if (sort_type != SORT_NAME && count >= RADIX_SORT_THRESHOLD)
+        radix_sort_indices(order, scratch, keys, names.data(), sort_type, sort_order);
+    else
+        sort_indices(order.data(), count, scratch.data(), keys.data(), names.data(), sort_type, sort_order);
+
+    // Undecorate
+    std::vector<EntryInfo> files;
+    files.reserve(count);
+    for (uint32_t index : order)
     {
-        int m = l + (r - l) / 2;
-        mergeSort(arr, l, m, comparator);
-        mergeSort(arr, m + 1, r, comparator);
-        merge(arr, l, m, r, comparator);
+        files.push_back(std::move(entries[index]));
     }
+    return files;
 }
 
 /**
@@ -141,58 +208,34 @@ void mergeSort(std::vector<std::string> &arr, int l, int r, std::function<bool(c
  *
  * This function sorts the files in the specified directory based on the provided sort type
  * (e.g., name, size, modification time) and sort order (ascending or descending).
+ * Every entry is listed and stat-ed by an EntryIterator, one level deep, then sorted by sort_entries().
  *
  * @param directory The path to the directory containing the files to be sorted.
  * @param sort_type The type of sorting criteria (e.g., name, size, modification time).
  * @param sort_order The order in which files should be sorted (ascending or descending).
- * @return A vector of sorted file names.
+ * @param filter Optional --exclude/--include/--gitignore filter, applied before stat-ing.
+ * @param error Optional, set to the errno of opening @p directory, 0 on success.
+ * @return A vector of sorted entries with their metadata, empty if @p directory cannot be read.
  */
-std::vector<std::string> sort_files(const std::string &directory, const SortTypeDef &sort_type, const SortOrderDef &sort_order)
+std::vector<EntryInfo> sort_files(const std::string &directory, const SortTypeDef &sort_type, const SortOrderDef &sort_order, const PathFilter *filter, int *error)
 {
-    std::vector<std::string> files;
+    ScanOptions options;
+    options.show_hidden = true; // Hidden entries are left out when printed
+    options.max_depth = 1;
+    options.filter = filter;
+    IteratorOptions iteration;
+    iteration.sorted = false;
+    iteration.stat = ITER_STAT_ALL;
 
-    DIR *dir;
-    struct dirent *entry;
-    if ((dir = opendir(directory.c_str())) != NULL)
+    std::vector<EntryInfo> entries;
+    EntryIterator it(directory, options, iteration);
+    if (error)
+        *error = it.error();
+    while (it.next())
     {
-        while ((entry = readdir(dir)) != NULL)
-        {
-            std::string filename = entry->d_name;
-            if (filename == "." || filename == "..")
-                continue; // Skip current and parent directory entries
-            files.push_back(filename);
-        }
-        closedir(dir);
+        entries.push_back(std::move(it.entry()));
     }
-
-    auto comparator = [&](const std::string &a, const std::string &b)
-    {
-        std::string path_a = directory + "/" + a;
-        std::string path_b = directory + "/" + b;
-        struct stat stat_a, stat_b;
-        stat(path_a.c_str(), &stat_a);
-        stat(path_b.c_str(), &stat_b);
-
-        if (sort_type == SORT_TIME)
-        {
-            return sort_order == ASC ? stat_a.st_mtime < stat_b.st_mtime : stat_a.st_mtime > stat_b.st_mtime;
-        }
-        else if (sort_type == SORT_SIZE)
-        {
-            return sort_order == ASC ? stat_a.st_size < stat_b.st_size : stat_a.st_size > stat_b.st_size;
-        }
-        else
-        {
-            return sort_order == ASC ? caseInsensitiveCompare(a, b) : caseInsensitiveCompare(b, a);
-        }
-    };
-
-    mergeSort(files, 0, files.size() - 1, comparator); // Use custom merge sort here
-
-    if (sort_order == DESC)
-        std::reverse(files.begin(), files.end()); // Reverse the sorted order if DESC
-
-    return files;
+    return sort_entries(std::move(entries), sort_type, sort_order);
 }
 
 /**
@@ -206,72 +249,63 @@ std::vector<std::string> sort_files(const std::string &directory, const SortType
  * @param order The order in which files should be sorted (ascending or descending).
  * @param path The path to the directory containing the files to be sorted.
  * @param show_hidden Whether to include hidden files in the sorting.
+ * @param filter Optional --exclude/--include/--gitignore filter.
  */
-void sort(const SortTypeDef &sort_type, const SortOrderDef &order, const std::string &path, bool show_hidden)
+void sort(const SortTypeDef &sort_type, const SortOrderDef &order, const std::string &path, bool show_hidden, const PathFilter *filter)
 {
     // Sort the files based on the specified criteria
-    std::vector<std::string> sorted_files = sort_files(path, sort_type, order);
+    print_sorted(sort_files(path, sort_type, order, filter), sort_type, show_hidden);
+}
 
-    // Reverse the order if DESC is specified
-    if (order == DESC)
-        std::reverse(sorted_files.begin(), sorted_files.end());
+/**
+ * @brief Display sorted files with the detail of the sort criterion.
+ * @param sorted_files The sorted entries.
+ * @param sort_type The sort criterion, which selects the detail column.
+ * @param show_hidden Whether to include hidden files.
+ */
+void print_sorted(const std::vector<EntryInfo> &sorted_files, const SortTypeDef &sort_type, bool show_hidden)
+{
+    Output &sink = out();
 
     // Get maximum file name length
     size_t max_filename_length = 0;
-    for (const std::string &file : sorted_files)
+    for (const EntryInfo &file : sorted_files)
     {
-        max_filename_length = std::max(max_filename_length, file.size());
+        max_filename_length = std::max(max_filename_length, file.name.size());
     }
 
     // Iterate through the sorted files and print details for each file
-    for (const std::string &file : sorted_files)
+    for (const EntryInfo &file : sorted_files)
     {
-        std::string color;
-        if (file[0] == '.')
+        if (file.name[0] == '.' && !show_hidden)
         {
-            if (show_hidden)
-            {
-                color = get_file_color(path + "/" + file, false);
-            }
-            else
-            {
-                continue; // Skip hidden files if not showing hidden
-            }
-        }
-        else
-        {
-            color = get_file_color(path + "/" + file, false);
+            continue; // Skip hidden files if not showing hidden
         }
 
         // Print file name with color
-        print_colored_text(file, color);
-        std::cout << std::setw(max_filename_length + 4 - file.size()) << std::left << "";
+        print_colored_text(file.name, get_file_color(file, false));
+        sink.pad(max_filename_length + 4 - file.name.size());
 
         // Print file details based on sort type
         if (sort_type == SORT_TIME)
         {
-            struct stat stat_buf;
-            stat((path + "/" + file).c_str(), &stat_buf);
-
             // Convert timestamp to human-readable date format
+            time_t mtime = static_cast<time_t>(file.mtime_ns / 1000000000);
             char time_str[20];
-            strftime(time_str, sizeof(time_str), "%Y-%m-%d %H:%M:%S", localtime(&stat_buf.st_mtime));
+            strftime(time_str, sizeof(time_str), "%Y-%m-%d %H:%M:%S", localtime(&mtime));
 
             // Print file details
-            std::cout << time_str;
+            sink << time_str;
         }
         else if (sort_type == SORT_SIZE)
         {
-            struct stat stat_buf;
-            stat((path + "/" + file).c_str(), &stat_buf);
-            double size = stat_buf.st_size;
-
             // Convert size to human-readable format
-            std::string size_str = format_size(size);
+            std::string size_str = format_size(static_cast<double>(file.size));
 
             // Print file details
-            std::cout << size_str;
+            sink << size_str;
         }
-        std::cout << std::endl;
+        sink << '\n';
     }
+    sink.flush();
 }
@@ -0,0 +1,258 @@
+/**
+ ******************************************************************************
+ * @file    myStats.cpp
+ * @brief   Implementation of the scan counters and the per-thread phase timers
+ *          reported by the --stats option.
+ * @author  Arun, Sagar, Saurav
+ * @date    March 7, 2024
+ ******************************************************************************
+ */
+
+#include "myStats.hpp"
+#include "myBatch.hpp"
+#include "myOutput.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <new>
+#include <string>
+#include <sys/resource.h>
+
+ScanStats scan_stats;
+bool stats_enabled = false;
+bool allocations_counted = false;
+static bool allocations_hooked = false; /**< Whether the executable replaced operator new with the counting one. */
+
+static uint64_t stats_start = 0; /**< When enable_stats() was called. */
+static std::atomic<ThreadStats *> registry{nullptr}; /**< The counters of all the threads, live or gone. */
+static thread_local ThreadStats *current_stats = nullptr; /**< The counters of the calling thread. */
+thread_local PhaseTimer *PhaseTimer::active = nullptr;
+
+static const char *phase_names[PHASE_COUNT] = {"readdir", "stat", "filter", "sort", "color", "output", "hash"};
+static const char *call_names[CALL_COUNT] = {"opendir", "stat", "statx", "io_uring_enter", "open", "read", "write"};
+
+/**
+ * @brief Hands the counters of an exiting thread over to the next thread that needs some.
+ */
+struct StatsOwner
+{
+    ThreadStats *stats = nullptr; /**< The counters owned. */
+
+    ~StatsOwner()
+    {
+        if (stats)
+            stats->in_use.store(false, std::memory_order_release);
+    }
+};
+
+/**
+ * @brief Turns the per-thread counters on and starts the wall clock.
+ */
+void enable_stats()
+{
+    stats_start = stats_clock();
+    stats_enabled = true;
+    allocations_counted = allocations_hooked;
+}
+
+/**
+ * @brief Counts heap allocations only, leaving the phase timers off.
+ */
+void count_allocations()
+{
+    allocations_counted = allocations_hooked;
+}
+
+/**
+ * @brief Tells the counters that operator new reports to count_allocation().
+ *
+ * Called before main() by myAllocator.cpp, which only the difo and
+ * difo_bench executables link, so the library never replaces the allocator
+ * of its host.
+ */
+void install_allocation_hook()
+{
+    allocations_hooked = true;
+}
+
+/**
+ * @brief Counts one heap allocation of the calling thread.
+ */
+void count_allocation()
+{
+    add_stat(thread_stats().allocations, 1);
+}
+
+/**
+ * @brief Gets the counters of the calling thread.
+ *
+ * Counters are never freed, so reading them after their thread exited is
+ * safe, and they are reused, so the registry is as long as the largest number
+ * of threads alive at once. Allocated with aligned_alloc, not operator new,
+ * which may count through this function.
+ *
+ * @return The counters.
+ */
+ThreadStats &thread_stats()
+{
+    if (current_stats)
+        return *current_stats;
+
+    ThreadStats *stats = nullptr;
+    for (ThreadStats *free = registry.load(std::memory_order_acquire); free && !stats; free = free->next)
+    {
+        bool in_use = false;
+        if (!free->in_use.load(std::memory_order_relaxed) && free->in_use.compare_exchange_strong(in_use, true, std::memory_order_acquire))
+            stats = free;
+    }
+    if (!stats)
+    {
+        void *memory = std::aligned_alloc(alignof(ThreadStats), sizeof(ThreadStats));
+        if (!memory)
+            std::abort();
+        stats = new (memory) ThreadStats();
+        stats->in_use.store(true, std::memory_order_relaxed);
+        stats->next = registry.load(std::memory_order_relaxed);
+        while (!registry.compare_exchange_weak(stats->next, stats, std::memory_order_release, std::memory_order_relaxed))
+        {
+        }
+    }
+
+    thread_local StatsOwner owner;
+    owner.stats = stats;
+    current_stats = stats;
+    return *stats;
+}
+
+/**
+ * @brief The counters of all the threads, summed.
+ */
+struct StatsTotals
+{
+    uint64_t phase_ns[PHASE_COUNT] = {}; /**< Time spent in every phase. */
+    uint64_t calls[CALL_COUNT] = {}; /**< Number of every system call. */
+    uint64_t allocations = 0; /**< Calls to operator new. */
+};
+
+/**
+ * @brief Sums the counters of all the threads.
+ * @return The sums.
+ */
+static StatsTotals sum_stats()
+{
+    StatsTotals totals;
+    for (ThreadStats *stats = registry.load(std::memory_order_acquire); stats; stats = stats->next)
+    {
+        for (int phase = 0; phase < PHASE_COUNT; ++phase)
+        {
+            totals.phase_ns[phase] += stats->phase_ns[phase].load(std::memory_order_relaxed);
+        }
+        for (int call = 0; call < CALL_COUNT; ++call)
+        {
+            totals.calls[call] += stats->calls[call].load(std::memory_order_relaxed);
+        }
+        totals.allocations += stats->allocations.load(std::memory_order_relaxed);
+    }
+    return totals;
+}
+
+/**
+ * @brief Gets the number of heap allocations counted so far, summed over all threads.
+ * @return The number of calls to operator new.
+ */
+uint64_t total_allocations()
+{
+    return sum_stats().allocations;
+}
+
+/**
+ * @brief Formats nanoseconds as milliseconds.
+ * @param ns The nanoseconds.
+ * @return The milliseconds, three decimals.
+ */
+static std::string milliseconds(uint64_t ns)
+{
+    char text[32];
+    std::snprintf(text, sizeof(text), "%.3f ms", static_cast<double>(ns) / 1e6);
+    return text;
+}
+
+/**
+ * @brief Print the counters to the error stream.
+ * @param json Whether to print one JSON object instead of text.
+ */
+void print_stats(bool json)
+{
+    StatsTotals totals = sum_stats();
+    uint64_t wall_ns = stats_enabled ? stats_clock() - stats_start : 0;
+    uint64_t entries = scan_stats.entries;
+    uint64_t stat_calls = scan_stats.stat_calls;
+    rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    uint64_t peak_rss = static_cast<uint64_t>(usage.ru_maxrss) * 1024;
+
+    if (json)
+    {
+        std::string text = "{\"wall_ns\":" + std::to_string(wall_ns) + ",\"phases_ns\":{";
+        for (int phase = 0; phase < PHASE_COUNT; ++phase)
+        {
+            text += (phase ? ",\"" : "\"") + std::string(phase_names[phase]) + "\":" + std::to_string(totals.phase_ns[phase]);
+        }
+        text += "},\"syscalls\":{";
+        for (int call = 0; call < CALL_COUNT; ++call)
+        {
+            text += (call ? ",\"" : "\"") + std::string(call_names[call]) + "\":" + std::to_string(totals.calls[call]);
+        }
+        text += "},\"directories\":" + std::to_string(scan_stats.directories) +
+                ",\"entries\":" + std::to_string(entries) +
+                ",\"stat_calls\":" + std::to_string(stat_calls) +
+                ",\"stat_batches\":" + std::to_string(scan_stats.stat_batches) +
+                ",\"stat_backend\":\"" + batch_stat_backend() + "\"" +
+                ",\"bytes_hashed\":" + std::to_string(scan_stats.bytes_hashed) +
+                ",\"bytes_compared\":" + std::to_string(scan_stats.bytes_compared) +
+                ",\"bytes_written\":" + std::to_string(out().bytes_written()) +
+                ",\"allocations\":" + std::to_string(totals.allocations) +
+                ",\"peak_rss_bytes\":" + std::to_string(peak_rss) + "}";
+        std::cerr << text << std::endl;
+        return;
+    }
+
+    std::cerr << "wall time:        " << milliseconds(wall_ns) << std::endl;
+    std::cerr << "phase times (all threads):" << std::endl;
+    for (int phase = 0; phase < PHASE_COUNT; ++phase)
+    {
+        std::string name = phase_names[phase];
+        std::cerr << "  " << name << std::string(16 - name.size(), ' ') << milliseconds(totals.phase_ns[phase]) << std::endl;
+    }
+    std::cerr << "system calls:" << std::endl;
+    for (int call = 0; call < CALL_COUNT; ++call)
+    {
+        std::string name = call_names[call];
+        std::cerr << "  " << name << std::string(16 - name.size(), ' ') << totals.calls[call] << std::endl;
+    }
+
+    std::cerr << "directories read: " << scan_stats.directories << std::endl;
+    std::cerr << "entries read:     " << entries << std::endl;
+    std::cerr << "stat calls:       " << stat_calls;
+    if (entries > 0)
+    {
+        std::cerr << " (" << static_cast<double>(stat_calls) / entries << " per entry)";
+    }
+    std::cerr << std::endl;
+    if (scan_stats.stat_batches > 0)
+    {
+        std::cerr << "stat batches:     " << scan_stats.stat_batches << " (" << batch_stat_backend() << ")" << std::endl;
+    }
+    if (scan_stats.bytes_hashed > 0)
+    {
+        std::cerr << "bytes hashed:     " << scan_stats.bytes_hashed << std::endl;
+    }
+    if (scan_stats.bytes_compared > 0)
+    {
+        std::cerr << "bytes compared:   " << scan_stats.bytes_compared << std::endl;
+    }
+    std::cerr << "bytes written:    " << out().bytes_written() << std::endl;
+    std::cerr << "heap allocations: " << totals.allocations << std::endl;
+    std::cerr << "peak RSS:         " << peak_rss / 1024 << " KiB" << std::endl;
+}
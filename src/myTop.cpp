@@ -0,0 +1,293 @@
+/**
+ ******************************************************************************
+ * @file    myTop.cpp
+ * @brief   Implementation of the top-N view.
+ * @author  Arun, Sagar, Saurav
+ * @date    March 7, 2024
+ ******************************************************************************
+ */
+
+#include "myTop.hpp"
+#include "myColors.hpp"
+#include "myEntry.hpp"
+#include "myFilter.hpp"
+#include "myOutput.hpp"
+#include "mySort.hpp"
+#include <algorithm>
+#include <atomic>
+#include <iostream>
+#include <iterator>
+#include <memory>
+#include <sys/stat.h>
+
+/**
+ * @brief Min-heap order: the smallest item, or the last path of equal sizes, at the root.
+ */
+static bool larger(const TopItem &a, const TopItem &b)
+{
+    return a.size != b.size ? a.size > b.size : a.path < b.path;
+}
+
+/**
+ * @brief Offers an item, evicting the smallest one when full.
+ * @param size The size.
+ * @param path The path.
+ */
+void TopList::push(uint64_t size, std::string path)
+{
+    if (!wants(size))
+        return;
+    if (heap.size() == capacity)
+    {
+        std::pop_heap(heap.begin(), heap.end(), larger);
+        heap.pop_back();
+    }
+    heap.push_back({size, std::move(path)});
+    std::push_heap(heap.begin(), heap.end(), larger);
+}
+
+/**
+ * @brief Offers all the items of another list.
+ * @param other The list, emptied.
+ */
+void TopList::merge(TopList &other)
+{
+    for (TopItem &item : other.heap)
+    {
+        push(item.size, std::move(item.path));
+    }
+    other.heap.clear();
+}
+
+/**
+ * @brief Takes the items out, largest first.
+ * @return The items, ties ordered by path.
+ */
+std::vector<TopItem> TopList::sorted()
+{
+    std::vector<TopItem> items = std::move(heap);
+    heap.clear();
+    std::sort(items.begin(), items.end(), larger);
+    return items;
+}
+
+/**
+ * @brief A directory whose subtree is still being summed.
+ *
+ * It lives until its own listing and all its subdirectories are done, then
+ * hands its total to its parent and is freed.
+ */
+struct TopDirectory
+{
+    std::string path; /**< The full path. */
+    TopDirectory *parent; /**< The parent directory, nullptr for the root. */
+    std::atomic<uint64_t> size; /**< The sum so far: own size, files, finished subdirectories. */
+    std::atomic<std::size_t> pending; /**< Unfinished work: the listing plus every unfinished subdirectory. */
+    std::atomic<bool> has_links; /**< Whether files with several hard links were met below, held back until the walk ends. */
+    bool listed; /**< Whether the directory is shown (not hidden, or show_hidden). */
+    std::shared_ptr<const FilterScope> scope; /**< The filter scope of the parent directory. */
+
+    TopDirectory(std::string path, TopDirectory *parent, uint64_t size, bool listed, std::shared_ptr<const FilterScope> scope)
+        : path(std::move(path)), parent(parent), size(size), pending(1), has_links(false), listed(listed), scope(std::move(scope)) {}
+};
+
+/**
+ * @brief A file with several hard links, counted once its owner is known.
+ */
+struct TopLinkedFile
+{
+    uint64_t dev; /**< The device of the file. */
+    uint64_t ino; /**< The inode of the file. */
+    uint64_t size; /**< The size ranked. */
+    std::string path; /**< The path relative to the root; the first one by name owns the file. */
+    TopDirectory *directory; /**< The directory the link was met in. */
+    bool listed; /**< Whether the file is shown. */
+};
+
+/**
+ * @brief Prints one ranked list.
+ * @param title The title of the list.
+ * @param items The items, largest first.
+ * @param color The color of the paths.
+ */
+static void print_top_list(const std::string &title, const std::vector<TopItem> &items, std::string_view color)
+{
+    Output &sink = out();
+    print_colored_text(title, COLOR_TEXT);
+    sink << '\n';
+
+    std::size_t max_path_length = 0;
+    for (const TopItem &item : items)
+    {
+        max_path_length = std::max(max_path_length, item.path.size());
+    }
+    for (const TopItem &item : items)
+    {
+        print_colored_text(item.path, color);
+        sink.pad(max_path_length + 4 - item.path.size());
+        sink << format_size(static_cast<double>(item.size)) << '\n';
+    }
+}
+
+/**
+ * @brief Prints the N largest files and the N largest directories below a directory.
+ * @param path The path to the directory.
+ * @param count N, the number of files and of directories listed.
+ * @param options The scan options; without show_hidden, hidden entries are
+ *        counted in the sizes of their parents but not listed.
+ * @param apparent_size Whether to rank by apparent size instead of allocated size.
+ * @return true on success, false with a message on the error stream if @p path is not a directory.
+ */
+bool print_top(const std::string &path, std::size_t count, const ScanOptions &options, bool apparent_size)
+{
+    struct stat root_stat;
+    if (stat(path.c_str(), &root_stat) != 0 || !S_ISDIR(root_stat.st_mode))
+    {
+        std::cerr << "Error opening directory: " << path << std::endl;
+        return false;
+    }
+
+    Walker<TopDirectory *> walker(options.jobs);
+    std::vector<TopList> files(walker.jobs(), TopList(count));
+    std::vector<TopList> directories(walker.jobs(), TopList(count));
+    std::vector<std::vector<TopLinkedFile>> linked(walker.jobs());
+    std::vector<std::vector<TopDirectory *>> held(walker.jobs());
+    uint64_t total = 0;
+    std::atomic<uint64_t> file_count{0};
+    std::atomic<uint64_t> directory_count{0};
+
+    auto relative = [&path](const std::string &full)
+    {
+        std::size_t start = full.find_first_not_of('/', path.size());
+        return start == std::string::npos ? std::string() : full.substr(start);
+    };
+
+    // Hands the totals of finished directories up the tree, ranking them on the way;
+    // directories with hard links below are ranked after the walk, once the links are counted
+    auto finish = [&](unsigned worker, TopDirectory *directory)
+    {
+        while (directory && --directory->pending == 0)
+        {
+            TopDirectory *parent = directory->parent;
+            uint64_t size = directory->size;
+            if (parent)
+            {
+                parent->size += size;
+                if (directory->has_links)
+                    parent->has_links = true;
+                else if (directory->listed && directories[worker].wants(size))
+                    directories[worker].push(size, relative(directory->path) + "/");
+            }
+            else
+            {
+                total = size; // The root finishes last, on one thread
+            }
+            if (directory->has_links)
+                held[worker].push_back(directory);
+            else
+                delete directory;
+            directory = parent;
+        }
+    };
+
+    // The root's own blocks count too, like du
+    uint64_t root_size = apparent_size ? static_cast<uint64_t>(root_stat.st_size) : static_cast<uint64_t>(root_stat.st_blocks) * 512;
+    TopDirectory *root = new TopDirectory(path, nullptr, root_size, true, options.filter ? options.filter->root(path) : nullptr);
+    walker.run(root, [&](unsigned worker, TopDirectory *&task, std::vector<TopDirectory *> &subdirs)
+               {
+        TopDirectory *directory = task;
+        DirectoryReader reader(directory->path);
+        if (!reader.is_open())
+        {
+            std::cerr << "Error: " << directory_error(directory->path, reader.error()) << std::endl;
+            finish(worker, directory);
+            return;
+        }
+
+        std::shared_ptr<const FilterScope> scope = options.filter ? options.filter->apply(directory->scope, directory->path, reader) : nullptr;
+        reader.stat_all(false);
+
+        uint64_t own = 0;
+        uint64_t directories_seen = 0;
+        uint64_t files_seen = 0;
+        for (EntryInfo &entry : reader.entries)
+        {
+            if (!reader.stat(entry, false))
+                continue;
+
+            uint64_t size = apparent_size ? entry.size : entry.blocks * 512;
+            bool listed = directory->listed && (options.show_hidden || entry.name[0] != '.');
+            if (entry.type == ENTRY_DIRECTORY)
+            {
+                if (options.one_file_system && entry.dev != root_stat.st_dev)
+                    continue; // A mount point, neither counted nor entered
+                directory->pending++;
+                directories_seen++;
+                subdirs.push_back(new TopDirectory(directory->path + "/" + entry.name, directory, size, listed, scope));
+                continue;
+            }
+            if (entry.nlink > 1)
+            {
+                // Counted after the walk, so the owner does not depend on the thread that met it first
+                linked[worker].push_back({entry.dev, entry.ino, size, relative(directory->path + "/" + entry.name), directory, listed});
+                directory->has_links = true;
+                continue;
+            }
+
+            own += size;
+            files_seen++;
+            if (listed && files[worker].wants(size))
+                files[worker].push(size, relative(directory->path + "/" + entry.name));
+        }
+
+        directory->size += own;
+        directory_count += directories_seen;
+        file_count += files_seen;
+        finish(worker, directory); });
+
+    // Every file with several hard links is counted once, under its first path by name, like the size view
+    std::vector<TopLinkedFile> files_linked;
+    for (std::vector<TopLinkedFile> &list : linked)
+    {
+        std::move(list.begin(), list.end(), std::back_inserter(files_linked));
+    }
+    std::sort(files_linked.begin(), files_linked.end(), [](const TopLinkedFile &a, const TopLinkedFile &b)
+              { return a.dev != b.dev ? a.dev < b.dev : a.ino != b.ino ? a.ino < b.ino : a.path < b.path; });
+    for (std::size_t index = 0; index < files_linked.size(); ++index)
+    {
+        TopLinkedFile &file = files_linked[index];
+        if (index > 0 && files_linked[index - 1].dev == file.dev && files_linked[index - 1].ino == file.ino)
+            continue;
+        for (TopDirectory *directory = file.directory; directory; directory = directory->parent)
+        {
+            directory->size += file.size;
+        }
+        total += file.size;
+        file_count++;
+        if (file.listed)
+            files[0].push(file.size, std::move(file.path));
+    }
+    for (std::vector<TopDirectory *> &list : held)
+    {
+        for (TopDirectory *directory : list)
+        {
+            if (directory->parent && directory->listed)
+                directories[0].push(directory->size, relative(directory->path) + "/");
+            delete directory;
+        }
+    }
+
+    for (unsigned worker = 1; worker < walker.jobs(); ++worker)
+    {
+        files[0].merge(files[worker]);
+        directories[0].merge(directories[worker]);
+    }
+
+    print_top_list("Largest files:", files[0].sorted(), COLOR_FILE);
+    out() << '\n';
+    print_top_list("Largest directories:", directories[0].sorted(), COLOR_FOLDER);
+    out() << '\n'
+          << format_size(static_cast<double>(total)) << " in " << directory_count.load() << " directories, " << file_count.load() << " files\n";
+    out().flush();
+    return true;
+}
@@ -10,157 +10,425 @@
  */
 
 #include "myTree.hpp"
+#include "myCollate.hpp"
 #include "myColors.hpp"
+#include "myEntry.hpp"
+#include "myFilter.hpp"
+#include "myIterator.hpp"
+#include "myOutput.hpp"
+#include "myStats.hpp"
+#include "myWalk.hpp"
 #include <iostream>
 #include <algorithm>
-#include <filesystem>
+#include <sys/stat.h>
 
 /**
- * @brief Constructor for TreeNode class.
- * @param fullPath The full path of the node.
- * @param nodeName The name of the node.
- * @param isFile Indicates whether the node is a file.
+ * @brief A directory waiting to be listed by the walker.
  */
-TreeNode::TreeNode(const std::string &fullPath, const std::string &nodeName, bool isFile)
-    : full_path(fullPath), name(nodeName), is_file(isFile) {}
+struct TreeTask
+{
+    std::string path; /**< The full path of the directory. */
+    NodeId node; /**< The node receiving the directory's children. */
+    std::shared_ptr<const FilterScope> scope; /**< The filter scope of the parent directory. */
+};
 
 /**
- * @brief Adds a child node to the current node.
- * @param child Pointer to the child node to be added.
+ * @brief Computes the node flags of a directory entry.
+ * @param entry The entry, with its type resolved.
+ * @param is_last Whether the entry is the last of its directory listing.
+ * @return The NodeFlagDef bits.
  */
-void TreeNode::addChild(TreeNode *child)
+uint8_t node_flags(const EntryInfo &entry, bool is_last)
 {
-    children.push_back(child);
+    uint8_t flags = 0;
+    if (entry.type == ENTRY_FILE)
+        flags |= NODE_FILE;
+    if (entry.type == ENTRY_DIRECTORY)
+        flags |= NODE_DIRECTORY;
+    if (entry.has_stat && (entry.mode & (S_IXUSR | S_IXGRP | S_IXOTH)))
+        flags |= NODE_EXECUTABLE;
+    if (is_last)
+        flags |= NODE_LAST;
+    if (entry.name[0] == '.')
+        flags |= NODE_HIDDEN;
+    return flags;
 }
 
 /**
- * @brief Checks if the node is a leaf node (has no children).
- * @return true if the node is a leaf node, false otherwise.
+ * @brief Checks whether listing an entry will stat it, so that it can be part of the directory's batch.
+ * @param entry The entry.
+ * @param need_mode Whether the mode bits are needed (for the executable color).
+ * @return true if resolve_type() or the mode lookup would stat the entry.
  */
-bool TreeNode::isLeaf() const
+static bool needs_stat(const EntryInfo &entry, bool need_mode)
 {
-    return children.empty();
+    return entry.type == ENTRY_UNKNOWN || entry.type == ENTRY_SYMLINK || (need_mode && entry.type != ENTRY_DIRECTORY);
 }
 
 /**
- * @brief Builds a tree representing the directory structure.
- * @param directory The path to the directory to build the tree from.
- * @param parent The parent node of the current directory.
+ * @brief Lists one directory and appends its sorted children to the store.
+ * @param task The directory to list.
+ * @param store The store receiving the nodes.
  * @param show_hidden Flag indicating whether to include hidden files/directories.
- * @param prefix Prefix to prepend to each line in the tree (for formatting).
+ * @param need_mode Whether the mode bits are needed (for the executable color).
+ * @param filter Optional filter pruning entries before they are stat-ed or descended into.
+ * @param listener Optional hook called once the children are added.
+ * @param subdirs Output list of subdirectories still to be listed.
  */
-void build_tree(const std::string &directory, TreeNode *parent, bool show_hidden, const std::string &prefix)
+static void list_directory(TreeTask &task, NodeStore &store, bool show_hidden, bool need_mode, const PathFilter *filter, const TreeListener &listener, std::vector<TreeTask> &subdirs)
 {
-    try
+    DirectoryReader reader(task.path);
+    if (!reader.is_open())
     {
-        std::vector<std::string> items;
-        for (const auto &entry : std::filesystem::directory_iterator(directory))
+        std::cerr << "Error: " << directory_error(task.path, reader.error()) << std::endl;
+        return;
+    }
+    std::shared_ptr<const FilterScope> scope = filter ? filter->apply(task.scope, task.path, reader) : nullptr;
+
+    std::vector<EntryInfo> &items = reader.entries;
+    {
+        PhaseTimer timer(PHASE_SORT);
+        sort_by_name(items, [](const EntryInfo &item) -> const std::string &
+                     { return item.name; });
+    }
+
+    // Resolve types and modes before taking the store lock, the syscalls dominate
+    reader.stat_all(true, [&](const EntryInfo &item)
+                    { return (show_hidden || item.name[0] != '.') && needs_stat(item, need_mode); });
+    for (EntryInfo &item : items)
+    {
+        if (!show_hidden && item.name[0] == '.')
+            continue;
+
+        // Directories are known from d_type alone, everything else needs its mode bits for the color
+        if (reader.resolve_type(item) != ENTRY_DIRECTORY && need_mode)
         {
-            std::string item = entry.path().filename().string();
-            items.push_back(item);
+            reader.stat(item);
         }
-        std::sort(items.begin(), items.end());
+    }
 
+    std::vector<NodeId> children(listener ? items.size() : 0, NO_NODE);
+    {
+        auto lock = store.lock();
+        NodeId previous = NO_NODE;
         for (size_t index = 0; index < items.size(); ++index)
         {
-            std::string item = items[index];
-            std::string full_path = directory + "/" + item;
-            bool is_last = index == items.size() - 1;
-
-            if (!show_hidden && item[0] == '.')
-            {
+            const EntryInfo &item = items[index];
+            if (!show_hidden && item.name[0] == '.')
                 continue;
-            }
-
-            std::cout << prefix << (is_last ? "└── " : "├── ");
 
-            TreeNode *node = new TreeNode(full_path, item, std::filesystem::is_regular_file(full_path));
-            parent->addChild(node);
-
-            if (std::filesystem::is_directory(full_path))
-            {
-                // Print directory name with appropriate color
-                std::string color = get_file_color(full_path, item[0] == '.');
-                print_colored_text(item, color);
-                std::cout << std::endl;
-                // Recursively traverse directories
-                build_tree(full_path, node, show_hidden, prefix + (is_last ? "    " : "│   "));
-            }
-            else
+            previous = store.add_child(task.node, previous, item.name, node_flags(item, index == items.size() - 1));
+            if (previous == NO_NODE)
+                break; // The store is full, build_tree() reports it
+            if (listener)
+                children[index] = previous;
+            if (item.type == ENTRY_DIRECTORY && !item.is_symlink)
             {
-                // Print file name with appropriate color
-                std::string color = get_file_color(full_path, item[0] == '.');
-                print_colored_text(item, color);
-                std::cout << std::endl;
+                subdirs.push_back({task.path + "/" + item.name, previous, scope});
             }
         }
     }
-    catch (const std::exception &e)
+
+    if (listener)
+        listener(task.path, task.node, reader, children);
+}
+
+/**
+ * @brief Builds a tree representing the directory structure.
+ *
+ * Directories are listed in parallel by a work-stealing walker. Each directory's
+ * children are sorted by name and linked as siblings, so the finished tree does
+ * not depend on the order in which the workers visited it. Symbolic links to
+ * directories are shown but not followed.
+ *
+ * @param directory The path to the directory to build the tree from.
+ * @param store The store receiving the nodes.
+ * @param parent The node of @p directory in @p store.
+ * @param show_hidden Flag indicating whether to include hidden files/directories.
+ * @param jobs Number of worker threads (0 picks the number of hardware threads).
+ * @param listener Optional hook called for every listed directory.
+ * @param filter Optional --exclude/--include/--gitignore filter; excluded directories are not opened.
+ * @return true if the whole tree was stored, false if the store filled up (an error is printed).
+ */
+bool build_tree(const std::string &directory, NodeStore &store, NodeId parent, bool show_hidden, unsigned jobs, const TreeListener &listener, const PathFilter *filter)
+{
+    // Without colors nothing reads the executable bit, so regular files need no stat at all
+    bool need_mode = out().colors();
+
+    Walker<TreeTask> walker(jobs);
+    walker.run({directory, parent, filter ? filter->root(directory) : nullptr}, [&store, show_hidden, need_mode, filter, &listener](unsigned, TreeTask &task, std::vector<TreeTask> &subdirs)
+               {
+        if (!store.full()) // Once full, the remaining directories are skipped
+            list_directory(task, store, show_hidden, need_mode, filter, listener, subdirs); });
+
+    if (store.full())
     {
-        std::cerr << "Error: " << e.what() << std::endl;
+        std::cerr << "Error: too many entries below '" << directory << "', the tree is incomplete" << std::endl;
+        return false;
     }
+    return true;
 }
 
 /**
- * @brief Counts the number of directories recursively starting from a given node.
- * @param node The starting node for counting directories.
+ * @brief Counts the number of directories in a store with a linear scan.
+ *
+ * Every node that is not a regular file counts as a directory, the root excluded.
+ *
+ * @param store The store to scan.
  * @return The number of directories.
  */
-int count_directories(TreeNode *node)
+std::size_t count_directories(const NodeStore &store)
 {
-    int count = 0;
-    if (!node)
-        return 0;
-
-    for (const auto &child : node->children)
+    std::size_t count = 0;
+    for (NodeId id = 0; id < store.size(); ++id)
     {
-        if (!child->is_file)
-        {
-            count++;                           // Increment count for directory
-            count += count_directories(child); // Recursively count directories in children
-        }
+        if (!store.node(id).is_file() && store.node(id).parent != NO_NODE)
+            count++;
     }
     return count;
 }
 
 /**
- * @brief Counts the number of files recursively starting from a given node.
- * @param node The starting node for counting files.
+ * @brief Counts the number of files in a store with a linear scan.
+ * @param store The store to scan.
  * @return The number of files.
  */
-int count_files(TreeNode *node)
+std::size_t count_files(const NodeStore &store)
+{
+    std::size_t count = 0;
+    for (NodeId id = 0; id < store.size(); ++id)
+    {
+        if (store.node(id).is_file())
+            count++;
+    }
+    return count;
+}
+
+/**
+ * @brief Prints the descendants of a node in tree format.
+ *
+ * The tree is walked iteratively through the sibling links, extending and
+ * truncating one prefix string instead of copying it for every level.
+ *
+ * @param store The store holding the tree.
+ * @param node The node whose descendants are printed.
+ */
+void print_tree_nodes(const NodeStore &store, NodeId node)
 {
-    int count = 0;
-    if (!node)
-        return 0;
+    struct Frame
+    {
+        NodeId resume; /**< The sibling to continue with after the subtree. */
+        std::size_t prefix_length; /**< The prefix length at that level. */
+    };
+
+    Output &sink = out();
+    std::string prefix;
+    std::vector<Frame> stack;
+    NodeId current = store.node(node).first_child;
 
-    for (const auto &child : node->children)
+    while (current != NO_NODE || !stack.empty())
     {
-        if (child->is_file)
+        if (current == NO_NODE)
         {
-            count++; // Increment count for file
+            current = stack.back().resume;
+            prefix.resize(stack.back().prefix_length);
+            stack.pop_back();
+            continue;
+        }
+
+        const TreeNode &child = store.node(current);
+        bool is_last = child.flags & NODE_LAST;
+        sink << prefix << (is_last ? "└── " : "├── ");
+
+        // Print file or directory name with appropriate color
+        EntryTypeDef type = child.flags & NODE_DIRECTORY ? ENTRY_DIRECTORY : child.is_file() ? ENTRY_FILE : ENTRY_OTHER;
+        print_colored_text(store.name(current), get_file_color(type, child.flags & NODE_EXECUTABLE, child.flags & NODE_HIDDEN, store.name(current)));
+        sink << '\n';
+
+        if (!child.isLeaf())
+        {
+            stack.push_back({child.next_sibling, prefix.size()});
+            prefix += is_last ? "    " : "│   ";
+            current = child.first_child;
         }
         else
         {
-            count += count_files(child); // Recursively count files in children
+            current = child.next_sibling;
         }
     }
-    return count;
 }
 
 /**
  * @brief Prints the directory tree rooted at the specified path.
  * @param path The root path of the directory tree.
  * @param show_hidden Flag indicating whether to include hidden files/directories.
+ * @param jobs Number of worker threads used to build the tree (0 picks the number of hardware threads).
+ * @param filter Optional --exclude/--include/--gitignore filter.
  */
-void print_tree(const std::string &path, bool show_hidden)
+void print_tree(const std::string &path, bool show_hidden, unsigned jobs, const PathFilter *filter)
 {
-    TreeNode root(path, ".", false);
+    NodeStore store;
+    NodeId root = store.add_root(path);
     print_colored_text(path, COLOR_FOLDER);
-    std::cout << std::endl;
-    build_tree(path, &root, show_hidden);
+    out() << '\n';
+    build_tree(path, store, root, show_hidden, jobs, nullptr, filter);
+    print_tree_nodes(store, root);
 
     // Optionally, you can print the count of directories and files
-    std::cout << std::endl;
-    std::cout << count_directories(&root) << " directories, " << count_files(&root) << " files" << std::endl;
+    out() << '\n' << count_directories(store) << " directories, " << count_files(store) << " files\n";
+    out().flush();
+}
+
+/**
+ * @brief Prints the directory tree rooted at the specified path while walking it.
+ *
+ * Built on EntryIterator: nothing is stored beyond the sorted listings of the
+ * directories on the current path, so memory grows with depth times the widest
+ * directory instead of the total number of entries, and a reader that goes away
+ * stops the walk. Directories and files are counted as they are printed.
+ *
+ * @param path The root path of the directory tree.
+ * @param options The scan options; jobs is ignored, the walk is sequential.
+ */
+void print_tree_stream(const std::string &path, const ScanOptions &options)
+{
+    Output &sink = out();
+    std::string prefix;
+    std::vector<std::size_t> prefix_lengths{0}; // The prefix length of every level on the current path
+    std::size_t directories = 0;
+    std::size_t files = 0;
+
+    print_colored_text(path, COLOR_FOLDER);
+    sink << '\n';
+
+    IteratorOptions iteration;
+    iteration.stat = sink.colors() ? ITER_STAT_FILES : ITER_STAT_TYPES; // The mode bits give the executable color
+    EntryIterator it(path, options, iteration);
+    if (it.error() != 0)
+    {
+        sink.flush();
+        std::cerr << "Error: " << directory_error(path, it.error()) << std::endl;
+    }
+
+    while (it.next())
+    {
+        const EntryInfo &entry = it.entry();
+        prefix_lengths.resize(it.depth());
+        prefix.resize(prefix_lengths.back());
+        sink << prefix << (it.is_last() ? "└── " : "├── ");
+        print_colored_text(entry.name, get_file_color(entry, entry.name[0] == '.'));
+        sink << '\n';
+
+        if (entry.type == ENTRY_FILE)
+            files++;
+        else
+            directories++;
+
+        if (it.will_enter())
+        {
+            prefix += it.is_last() ? "    " : "│   ";
+            prefix_lengths.push_back(prefix.size());
+        }
+    }
+
+    sink << '\n' << directories << " directories, " << files << " files";
+    if (it.limited())
+        sink << " (stopped after " << it.count() << " entries)";
+    sink << '\n';
+    sink.flush();
+}
+
+/**
+ * @brief Prints a directory tree from a scan index.
+ *
+ * The output is the same as print_tree_stream() would give for the indexed state,
+ * including the depth and entry limits.
+ *
+ * @param index The loaded index.
+ * @param directory The node of the directory to print.
+ * @param path The path printed for the directory.
+ * @param options The scan options; jobs and one_file_system are ignored.
+ */
+void print_tree_index(const ScanIndex &index, NodeId directory, const std::string &path, const ScanOptions &options)
+{
+    struct Frame
+    {
+        std::vector<NodeId> children; /**< The visible children, in name order. */
+        std::size_t next; /**< Index of the next child to print. */
+        std::size_t prefix_length; /**< The prefix length to restore when leaving the directory. */
+    };
+
+    // The index stores children in byte order for its binary search, the view shows them in name order
+    auto visible_children = [&index, &options](NodeId id)
+    {
+        const IndexNode &node = index.node(id);
+        std::vector<NodeId> children;
+        children.reserve(node.child_count);
+        for (uint32_t offset = 0; offset < node.child_count; ++offset)
+        {
+            NodeId child = node.first_child + offset;
+            if (options.show_hidden || index.name(child)[0] != '.')
+                children.push_back(child);
+        }
+        sort_by_name(children, [&index](NodeId child)
+                     { return index.name(child); });
+        return children;
+    };
+
+    Output &sink = out();
+    std::string prefix;
+    std::size_t directories = 0;
+    std::size_t files = 0;
+    uint64_t printed = 0;
+    bool stopped = false;
+
+    print_colored_text(path, COLOR_FOLDER);
+    sink << '\n';
+
+    std::vector<Frame> stack;
+    stack.push_back({visible_children(directory), 0, 0});
+    while (!stack.empty())
+    {
+        Frame &frame = stack.back();
+        if (frame.next == frame.children.size())
+        {
+            prefix.resize(frame.prefix_length);
+            stack.pop_back();
+            continue;
+        }
+
+        NodeId id = frame.children[frame.next++];
+        bool is_last = frame.next == frame.children.size();
+        std::string_view name = index.name(id);
+        if (options.max_entries != 0 && printed == options.max_entries)
+        {
+            stopped = true;
+            break;
+        }
+
+        const IndexNode &child = index.node(id);
+        sink << prefix << (is_last ? "└── " : "├── ");
+        bool is_executable = !(child.flags & INDEX_STAT_FAILED) && (child.mode & (S_IXUSR | S_IXGRP | S_IXOTH));
+        print_colored_text(name, get_file_color(static_cast<EntryTypeDef>(child.type), is_executable, name[0] == '.', name));
+        sink << '\n';
+
+        printed++;
+        if (child.type == ENTRY_FILE)
+            files++;
+        else
+            directories++;
+
+        if (child.is_directory() && child.child_count > 0 && (options.max_depth == 0 || stack.size() < options.max_depth))
+        {
+            std::size_t prefix_length = prefix.size();
+            prefix += is_last ? "    " : "│   ";
+            stack.push_back({visible_children(id), 0, prefix_length}); // Invalidates frame
+        }
+    }
+
+    sink << '\n' << directories << " directories, " << files << " files";
+    if (stopped)
+        sink << " (stopped after " << printed << " entries)";
+    sink << '\n';
+    sink.flush();
 }
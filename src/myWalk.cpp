@@ -0,0 +1,21 @@
+/**
+ ******************************************************************************
+ * @file    myWalk.cpp
+ * @brief   Implementation of the non-template helpers of the directory walker.
+ * @author  Arun, Sagar, Saurav
+ * @date    March 7, 2024
+ ******************************************************************************
+ */
+
+#include "myWalk.hpp"
+#include <thread>
+
+/**
+ * @brief Get the default number of walker jobs.
+ * @return The number of hardware threads, at least 1.
+ */
+unsigned default_jobs()
+{
+    unsigned jobs = std::thread::hardware_concurrency();
+    return jobs ? jobs : 1;
+}
@@ -0,0 +1,760 @@
+/**
+ ******************************************************************************
+ * @file    myWatch.cpp
+ * @brief   Implementation of the continuous watch mode of the tree and size views.
+ * @author  Arun, Sagar, Saurav
+ * @date    March 7, 2024
+ ******************************************************************************
+ */
+
+#include "myWatch.hpp"
+#include "myColors.hpp"
+#include "myOutput.hpp"
+#include "mySort.hpp"
+#include "myTree.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <csignal>
+#include <cstring>
+#include <iostream>
+#include <poll.h>
+#include <sys/inotify.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/**
+ * @brief Events watched on every directory.
+ */
+constexpr uint32_t WATCH_EVENTS = IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO | IN_MODIFY | IN_ATTRIB |
+                                  IN_CLOSE_WRITE | IN_DELETE_SELF | IN_ONLYDIR | IN_DONT_FOLLOW;
+
+/**
+ * @brief Set by SIGINT and SIGTERM to leave the watch loop.
+ */
+static volatile sig_atomic_t watch_stopped = 0;
+
+/**
+ * @brief Signal handler ending the watch loop.
+ */
+static void stop_watching(int)
+{
+    watch_stopped = 1;
+}
+
+/**
+ * @brief Appends colored text to a line, without escapes when colors are disabled.
+ * @param line The line.
+ * @param text The text.
+ * @param color The color.
+ */
+static void append_colored(std::string &line, std::string_view text, std::string_view color)
+{
+    bool colors = out().colors();
+    if (colors)
+        line += color;
+    line += text;
+    if (colors)
+        line += COLOR_RESET;
+}
+
+/**
+ * @brief Constructor.
+ * @param view TREE or SIZE.
+ * @param path The root directory.
+ * @param options The scan options.
+ * @param apparent_size Size view: whether the bars show the apparent size.
+ */
+TreeWatcher::TreeWatcher(ViewTypeDef view, const std::string &path, const ScanOptions &options, bool apparent_size)
+    : view(view), root_path(path), options(options), apparent_size(apparent_size), keep_hidden(view == SIZE || options.show_hidden),
+      inotify_fd(-1), root_dev(0), directories(0), files(0), dead_nodes(0), limit_reported(false), frame_width(0), frame_height(0)
+{
+}
+
+/**
+ * @brief Destructor. Closes the inotify instance.
+ */
+TreeWatcher::~TreeWatcher()
+{
+    if (inotify_fd >= 0)
+        close(inotify_fd);
+}
+
+/**
+ * @brief Scans, then redraws on every change until interrupted.
+ * @return The exit status.
+ */
+int TreeWatcher::run()
+{
+    if (!scan())
+        return OPEN_FAILURE;
+
+    struct sigaction action = {};
+    action.sa_handler = stop_watching;
+    sigaction(SIGINT, &action, nullptr); // No SA_RESTART, poll() must return
+    sigaction(SIGTERM, &action, nullptr);
+
+    Output &sink = out();
+    if (sink.is_terminal())
+        sink << "\033[?25l\033[?7l"; // Hide the cursor, cut long lines instead of wrapping them
+
+    using Clock = std::chrono::steady_clock;
+    draw(render());
+    Clock::time_point next_frame = Clock::now() + std::chrono::milliseconds(WATCH_FRAME_MS);
+    bool dirty = false;
+
+    while (!watch_stopped)
+    {
+        int timeout = -1;
+        if (dirty)
+        {
+            auto wait = std::chrono::duration_cast<std::chrono::milliseconds>(next_frame - Clock::now()).count();
+            timeout = static_cast<int>(std::max<decltype(wait)>(wait, 0));
+        }
+
+        struct pollfd fd = {inotify_fd, POLLIN, 0};
+        int ready = poll(&fd, 1, timeout);
+        if (ready < 0 && errno != EINTR)
+            break;
+        if (ready > 0)
+        {
+            if (!read_events())
+                break;
+            dirty = true;
+        }
+
+        // Events arriving faster than the frame rate are batched into the next frame
+        if (dirty && Clock::now() >= next_frame)
+        {
+            draw(render());
+            dirty = false;
+            next_frame = Clock::now() + std::chrono::milliseconds(WATCH_FRAME_MS);
+        }
+    }
+
+    if (dirty)
+        draw(render());
+    if (sink.is_terminal())
+        sink << "\033[" << frame.size() + 1 << ";1H\033[?7h\033[?25h";
+    sink.flush();
+    return SUCCESS;
+}
+
+/**
+ * @brief Scans the whole tree from scratch and watches every directory.
+ * @return true on success, false if the root cannot be watched (an error is printed).
+ */
+bool TreeWatcher::scan()
+{
+    if (inotify_fd >= 0)
+        close(inotify_fd);
+    inotify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (inotify_fd < 0)
+    {
+        std::cerr << "difo: cannot watch '" << root_path << "': " << std::strerror(errno) << std::endl;
+        return false;
+    }
+
+    store = std::make_unique<NodeStore>();
+    states.clear();
+    watches.clear();
+    links.clear();
+    directories = 0;
+    files = 0;
+    dead_nodes = 0;
+    frame.clear();
+
+    EntryInfo root;
+    if (!stat_path(root_path, root, false))
+    {
+        std::cerr << "difo: cannot access '" << root_path << "': " << std::strerror(errno) << std::endl;
+        return false;
+    }
+    root_dev = root.dev;
+
+    NodeId node = store->add_root(root_path);
+    states.resize(1);
+    claim(node, root, false);
+    add_watch(node, root_path);
+    if (states[node].wd < 0)
+    {
+        std::cerr << "difo: cannot watch '" << root_path << "': " << std::strerror(errno) << std::endl;
+        return false;
+    }
+    scan_subtree(node, root_path);
+    return true;
+}
+
+/**
+ * @brief Adds the contents of a directory already in the tree, and their sizes to its ancestors.
+ * @param node The node of the directory, claimed and watched.
+ * @param path The full path of the directory.
+ */
+void TreeWatcher::scan_subtree(NodeId node, const std::string &path)
+{
+    std::size_t first = store->size();
+    DiskUsage before = states[node].total;
+
+    build_tree(path, *store, node, keep_hidden, options.jobs,
+               [this](const std::string &directory_path, NodeId directory, DirectoryReader &reader, const std::vector<NodeId> &children)
+               { listed(directory_path, directory, reader, children); });
+    states.resize(store->size());
+
+    // Children always have higher ids than their parents, so one backward pass sums the new subtree
+    for (std::size_t id = store->size(); id-- > first;)
+    {
+        WatchState &parent = states[store->node(static_cast<NodeId>(id)).parent];
+        parent.total.apparent += states[id].total.apparent;
+        parent.total.allocated += states[id].total.allocated;
+    }
+
+    NodeId parent = store->node(node).parent;
+    if (parent != NO_NODE)
+    {
+        add_total(parent, static_cast<int64_t>(states[node].total.apparent - before.apparent),
+                  static_cast<int64_t>(states[node].total.allocated - before.allocated));
+    }
+}
+
+/**
+ * @brief Records the children of a directory listed by build_tree(), from the walker threads.
+ * @param path The full path of the directory.
+ * @param directory The node of the directory.
+ * @param reader The reader, with the entries sorted by name.
+ * @param children The node of every entry, NO_NODE for those left out.
+ */
+void TreeWatcher::listed(const std::string &path, NodeId directory, DirectoryReader &reader, const std::vector<NodeId> &children)
+{
+    (void)directory;
+    std::vector<EntryInfo> links_only;
+    std::vector<const EntryInfo *> entries(children.size(), nullptr);
+    links_only.reserve(children.size());
+
+    // Stat outside the lock; the tree view needs no sizes, only the types resolved by build_tree()
+    for (std::size_t index = 0; index < children.size(); ++index)
+    {
+        if (children[index] == NO_NODE)
+            continue;
+
+        EntryInfo &item = reader.entries[index];
+        if (view == SIZE && item.is_symlink)
+        {
+            // A cached stat of a link followed it, sizes count the link itself
+            links_only.emplace_back();
+            links_only.back().name = item.name;
+            links_only.back().is_symlink = true;
+            reader.stat(links_only.back(), false);
+            entries[index] = &links_only.back();
+            continue;
+        }
+        if (view == SIZE)
+            reader.stat(item, false);
+        entries[index] = &item;
+    }
+
+    std::lock_guard<std::mutex> guard(mutex);
+    for (std::size_t index = 0; index < children.size(); ++index)
+    {
+        NodeId child = children[index];
+        if (child == NO_NODE)
+            continue;
+        if (states.size() <= child)
+            states.resize(child + 1);
+
+        const EntryInfo &entry = *entries[index];
+        claim(child, entry, false);
+        if (entry.type == ENTRY_DIRECTORY && !entry.is_symlink)
+        {
+            // Watched before build_tree() lists it, so no event falls in between
+            add_watch(child, path + "/" + entry.name);
+        }
+    }
+}
+
+/**
+ * @brief Starts watching a directory.
+ * @param node The node of the directory.
+ * @param path The full path of the directory.
+ */
+void TreeWatcher::add_watch(NodeId node, const std::string &path)
+{
+    int wd = inotify_add_watch(inotify_fd, path.c_str(), WATCH_EVENTS);
+    if (wd < 0)
+    {
+        if (errno == ENOSPC && !limit_reported)
+        {
+            std::cerr << "difo: out of inotify watches, some directories are not watched "
+                         "(see /proc/sys/fs/inotify/max_user_watches)"
+                      << std::endl;
+            limit_reported = true;
+        }
+        return;
+    }
+    states[node].wd = wd;
+    watches[wd] = node;
+}
+
+/**
+ * @brief Records the metadata of a node and adds its size to the totals.
+ *
+ * Of the nodes sharing an inode, only the first one is counted.
+ *
+ * @param node The node.
+ * @param entry The entry, stat-ed without following links.
+ * @param propagate Whether to add the size to the ancestors now; scan_subtree() sums them in one pass instead.
+ */
+void TreeWatcher::claim(NodeId node, const EntryInfo &entry, bool propagate)
+{
+    WatchState &state = states[node];
+    state.has_stat = entry.has_stat;
+    state.type = entry.is_symlink ? ENTRY_SYMLINK : entry.type;
+    state.mode = entry.mode;
+    state.usage = entry.has_stat ? DiskUsage{entry.size, entry.blocks * 512} : DiskUsage{};
+    state.dev = entry.dev;
+    state.ino = entry.ino;
+    // Linking an inode again sends no event for its other names, so every file is in the table, not only nlink > 1
+    state.shared = view == SIZE && entry.has_stat && entry.type != ENTRY_DIRECTORY;
+
+    bool owner = true;
+    if (state.shared)
+    {
+        std::vector<NodeId> &nodes = links[{entry.dev, entry.ino}];
+        nodes.push_back(node);
+        owner = nodes.front() == node;
+    }
+    state.counted = entry.has_stat && owner && !(options.one_file_system && entry.dev != root_dev);
+
+    if (store->node(node).parent != NO_NODE)
+    {
+        if (store->node(node).is_file())
+            files++;
+        else
+            directories++;
+    }
+
+    if (!state.counted)
+        return;
+    if (propagate)
+    {
+        add_total(node, static_cast<int64_t>(state.usage.apparent), static_cast<int64_t>(state.usage.allocated));
+    }
+    else
+    {
+        state.total.apparent += state.usage.apparent;
+        state.total.allocated += state.usage.allocated;
+    }
+}
+
+/**
+ * @brief Takes the size of a node out of the totals, the reverse of claim().
+ *
+ * When the counted node of a shared inode goes, the next one takes over.
+ *
+ * @param node The node.
+ */
+void TreeWatcher::release(NodeId node)
+{
+    WatchState &state = states[node];
+    if (state.counted)
+    {
+        add_total(node, -static_cast<int64_t>(state.usage.apparent), -static_cast<int64_t>(state.usage.allocated));
+        state.counted = false;
+    }
+
+    if (state.shared)
+    {
+        auto it = links.find({state.dev, state.ino});
+        std::vector<NodeId> &nodes = it->second;
+        bool was_owner = nodes.front() == node;
+        nodes.erase(std::find(nodes.begin(), nodes.end(), node));
+        if (nodes.empty())
+        {
+            links.erase(it);
+        }
+        else if (was_owner)
+        {
+            WatchState &next = states[nodes.front()];
+            if (next.has_stat && !(options.one_file_system && next.dev != root_dev))
+            {
+                next.counted = true;
+                add_total(nodes.front(), static_cast<int64_t>(next.usage.apparent), static_cast<int64_t>(next.usage.allocated));
+            }
+        }
+        state.shared = false;
+    }
+
+    if (store->node(node).parent != NO_NODE)
+    {
+        if (store->node(node).is_file())
+            files--;
+        else
+            directories--;
+    }
+}
+
+/**
+ * @brief Adds a size change to a node and all its ancestors.
+ * @param node The node.
+ * @param apparent The change of the apparent size.
+ * @param allocated The change of the allocated size.
+ */
+void TreeWatcher::add_total(NodeId node, int64_t apparent, int64_t allocated)
+{
+    for (NodeId id = node; id != NO_NODE; id = store->node(id).parent)
+    {
+        states[id].total.apparent += apparent;
+        states[id].total.allocated += allocated;
+    }
+}
+
+/**
+ * @brief Reads and applies all pending inotify events.
+ * @return false if the root went away and watching must stop.
+ */
+bool TreeWatcher::read_events()
+{
+    alignas(struct inotify_event) char buffer[64 * 1024];
+    bool overflow = false;
+
+    while (true)
+    {
+        ssize_t length = read(inotify_fd, buffer, sizeof(buffer));
+        if (length < 0 && errno == EINTR)
+            continue;
+        if (length <= 0)
+            break;
+
+        for (char *p = buffer; p < buffer + length;)
+        {
+            const struct inotify_event *event = reinterpret_cast<const struct inotify_event *>(p);
+            p += sizeof(struct inotify_event) + event->len;
+
+            if (event->mask & IN_Q_OVERFLOW)
+            {
+                overflow = true;
+                continue;
+            }
+            auto it = watches.find(event->wd);
+            if (it == watches.end() || overflow)
+                continue;
+
+            NodeId directory = it->second;
+            if (event->mask & (IN_IGNORED | IN_DELETE_SELF))
+            {
+                if (directory == 0)
+                    return false;
+                if (event->mask & IN_IGNORED)
+                {
+                    states[directory].wd = -1;
+                    watches.erase(it);
+                }
+                continue;
+            }
+            if (event->len > 0)
+                apply(directory, event->name, event->mask);
+        }
+    }
+
+    // Lost events cannot be replayed, and a tree with more dead nodes than live ones is worth compacting
+    if (overflow || dead_nodes > store->size() / 2 + 4096)
+        return scan();
+    return true;
+}
+
+/**
+ * @brief Applies one event on an entry of a watched directory.
+ * @param directory The node of the directory.
+ * @param name The name of the entry.
+ * @param mask The event mask.
+ */
+void TreeWatcher::apply(NodeId directory, const std::string &name, uint32_t mask)
+{
+    NodeId node = store->find_child(directory, name);
+    if (mask & (IN_CREATE | IN_MOVED_TO | IN_DELETE | IN_MOVED_FROM))
+    {
+        // A move within the tree arrives as a removal and an addition, the subtree is read again
+        if (node != NO_NODE)
+            remove_entry(node);
+        if (mask & (IN_CREATE | IN_MOVED_TO))
+            add_entry(directory, name);
+        refresh_directory(directory);
+        return;
+    }
+
+    if (node == NO_NODE)
+    {
+        add_entry(directory, name);
+        return;
+    }
+
+    std::string path = store->path(node);
+    EntryInfo entry;
+    entry.name = name;
+    if (!stat_path(path, entry, false))
+    {
+        remove_entry(node);
+        return;
+    }
+    bool was_directory = store->node(node).flags & NODE_DIRECTORY && states[node].type == ENTRY_DIRECTORY;
+    if (was_directory != (entry.type == ENTRY_DIRECTORY))
+    {
+        remove_entry(node);
+        add_entry(directory, name);
+        return;
+    }
+
+    release(node);
+    claim(node, entry, true);
+
+    // The mode may have changed, e.g. chmod +x
+    EntryInfo shown = entry;
+    if (entry.is_symlink && !stat_path(path, shown, true))
+        shown.type = ENTRY_OTHER;
+    TreeNode &tree_node = store->node(node);
+    tree_node.flags = (tree_node.flags & NODE_LAST) | (node_flags(shown, false) & ~NODE_LAST);
+}
+
+/**
+ * @brief Adds a new entry, and everything below it, to the tree.
+ * @param directory The node of the directory holding the entry.
+ * @param name The name of the entry.
+ */
+void TreeWatcher::add_entry(NodeId directory, const std::string &name)
+{
+    if (!keep_hidden && name[0] == '.')
+        return;
+
+    std::string path = store->path(directory) + "/" + name;
+    EntryInfo entry;
+    entry.name = name;
+    if (!stat_path(path, entry, false))
+        return; // Already gone again
+
+    // Links are shown by what they point to, like build_tree() does
+    EntryInfo shown = entry;
+    if (entry.is_symlink && !stat_path(path, shown, true))
+        shown.type = ENTRY_OTHER;
+
+    NodeId node;
+    {
+        auto lock = store->lock();
+        node = store->insert_child(directory, name, node_flags(shown, false));
+    }
+    if (node == NO_NODE)
+    {
+        std::cerr << "Error: too many entries to watch '" << path << "'" << std::endl;
+        return;
+    }
+    states.resize(store->size());
+    claim(node, entry, true);
+
+    if (entry.type == ENTRY_DIRECTORY)
+    {
+        add_watch(node, path);
+        scan_subtree(node, path);
+    }
+}
+
+/**
+ * @brief Removes an entry, and everything below it, from the tree.
+ * @param node The node of the entry.
+ */
+void TreeWatcher::remove_entry(NodeId node)
+{
+    std::vector<NodeId> pending = {node};
+    while (!pending.empty())
+    {
+        NodeId id = pending.back();
+        pending.pop_back();
+        for (NodeId child = store->node(id).first_child; child != NO_NODE; child = store->node(child).next_sibling)
+        {
+            pending.push_back(child);
+        }
+
+        release(id);
+        if (states[id].wd >= 0)
+        {
+            inotify_rm_watch(inotify_fd, states[id].wd);
+            watches.erase(states[id].wd);
+            states[id].wd = -1;
+        }
+        dead_nodes++;
+    }
+
+    auto lock = store->lock();
+    store->remove_child(node);
+}
+
+/**
+ * @brief Updates the own size of a directory whose entries changed.
+ * @param directory The node of the directory.
+ */
+void TreeWatcher::refresh_directory(NodeId directory)
+{
+    EntryInfo entry;
+    if (!stat_path(store->path(directory), entry, false))
+        return;
+    release(directory);
+    claim(directory, entry, true);
+}
+
+/**
+ * @brief Renders the current view as lines, cut to the terminal height.
+ * @return The lines.
+ */
+std::vector<std::string> TreeWatcher::render() const
+{
+    Output &sink = out();
+    std::size_t max_rows = sink.is_terminal() ? static_cast<std::size_t>(std::max(sink.height() - 4, 1)) : SIZE_MAX;
+    std::vector<std::string> lines(1);
+    bool cut = false;
+
+    if (view == SIZE)
+    {
+        append_colored(lines[0], "Size of directories and files in current directory:", COLOR_TEXT);
+
+        std::vector<NodeId> shown;
+        std::size_t max_name_length = 0;
+        uint64_t max_size = 0;
+        for (NodeId id = store->node(0).first_child; id != NO_NODE; id = store->node(id).next_sibling)
+        {
+            if ((options.show_hidden || store->name(id)[0] != '.') && states[id].has_stat)
+            {
+                shown.push_back(id);
+                max_name_length = std::max(max_name_length, store->name(id).size());
+                max_size = std::max(max_size, apparent_size ? states[id].total.apparent : states[id].total.allocated);
+            }
+        }
+
+        int max_bar_length = std::max(sink.width() - static_cast<int>(max_name_length) - 36, 0);
+        for (NodeId id : shown)
+        {
+            if (lines.size() > max_rows)
+            {
+                cut = true;
+                break;
+            }
+
+            const WatchState &state = states[id];
+            std::string_view name = store->name(id);
+            uint64_t size = apparent_size ? state.total.apparent : state.total.allocated;
+            uint64_t other = apparent_size ? state.total.allocated : state.total.apparent;
+            int bar_length = max_size > 0 ? static_cast<int>(size / static_cast<double>(max_size) * max_bar_length) : 0;
+            bool is_executable = state.has_stat && !S_ISLNK(state.mode) && (state.mode & (S_IXUSR | S_IXGRP | S_IXOTH));
+
+            std::string line;
+            append_colored(line, name, get_file_color(static_cast<EntryTypeDef>(state.type), is_executable, name[0] == '.', name));
+            line.append(max_name_length - name.size() + 1, ' ');
+            append_colored(line, std::string(bar_length, '='), COLOR_BAR);
+            append_colored(line, " " + format_size(size) + " (" + format_size(other) + (apparent_size ? " allocated)" : " apparent)"), COLOR_TEXT);
+            lines.push_back(std::move(line));
+        }
+        if (cut)
+            lines.push_back("...");
+        return lines;
+    }
+
+    append_colored(lines[0], root_path, COLOR_FOLDER);
+    std::string prefix;
+    std::vector<std::pair<NodeId, std::size_t>> stack;
+    NodeId current = store->node(0).first_child;
+    while (current != NO_NODE || !stack.empty())
+    {
+        if (current == NO_NODE)
+        {
+            current = stack.back().first;
+            prefix.resize(stack.back().second);
+            stack.pop_back();
+            continue;
+        }
+        if (lines.size() > max_rows)
+        {
+            cut = true;
+            break;
+        }
+
+        const TreeNode &child = store->node(current);
+        bool is_last = child.flags & NODE_LAST;
+        EntryTypeDef type = child.flags & NODE_DIRECTORY ? ENTRY_DIRECTORY : child.is_file() ? ENTRY_FILE : ENTRY_OTHER;
+        std::string line = prefix + (is_last ? "└── " : "├── ");
+        append_colored(line, store->name(current), get_file_color(type, child.flags & NODE_EXECUTABLE, child.flags & NODE_HIDDEN, store->name(current)));
+        lines.push_back(std::move(line));
+
+        if (!child.isLeaf())
+        {
+            stack.push_back({child.next_sibling, prefix.size()});
+            prefix += is_last ? "    " : "│   ";
+            current = child.first_child;
+        }
+        else
+        {
+            current = child.next_sibling;
+        }
+    }
+
+    if (cut)
+        lines.push_back("...");
+    lines.push_back("");
+    lines.push_back(std::to_string(directories) + " directories, " + std::to_string(files) + " files");
+    return lines;
+}
+
+/**
+ * @brief Draws a frame, rewriting only the lines that differ from the previous one.
+ *
+ * When the output is not a terminal every frame is written in full, separated
+ * by an empty line.
+ *
+ * @param lines The lines of the frame.
+ */
+void TreeWatcher::draw(const std::vector<std::string> &lines)
+{
+    Output &sink = out();
+    if (!sink.is_terminal())
+    {
+        if (lines == frame)
+            return;
+        if (!frame.empty())
+            sink << '\n';
+        for (const std::string &line : lines)
+        {
+            sink << line << '\n';
+        }
+        sink.flush();
+        frame = lines;
+        return;
+    }
+
+    int width = sink.width();
+    int height = sink.height();
+    bool full = frame.empty() || width != frame_width || height != frame_height;
+    if (full)
+        sink << "\033[H\033[2J";
+
+    for (std::size_t row = 0; row < lines.size(); ++row)
+    {
+        if (full || row >= frame.size() || frame[row] != lines[row])
+            sink << "\033[" << row + 1 << ";1H" << lines[row] << "\033[K";
+    }
+    if (!full && lines.size() < frame.size())
+        sink << "\033[" << lines.size() + 1 << ";1H\033[J";
+
+    sink.flush();
+    frame = lines;
+    frame_width = width;
+    frame_height = height;
+}
+
+/**
+ * @brief Watch a directory and keep the tree or size view on screen up to date.
+ * @param view TREE or SIZE.
+ * @param path The root directory.
+ * @param options The scan options.
+ * @param apparent_size Size view: whether the bars show the apparent size.
+ * @return The exit status.
+ */
+int watch(ViewTypeDef view, const std::string &path, const ScanOptions &options, bool apparent_size)
+{
+    TreeWatcher watcher(view, path, options, apparent_size);
+    return watcher.run();
+}
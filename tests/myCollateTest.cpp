@@ -0,0 +1,249 @@
+/**
+ ******************************************************************************
+ * @file    myCollateTest.cpp
+ * @brief   Unit tests of the name sort keys: natural numbers, case folding and
+ *          the SSE2 lowering of ASCII letters.
+ * @author  Arun, Sagar, Saurav
+ * @date    March 7, 2024
+ ******************************************************************************
+ */
+
+#include "myCollate.hpp"
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+
+static int failures = 0; /**< Number of failed checks. */
+
+/**
+ * @brief Encodes a code point below U+0800 as UTF-8.
+ * @param code The code point.
+ * @return The UTF-8 bytes.
+ */
+static std::string utf8(uint32_t code)
+{
+    if (code < 0x80)
+        return std::string(1, static_cast<char>(code));
+    return {static_cast<char>(0xC0 | (code >> 6)), static_cast<char>(0x80 | (code & 0x3F))};
+}
+
+/**
+ * @brief Gets the folded part of the sort key of a name, before the raw name.
+ * @param name The name.
+ * @return The folded key.
+ */
+static std::string folded(const std::string &name)
+{
+    std::string key;
+    append_name_key(key, name);
+    std::string expected_tail = std::string(1, '\0') + name;
+    if (key.size() < expected_tail.size() || key.compare(key.size() - expected_tail.size(), std::string::npos, expected_tail) != 0)
+    {
+        std::cerr << "FAIL: the key of '" << name << "' does not end with the raw name" << std::endl;
+        failures++;
+        return key;
+    }
+    return key.substr(0, key.size() - expected_tail.size());
+}
+
+/**
+ * @brief Checks the order of two names.
+ * @param a The name expected first.
+ * @param b The name expected second.
+ */
+static void check_less(const std::string &a, const std::string &b)
+{
+    if (!name_less(a, b) || name_less(b, a))
+    {
+        std::cerr << "FAIL: '" << a << "' should sort before '" << b << "'" << std::endl;
+        failures++;
+    }
+}
+
+/**
+ * @brief Checks the folded key of a name.
+ * @param name The name.
+ * @param expected The folded key.
+ */
+static void check_folded(const std::string &name, const std::string &expected)
+{
+    std::string key = folded(name);
+    if (key != expected)
+    {
+        std::cerr << "FAIL: '" << name << "' folds to '" << key << "', expected '" << expected << "'" << std::endl;
+        failures++;
+    }
+}
+
+/**
+ * @brief Checks that a code point folds to another one.
+ * @param upper The code point folded.
+ * @param lower The expected result, @p upper itself when it is left alone.
+ */
+static void check_code_point(uint32_t upper, uint32_t lower)
+{
+    std::string key = folded(utf8(upper));
+    if (key != utf8(lower))
+    {
+        std::cerr << "FAIL: U+" << std::hex << upper << " should fold to U+" << lower << std::dec << std::endl;
+        failures++;
+    }
+}
+
+/**
+ * @brief Tests numbers compared by value.
+ */
+static void test_natural()
+{
+    check_less("file2", "file10");
+    check_less("file9", "file10");
+    check_less("file10", "file100");
+    check_less("2", "10");
+    check_less("a1b2", "a1b10");
+    check_less("v1.9", "v1.10");
+    check_less("file", "file0");
+    check_less("file10", "file10a");
+    check_folded("file10", std::string("file0") + '\x02' + "10");
+}
+
+/**
+ * @brief Tests leading zeros, which only the raw name tells apart.
+ */
+static void test_leading_zeros()
+{
+    check_folded("file01", folded("file1"));
+    check_folded("file000", folded("file0"));
+    check_less("file01", "file1");
+    check_less("file001", "file01");
+    check_less("file01", "file2");
+    check_less("file1", "file02");
+    check_less("file0", "file1");
+}
+
+/**
+ * @brief Tests case folding of ASCII and of the Latin-1 letters.
+ */
+static void test_latin1()
+{
+    check_folded("README.md", "readme.md");
+    check_less("apple", "Banana");
+    check_less("Apple", "apple"); // Equal without case, the raw name decides
+    for (uint32_t code = 0xC0; code <= 0xDE; ++code)
+    {
+        check_code_point(code, code == 0xD7 ? code : code + 0x20);
+    }
+    check_code_point(0xD7, 0xD7); // Multiplication sign
+    check_code_point(0xF7, 0xF7); // Division sign
+    check_code_point(0xDF, 0xDF); // Sharp s has no upper case here
+    check_code_point(0xB5, 0xB5); // Micro sign
+    check_folded(utf8(0xC9) + "MILE", utf8(0xE9) + "mile");
+    check_less(utf8(0xC9) + "mile", utf8(0xE9) + "mile"); // Equal without case, the raw name decides
+    check_less("emile", utf8(0xC9) + "mile"); // Accents are not stripped
+}
+
+/**
+ * @brief Tests the odd/even pairs of Latin Extended-A.
+ */
+static void test_latin_extended()
+{
+    // Upper case at even code points
+    for (uint32_t code = 0x100; code <= 0x12F; ++code)
+    {
+        check_code_point(code, code | 1);
+    }
+    for (uint32_t code = 0x132; code <= 0x137; ++code)
+    {
+        check_code_point(code, code | 1);
+    }
+    for (uint32_t code = 0x14A; code <= 0x177; ++code)
+    {
+        check_code_point(code, code | 1);
+    }
+    // Upper case at odd code points
+    for (uint32_t code = 0x139; code <= 0x148; ++code)
+    {
+        check_code_point(code, code + (code & 1));
+    }
+    for (uint32_t code = 0x179; code <= 0x17E; ++code)
+    {
+        check_code_point(code, code + (code & 1));
+    }
+    check_code_point(0x178, 0xFF); // Y with diaeresis folds back to Latin-1
+    check_code_point(0x130, 0x130); // Dotted I and dotless i stay apart
+    check_code_point(0x131, 0x131);
+    check_code_point(0x138, 0x138); // Kra
+    check_code_point(0x149, 0x149);
+    check_code_point(0x17F, 0x17F); // Long s
+}
+
+/**
+ * @brief Tests Greek and Cyrillic.
+ */
+static void test_greek_cyrillic()
+{
+    for (uint32_t code = 0x391; code <= 0x3A9; ++code)
+    {
+        check_code_point(code, code == 0x3A2 ? code : code + 0x20);
+    }
+    check_code_point(0x3C2, 0x3C2); // Final sigma
+    check_code_point(0x390, 0x390);
+    check_code_point(0x3AA, 0x3AA);
+    for (uint32_t code = 0x400; code <= 0x40F; ++code)
+    {
+        check_code_point(code, code + 0x50);
+    }
+    for (uint32_t code = 0x410; code <= 0x42F; ++code)
+    {
+        check_code_point(code, code + 0x20);
+    }
+    check_code_point(0x430, 0x430);
+    check_code_point(0x460, 0x460);
+    check_less(utf8(0x3B1) + utf8(0x3B2), utf8(0x393)); // αβ before Γ
+    check_less(utf8(0x410), utf8(0x431)); // А before б
+}
+
+/**
+ * @brief Tests ASCII lowering on both sides of the 16-byte blocks.
+ */
+static void test_block_boundary()
+{
+    const std::string upper = "ABCDEFGHIJKLMNOPQRSTUVWXYZ@[`{ABCDEFGHIJKLMNOPQRSTUVWXYZ";
+    for (std::size_t length = 1; length <= upper.size(); ++length)
+    {
+        std::string name = upper.substr(0, length);
+        std::string expected = name;
+        for (char &c : expected)
+        {
+            if (c >= 'A' && c <= 'Z')
+                c = static_cast<char>(c + 0x20);
+        }
+        check_folded(name, expected);
+    }
+
+    // A digit or a multibyte letter is noticed wherever it falls
+    check_folded("ABCDEFGHIJKLMNO7", std::string("abcdefghijklmno0") + '\x01' + "7");
+    check_folded("ABCDEFGHIJKLMNOP7", std::string("abcdefghijklmnop0") + '\x01' + "7");
+    check_folded("7BCDEFGHIJKLMNOPQ", std::string("0") + '\x01' + "7bcdefghijklmnopq");
+    check_folded(utf8(0xC9) + "BCDEFGHIJKLMNOPQ", utf8(0xE9) + "bcdefghijklmnopq");
+    check_folded("ABCDEFGHIJKLMNO" + utf8(0xC9) + "Q", "abcdefghijklmno" + utf8(0xE9) + "q");
+    check_folded("ABCDEFGHIJKLMNOPQRSTUVWXYZABCDE" + utf8(0x410), "abcdefghijklmnopqrstuvwxyzabcde" + utf8(0x430));
+}
+
+int main()
+{
+    test_natural();
+    test_leading_zeros();
+    test_latin1();
+    test_latin_extended();
+    test_greek_cyrillic();
+    test_block_boundary();
+
+    if (failures > 0)
+    {
+        std::cerr << failures << " check(s) failed" << std::endl;
+        return EXIT_FAILURE;
+    }
+    std::cout << "all collate checks passed" << std::endl;
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,204 @@
+/**
+ ******************************************************************************
+ * @file    myFilterTest.cpp
+ * @brief   Unit tests of the glob compiler and matcher and of .gitignore rules.
+ * @author  Arun, Sagar, Saurav
+ * @date    March 7, 2024
+ ******************************************************************************
+ */
+
+#include "myFilter.hpp"
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <unistd.h>
+
+static int failures = 0; /**< Number of failed checks. */
+
+/**
+ * @brief Checks that a single glob matches a text or not.
+ * @param pattern The glob.
+ * @param text The text.
+ * @param expected Whether the glob should match.
+ * @param is_directory Whether the text names a directory.
+ */
+static void check_glob(const char *pattern, const char *text, bool expected, bool is_directory = false)
+{
+    GlobSet set;
+    set.add(pattern);
+    if (set.matches(text, is_directory) != expected)
+    {
+        std::cerr << "FAIL: '" << pattern << "' " << (expected ? "should match" : "should not match") << " '" << text << "'" << std::endl;
+        failures++;
+    }
+}
+
+/**
+ * @brief Checks the outcome of .gitignore rules for a path.
+ * @param rules The rules.
+ * @param relative The path relative to the .gitignore.
+ * @param is_directory Whether the path is a directory.
+ * @param expected The outcome.
+ */
+static void check_ignore(const IgnoreRules &rules, std::string_view relative, bool is_directory, IgnoreMatchDef expected)
+{
+    std::size_t slash = relative.find_last_of('/');
+    std::string_view name = slash == std::string_view::npos ? relative : relative.substr(slash + 1);
+    IgnoreMatchDef match = rules.match(relative, name, is_directory);
+    if (match != expected)
+    {
+        std::cerr << "FAIL: .gitignore on '" << relative << "' gave " << match << ", expected " << expected << std::endl;
+        failures++;
+    }
+}
+
+/**
+ * @brief Tests '*', '?' and '/' in plain globs.
+ */
+static void test_star()
+{
+    check_glob("*.o", "main.o", true);
+    check_glob("*.o", ".o", true);
+    check_glob("*.o", "main.c", false);
+    check_glob("*.o", "src/main.o", false);
+    check_glob("src/*.o", "src/main.o", true);
+    check_glob("src/*.o", "src/obj/main.o", false);
+    check_glob("a*b*c", "abbbc", true);
+    check_glob("a*b*c", "acb", false);
+    check_glob("?.c", "a.c", true);
+    check_glob("?.c", "ab.c", false);
+    check_glob("a?b", "a/b", false);
+    check_glob("\\*", "*", true);
+    check_glob("\\*", "a", false);
+}
+
+/**
+ * @brief Tests '**' as a leading, inner and trailing path component.
+ */
+static void test_globstar()
+{
+    check_glob("**/b", "b", true);
+    check_glob("**/b", "a/b", true);
+    check_glob("**/b", "a/x/b", true);
+    check_glob("**/b", "ab", false);
+    check_glob("a/**/b", "a/b", true);
+    check_glob("a/**/b", "a/x/b", true);
+    check_glob("a/**/b", "a/x/y/b", true);
+    check_glob("a/**/b", "a/xb", false);
+    check_glob("a/**/b", "a/x/yb", false);
+    check_glob("a/**/b", "a/keep", false);
+    check_glob("a/**/b", "ab", false);
+    check_glob("a/**", "a/x", true);
+    check_glob("a/**", "a/x/y", true);
+    check_glob("a/**", "b/x", false);
+    check_glob("a**b", "a/b", false); // Not a whole component, a plain star
+    check_glob("a**b", "axyb", true);
+}
+
+/**
+ * @brief Tests character classes, ranges and negation.
+ */
+static void test_classes()
+{
+    check_glob("[abc].txt", "b.txt", true);
+    check_glob("[abc].txt", "d.txt", false);
+    check_glob("file[0-9]", "file7", true);
+    check_glob("file[0-9]", "filex", false);
+    check_glob("[!a-c]x", "dx", true);
+    check_glob("[!a-c]x", "bx", false);
+    check_glob("[^a-c]x", "bx", false);
+    check_glob("a[!b]c", "a/c", false); // Classes never match '/'
+    check_glob("[]]", "]", true);
+    check_glob("[a", "[a", true); // An unclosed class is literal
+}
+
+/**
+ * @brief Tests directory-only patterns and the last matching pattern of a set.
+ */
+static void test_sets()
+{
+    check_glob("build", "build", true, true);
+    GlobSet set;
+    set.add("build", true);
+    set.add("*.log");
+    if (set.matches("build", false) || set.last_match("build", true) != 0 || set.last_match("a.log", false) != 1)
+    {
+        std::cerr << "FAIL: directory-only pattern or pattern order" << std::endl;
+        failures++;
+    }
+    set.add("a.*");
+    if (set.last_match("a.log", false) != 2)
+    {
+        std::cerr << "FAIL: the last added pattern should win" << std::endl;
+        failures++;
+    }
+}
+
+/**
+ * @brief Tests .gitignore parsing: comments, negation, anchoring and trailing '/'.
+ */
+static void test_gitignore()
+{
+    char file[] = "/tmp/difo_filter_test.XXXXXX";
+    int fd = mkstemp(file);
+    if (fd < 0)
+    {
+        std::cerr << "FAIL: cannot create a temporary file" << std::endl;
+        failures++;
+        return;
+    }
+    const char rules_text[] =
+        "# comment\n"
+        "*.log\n"
+        "!keep.log\n"
+        "build/\n"
+        "/root.txt\n"
+        "docs/**/*.tmp\n"
+        "\\#hash\n"
+        "trailing   \n";
+    bool written = write(fd, rules_text, sizeof(rules_text) - 1) == static_cast<ssize_t>(sizeof(rules_text) - 1);
+    close(fd);
+
+    IgnoreRules rules;
+    bool loaded = rules.load(file);
+    unlink(file);
+    if (!written || !loaded)
+    {
+        std::cerr << "FAIL: .gitignore not loaded" << std::endl;
+        failures++;
+        return;
+    }
+
+    check_ignore(rules, "a.log", false, IGNORE_EXCLUDED);
+    check_ignore(rules, "sub/a.log", false, IGNORE_EXCLUDED);
+    check_ignore(rules, "keep.log", false, IGNORE_KEPT);
+    check_ignore(rules, "sub/keep.log", false, IGNORE_KEPT);
+    check_ignore(rules, "build", true, IGNORE_EXCLUDED);
+    check_ignore(rules, "build", false, IGNORE_NONE);
+    check_ignore(rules, "root.txt", false, IGNORE_EXCLUDED);
+    check_ignore(rules, "sub/root.txt", false, IGNORE_NONE);
+    check_ignore(rules, "docs/a.tmp", false, IGNORE_EXCLUDED);
+    check_ignore(rules, "docs/x/y/a.tmp", false, IGNORE_EXCLUDED);
+    check_ignore(rules, "docsx.tmp", false, IGNORE_NONE);
+    check_ignore(rules, "#hash", false, IGNORE_EXCLUDED);
+    check_ignore(rules, "comment", false, IGNORE_NONE);
+    check_ignore(rules, "trailing", false, IGNORE_EXCLUDED);
+}
+
+int main()
+{
+    test_star();
+    test_globstar();
+    test_classes();
+    test_sets();
+    test_gitignore();
+
+    if (failures > 0)
+    {
+        std::cerr << failures << " check(s) failed" << std::endl;
+        return EXIT_FAILURE;
+    }
+    std::cout << "all filter checks passed" << std::endl;
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,199 @@
+/**
+ ******************************************************************************
+ * @file    myQueueTest.cpp
+ * @brief   Unit tests of the bulk push_n() and pop_n() of the ring buffer,
+ *          on one thread and between a producer and a consumer thread.
+ * @author  Arun, Sagar, Saurav
+ * @date    March 7, 2024
+ ******************************************************************************
+ */
+
+#include "myQueue.hpp"
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+#include <thread>
+
+static int failures = 0; /**< Number of failed checks. */
+
+static const std::size_t CHUNKS[] = {1, 3, 5, 7, 9, 11, 13, 15, 17, 19, 23, 31, 37}; /**< Odd chunk sizes, some above the capacity. */
+static const std::size_t CHUNK_COUNT = sizeof(CHUNKS) / sizeof(CHUNKS[0]); /**< Number of chunk sizes. */
+
+/**
+ * @brief Gets the byte at a position of the test stream.
+ * @param position The position.
+ * @return The byte, repeating with a period prime to every capacity.
+ */
+static char byte_at(std::size_t position)
+{
+    return static_cast<char>(position % 251);
+}
+
+/**
+ * @brief Checks a condition.
+ * @param condition The condition.
+ * @param message What failed.
+ */
+static void check(bool condition, const char *message)
+{
+    if (!condition)
+    {
+        std::cerr << "FAIL: " << message << std::endl;
+        failures++;
+    }
+}
+
+/**
+ * @brief Tests full and empty queues and the counts returned by the bulk calls.
+ */
+static void test_bounds()
+{
+    Queue<char, 16> queue;
+    char data[32];
+    for (std::size_t index = 0; index < sizeof(data); ++index)
+    {
+        data[index] = byte_at(index);
+    }
+
+    check(queue.pop_n(data, 5) == 0, "pop_n on an empty queue removed elements");
+    check(queue.push_n(data, 0) == 0, "push_n of nothing added elements");
+    check(queue.push_n(data, 20) == 16, "push_n did not stop at the capacity");
+    check(queue.is_full(), "the queue is not full after push_n filled it");
+    check(queue.push_n(data, 1) == 0, "push_n added to a full queue");
+    check(!queue.push(data[0]), "push added to a full queue");
+
+    char out[32];
+    check(queue.pop_n(out, 20) == 16, "pop_n did not stop at the size");
+    check(queue.is_empty(), "the queue is not empty after pop_n drained it");
+    for (std::size_t index = 0; index < 16; ++index)
+    {
+        if (out[index] != byte_at(index))
+        {
+            check(false, "pop_n returned the wrong bytes");
+            break;
+        }
+    }
+}
+
+/**
+ * @brief Tests odd-sized chunks crossing the wrap point, on one thread.
+ */
+static void test_single_thread()
+{
+    Queue<char, 16> queue;
+    std::size_t pushed = 0;
+    std::size_t popped = 0;
+    char data[64];
+    char out[64];
+
+    for (std::size_t round = 0; round < 10000; ++round)
+    {
+        std::size_t push_count = CHUNKS[round % CHUNK_COUNT];
+        std::size_t pop_count = CHUNKS[(round * 7 + 3) % CHUNK_COUNT];
+        for (std::size_t index = 0; index < push_count; ++index)
+        {
+            data[index] = byte_at(pushed + index);
+        }
+
+        std::size_t free_space = queue.capacity() - (pushed - popped);
+        std::size_t added = queue.push_n(data, push_count);
+        if (added != std::min(push_count, free_space))
+        {
+            std::cerr << "FAIL: push_n of " << push_count << " with " << free_space << " free added " << added << std::endl;
+            failures++;
+            return;
+        }
+        pushed += added;
+
+        std::size_t removed = queue.pop_n(out, pop_count);
+        if (removed != std::min(pop_count, pushed - popped))
+        {
+            std::cerr << "FAIL: pop_n of " << pop_count << " with " << pushed - popped << " queued removed " << removed << std::endl;
+            failures++;
+            return;
+        }
+        for (std::size_t index = 0; index < removed; ++index)
+        {
+            if (out[index] != byte_at(popped + index))
+            {
+                std::cerr << "FAIL: byte " << popped + index << " came out wrong" << std::endl;
+                failures++;
+                return;
+            }
+        }
+        popped += removed;
+        check(queue.size() == pushed - popped, "size() does not match the bulk calls");
+
+        // Single pushes and pops move the wrap point between the bulk calls
+        if (round % 5 == 0 && queue.push(byte_at(pushed)))
+            pushed++;
+        char item;
+        if (round % 7 == 0 && queue.pop(item))
+        {
+            check(item == byte_at(popped), "pop returned the wrong byte");
+            popped++;
+        }
+    }
+    check(pushed > 50000, "the queue moved too few bytes");
+}
+
+/**
+ * @brief Tests odd-sized chunks between a producer and a consumer thread.
+ */
+static void test_two_threads()
+{
+    const std::size_t total = 1 << 20;
+    Queue<char, 64> queue;
+    std::thread producer([&queue, total]
+                         {
+        char data[64];
+        std::size_t pushed = 0;
+        for (std::size_t round = 0; pushed < total; ++round)
+        {
+            std::size_t count = std::min(CHUNKS[round % CHUNK_COUNT], total - pushed);
+            for (std::size_t index = 0; index < count; ++index)
+            {
+                data[index] = byte_at(pushed + index);
+            }
+            // Whatever did not fit is pushed again by the next call
+            std::size_t added = queue.push_n(data, count);
+            pushed += added;
+            if (added == 0)
+                std::this_thread::yield();
+        } });
+
+    char out[64];
+    std::size_t popped = 0;
+    bool intact = true;
+    for (std::size_t round = 0; popped < total; ++round)
+    {
+        std::size_t removed = queue.pop_n(out, CHUNKS[(round * 5 + 1) % CHUNK_COUNT]);
+        for (std::size_t index = 0; index < removed && intact; ++index)
+        {
+            intact = out[index] == byte_at(popped + index);
+        }
+        popped += removed;
+        if (removed == 0)
+            std::this_thread::yield();
+    }
+    producer.join();
+
+    check(intact, "the consumer thread read bytes out of order");
+    check(popped == total, "the consumer thread read more bytes than pushed");
+    check(queue.is_empty(), "the queue is not empty after the consumer thread drained it");
+}
+
+int main()
+{
+    test_bounds();
+    test_single_thread();
+    test_two_threads();
+
+    if (failures > 0)
+    {
+        std::cerr << failures << " check(s) failed" << std::endl;
+        return EXIT_FAILURE;
+    }
+    std::cout << "all queue checks passed" << std::endl;
+    return EXIT_SUCCESS;
+}
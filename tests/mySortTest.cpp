@@ -0,0 +1,217 @@
+/**
+ ******************************************************************************
+ * @file    mySortTest.cpp
+ * @brief   Unit tests of the radix sort of sizes and times against the merge sort.
+ * @author  Arun, Sagar, Saurav
+ * @date    March 7, 2024
+ ******************************************************************************
+ */
+
+#include "myCollate.hpp"
+#include "mySort.hpp"
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+static int failures = 0; /**< Number of failed checks. */
+
+/**
+ * @brief Sorts entries with the merge sort alone, the reference for the radix sort.
+ * @param entries The entries.
+ * @param sort_type The sort criterion.
+ * @param sort_order The sort order.
+ * @return The names, sorted.
+ */
+static std::vector<std::string> merge_sorted(const std::vector<EntryInfo> &entries, SortTypeDef sort_type, SortOrderDef sort_order)
+{
+    std::size_t count = entries.size();
+    std::vector<SortKey> keys(count);
+    std::string names;
+    for (std::size_t index = 0; index < count; ++index)
+    {
+        std::size_t offset = names.size();
+        append_name_key(names, entries[index].name);
+        keys[index] = {entries[index].size, entries[index].mtime_ns, static_cast<uint32_t>(offset), static_cast<uint32_t>(names.size() - offset)};
+    }
+
+    std::vector<uint32_t> order(count);
+    std::vector<uint32_t> scratch(count);
+    for (std::size_t index = 0; index < count; ++index)
+    {
+        order[index] = static_cast<uint32_t>(index);
+    }
+    if (sort_type == SORT_SIZE && sort_order == ASC)
+        mergeSort(order.data(), count, scratch.data(), SortKeyLess<SORT_SIZE, ASC>{keys.data(), names.data()});
+    else if (sort_type == SORT_SIZE)
+        mergeSort(order.data(), count, scratch.data(), SortKeyLess<SORT_SIZE, DESC>{keys.data(), names.data()});
+    else if (sort_order == ASC)
+        mergeSort(order.data(), count, scratch.data(), SortKeyLess<SORT_TIME, ASC>{keys.data(), names.data()});
+    else
+        mergeSort(order.data(), count, scratch.data(), SortKeyLess<SORT_TIME, DESC>{keys.data(), names.data()});
+
+    std::vector<std::string> sorted;
+    for (uint32_t index : order)
+    {
+        sorted.push_back(entries[index].name);
+    }
+    return sorted;
+}
+
+/**
+ * @brief Checks that sort_entries() orders entries like the merge sort, in both orders.
+ * @param label The name of the case.
+ * @param entries The entries, as many as RADIX_SORT_THRESHOLD or more to take the radix path.
+ * @param sort_type SORT_SIZE or SORT_TIME.
+ */
+static void check_sort(const char *label, const std::vector<EntryInfo> &entries, SortTypeDef sort_type)
+{
+    for (SortOrderDef sort_order : {ASC, DESC})
+    {
+        std::vector<EntryInfo> sorted = sort_entries(entries, sort_type, sort_order);
+        std::vector<std::string> expected = merge_sorted(entries, sort_type, sort_order);
+        for (std::size_t index = 0; index < expected.size(); ++index)
+        {
+            if (index >= sorted.size() || sorted[index].name != expected[index])
+            {
+                std::cerr << "FAIL: " << label << (sort_order == ASC ? " ascending" : " descending") << " differs at " << index << ": '"
+                          << (index < sorted.size() ? sorted[index].name : "") << "', expected '" << expected[index] << "'" << std::endl;
+                failures++;
+                break;
+            }
+        }
+    }
+}
+
+/**
+ * @brief Makes entries with distinct names.
+ * @param count The number of entries.
+ * @param prefix The start of every name.
+ * @return The entries, sizes and times left at 0.
+ */
+static std::vector<EntryInfo> make_entries(std::size_t count, const std::string &prefix)
+{
+    std::vector<EntryInfo> entries(count);
+    for (std::size_t index = 0; index < count; ++index)
+    {
+        // Mixed case and numbers, so name keys differ from the raw names
+        entries[index].name = prefix + (index % 3 == 0 ? "File" : "file") + std::to_string(index * 7919 % count);
+        entries[index].has_stat = true;
+    }
+    return entries;
+}
+
+/**
+ * @brief Tests random sizes spread over the whole 64-bit range and over small values.
+ */
+static void test_random_sizes()
+{
+    std::mt19937_64 random(7);
+    std::vector<EntryInfo> entries = make_entries(1000, "");
+    for (EntryInfo &entry : entries)
+    {
+        entry.size = random();
+    }
+    check_sort("random sizes", entries, SORT_SIZE);
+
+    for (EntryInfo &entry : entries)
+    {
+        entry.size = random() % 100000;
+    }
+    check_sort("small sizes", entries, SORT_SIZE);
+}
+
+/**
+ * @brief Tests random times, before and after the epoch.
+ */
+static void test_random_times()
+{
+    std::mt19937_64 random(11);
+    std::vector<EntryInfo> entries = make_entries(1000, "");
+    for (EntryInfo &entry : entries)
+    {
+        entry.mtime_ns = static_cast<int64_t>(random());
+    }
+    check_sort("random times", entries, SORT_TIME);
+
+    for (EntryInfo &entry : entries)
+    {
+        entry.mtime_ns = static_cast<int64_t>(random() % 2000000) - 1000000;
+    }
+    check_sort("times around the epoch", entries, SORT_TIME);
+}
+
+/**
+ * @brief Tests keys that tie, so the names decide.
+ */
+static void test_equal_keys()
+{
+    std::mt19937_64 random(13);
+    std::vector<EntryInfo> entries = make_entries(1000, "");
+    check_sort("equal sizes", entries, SORT_SIZE);
+    check_sort("equal times", entries, SORT_TIME);
+
+    for (EntryInfo &entry : entries)
+    {
+        entry.size = random() % 3;
+        entry.mtime_ns = static_cast<int64_t>(random() % 3) - 1;
+    }
+    check_sort("three sizes", entries, SORT_SIZE);
+    check_sort("three times", entries, SORT_TIME);
+}
+
+/**
+ * @brief Tests names sharing their first 8 bytes, which the radix key cannot tell apart.
+ */
+static void test_shared_prefix()
+{
+    std::mt19937_64 random(17);
+    std::vector<EntryInfo> entries = make_entries(1000, "SharedPrefix_");
+    check_sort("shared prefix, equal sizes", entries, SORT_SIZE);
+
+    for (EntryInfo &entry : entries)
+    {
+        entry.size = random() % 4;
+        entry.mtime_ns = static_cast<int64_t>(random() % 4);
+    }
+    check_sort("shared prefix, four sizes", entries, SORT_SIZE);
+    check_sort("shared prefix, four times", entries, SORT_TIME);
+}
+
+/**
+ * @brief Tests both sides of the threshold between the two sorts.
+ */
+static void test_threshold()
+{
+    std::mt19937_64 random(19);
+    for (std::size_t count : {RADIX_SORT_THRESHOLD - 1, RADIX_SORT_THRESHOLD, RADIX_SORT_THRESHOLD + 1})
+    {
+        std::vector<EntryInfo> entries = make_entries(count, "");
+        for (EntryInfo &entry : entries)
+        {
+            entry.size = random() % 16;
+            entry.mtime_ns = static_cast<int64_t>(random() % 16);
+        }
+        check_sort("threshold sizes", entries, SORT_SIZE);
+        check_sort("threshold times", entries, SORT_TIME);
+    }
+}
+
+int main()
+{
+    test_random_sizes();
+    test_random_times();
+    test_equal_keys();
+    test_shared_prefix();
+    test_threshold();
+
+    if (failures > 0)
+    {
+        std::cerr << failures << " check(s) failed" << std::endl;
+        return EXIT_FAILURE;
+    }
+    std::cout << "all sort checks passed" << std::endl;
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,42 @@
+# Checks that the size view prints the same lines live, from an index and
+# as the size section of a combined view.
+# Run by ctest: cmake -DDIFO=<difo executable> -DWORK=<scratch directory> -P sizeViews.cmake
+
+file(REMOVE_RECURSE "${WORK}")
+foreach(directory File10 file2 Zeta alpha "Émile" "émilie" b/c .hidden)
+    file(MAKE_DIRECTORY "${WORK}/tree/${directory}")
+endforeach()
+file(WRITE "${WORK}/tree/B.txt" "b")
+file(WRITE "${WORK}/tree/a.txt" "aaaaaaaaaaaaaaaa")
+file(WRITE "${WORK}/tree/file2/data" "0123456789")
+file(WRITE "${WORK}/tree/b/c/data" "0123456789012345678901234567890123456789")
+file(CREATE_LINK "${WORK}/tree/b/c/data" "${WORK}/tree/Zeta/data")
+file(CREATE_LINK "${WORK}/tree/b/c/data" "${WORK}/tree/alpha/data")
+
+# Runs difo and keeps its output from the size title on
+function(size_section result)
+    execute_process(COMMAND "${DIFO}" ${ARGN} "${WORK}/tree" OUTPUT_VARIABLE output RESULT_VARIABLE status)
+    if(NOT status EQUAL 0)
+        message(FATAL_ERROR "difo ${ARGN} failed with ${status}")
+    endif()
+    string(FIND "${output}" "Size of" start)
+    if(start EQUAL -1)
+        message(FATAL_ERROR "difo ${ARGN} printed no size view:\n${output}")
+    endif()
+    string(SUBSTRING "${output}" ${start} -1 output)
+    set(${result} "${output}" PARENT_SCOPE)
+endfunction()
+
+foreach(flags "" "-a" "--apparent-size" "-a;--apparent-size")
+    size_section(live --size ${flags})
+    size_section(combined --tree --size ${flags})
+    file(REMOVE "${WORK}/index")
+    size_section(indexed --index "${WORK}/index" --size ${flags})
+    if(NOT live STREQUAL combined)
+        message(FATAL_ERROR "--tree --size ${flags} differs from --size:\n${live}\n${combined}")
+    endif()
+    if(NOT live STREQUAL indexed)
+        message(FATAL_ERROR "--index --size ${flags} differs from --size:\n${live}\n${indexed}")
+    endif()
+endforeach()
+message(STATUS "all size view checks passed")